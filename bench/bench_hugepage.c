@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "htbl.h"
+#include "mem.h"
+#include "vector.h"
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Random access throughput of big containers with and without the huge page
+ * backing arrays. Usage: bench_hugepage [number of items, 2^24 by default].
+ */
+
+#define LOOKUPS (8 * 1024 * 1024)
+
+static double _now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift, rand() is too slow and too short for this.
+static uint64_t _next(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void _bench_vector(const char *name, const uallocator_t *a, size_t n)
+{
+    uvector_t *v = uvector_create_ext(a);
+    uvector_reserve_capacity(v, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        uvector_append(v, G_SIZE(i));
+    }
+
+    uint64_t seed = 88172645463325252ULL;
+    size_t sum = 0;
+    double t = _now();
+    for (size_t i = 0; i < LOOKUPS; i++)
+    {
+        sum += G_AS_SIZE(uvector_get_at(v, _next(&seed) % n));
+    }
+    t = _now() - t;
+
+    printf("uvector_get_at %-9s %8.1f Mops/s (%zu)\n", name,
+           LOOKUPS / t / 1e6, sum % 10);
+    uvector_destroy(v);
+}
+
+static void _bench_htbl(const char *name, const uallocator_t *a, size_t n)
+{
+    uhtbl_t *h = uhtbl_create_ext(UHTBL_TYPE_OPEN_ADDRESSING, a);
+    for (size_t i = 0; i < n; i++)
+    {
+        uhtbl_put(h, G_SIZE(i), G_SIZE(i));
+    }
+
+    uint64_t seed = 88172645463325252ULL;
+    size_t sum = 0;
+    double t = _now();
+    for (size_t i = 0; i < LOOKUPS; i++)
+    {
+        sum += G_AS_SIZE(uhtbl_get(h, G_SIZE(_next(&seed) % n), G_NULL()));
+    }
+    t = _now() - t;
+
+    printf("uhtbl_get      %-9s %8.1f Mops/s (%zu)\n", name,
+           LOOKUPS / t / 1e6, sum % 10);
+    uhtbl_destroy(h);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 0) : (1 << 24);
+
+    uhugepage_allocator_t hp;
+    uhugepage_allocator_init(&hp, NULL, HUGEPAGE_DEFAULT_THRESHOLD,
+                             UNUMA_NODE_ANY);
+
+    printf("%zu items, %d random lookups\n", n, LOOKUPS);
+    _bench_vector("default", NULL, n);
+    _bench_vector("hugepage", &hp.allocator, n);
+    _bench_htbl("default", NULL, n / 4);
+    _bench_htbl("hugepage", &hp.allocator, n / 4);
+
+    return EXIT_SUCCESS;
+}
@@ -24,7 +24,9 @@ typedef enum {
 void ubst_set_default_balancing_mode(ubst_balancing_mode_t mode);
 
 ubst_t *ubst_create(void);
-ubst_t *ubst_create_ext(ubst_balancing_mode_t mode);
+ubst_t *ubst_create_ext(ubst_balancing_mode_t mode,
+                        const uallocator_t *allocator);
+ubst_t *ubst_create_with_arena(ubst_balancing_mode_t mode, uarena_t *arena);
 void ubst_destroy(ubst_t *b);
 
 static bool ubst_is_data_owner(ubst_t *b);
@@ -67,6 +69,7 @@ uvector_t *ubst_get_items(const ubst_t *b, udict_items_kind_t kind, bool deep);
 static inline uvector_t *ubst_get_keys(const ubst_t *b, bool deep) {return ubst_get_items(b, UDICT_KEYS, deep);}
 static inline uvector_t *ubst_get_values(const ubst_t *b, bool deep) {return ubst_get_items(b, UDICT_VALUES, deep);}
 
+umem_usage_t ubst_get_memory_usage(const ubst_t *b);
 ugeneric_base_t *ubst_get_base(ubst_t *b);
 DEFINE_BASE_FUNCS(ubst, b)
 
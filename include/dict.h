@@ -3,6 +3,7 @@
 
 #include "generic.h"
 #include "vector.h"
+#include <stdatomic.h>
 
 typedef enum {
     UDICT_BACKEND_DEFAULT = 0,
@@ -38,6 +39,7 @@ typedef int        (*f_udict_print)(const void *d);
 typedef int        (*f_udict_fprint)(const void *d, FILE *out);
 typedef ugeneric_base_t *(*f_udict_get_base)(void *d);
 typedef uvector_t *(*f_udict_get_items)(const void *d, udict_items_kind_t kind, bool deep);
+typedef umem_usage_t (*f_udict_get_memory_usage)(const void *d);
 
 typedef ugeneric_kv_t (*f_udict_iterator_get_next)(void *di);
 typedef bool          (*f_udict_iterator_has_next)(const void *di);
@@ -57,6 +59,7 @@ typedef struct {
     f_udict_fprint              fprint;
     f_udict_get_base            get_base;
     f_udict_get_items           get_items;
+    f_udict_get_memory_usage    get_memory_usage;
 } udict_vtable_t;
 
 typedef struct {
@@ -69,6 +72,8 @@ typedef struct {
     udict_backend_t backend;
     void *vobj;
     const udict_vtable_t *vtable;
+    const uallocator_t *allocator;
+    atomic_size_t *refs; // dicts sharing vobj, NULL if it isn't shared
 } udict_t;
 
 typedef struct {
@@ -80,17 +85,22 @@ typedef struct {
 
 udict_t *udict_create(void);
 udict_t *udict_create_with_backend(udict_backend_t backend);
+udict_t *udict_create_ext(udict_backend_t backend, const uallocator_t *allocator);
+udict_t *udict_create_with_arena(udict_backend_t backend, uarena_t *arena);
 void udict_update(udict_t *d, udict_t *update);
 
 static void udict_take_data_ownership(udict_t *d);
 static void udict_drop_data_ownership(udict_t *d);
 static bool udict_is_data_owner(udict_t *d);
 
-static inline void udict_clear(udict_t *d) {d->vtable->clear(d->vobj);}
-static inline void udict_put(udict_t *d, ugeneric_t k, ugeneric_t v) {d->vtable->put(d->vobj, k, v);}
+// Gives d storage of its own if it shares one, see udict_cow_copy().
+void udict_unshare(udict_t *d);
+
+void udict_clear(udict_t *d);
+static inline void udict_put(udict_t *d, ugeneric_t k, ugeneric_t v) {if (d->refs) udict_unshare(d); d->vtable->put(d->vobj, k, v);}
 static inline ugeneric_t udict_get(const udict_t *d, ugeneric_t k, ugeneric_t vdef) {return d->vtable->get(d->vobj, k, vdef);}
-static inline ugeneric_t udict_pop(udict_t *d, ugeneric_t k, ugeneric_t vdef) {return d->vtable->pop(d->vobj, k, vdef);}
-static inline bool udict_remove(udict_t *d, ugeneric_t k) {return d->vtable->remove(d->vobj, k);}
+static inline ugeneric_t udict_pop(udict_t *d, ugeneric_t k, ugeneric_t vdef) {if (d->refs) udict_unshare(d); return d->vtable->pop(d->vobj, k, vdef);}
+static inline bool udict_remove(udict_t *d, ugeneric_t k) {if (d->refs) udict_unshare(d); return d->vtable->remove(d->vobj, k);}
 static inline bool udict_has_key(const udict_t *d, ugeneric_t k) {return d->vtable->has_key(d->vobj, k);}
 static inline size_t udict_get_size(const udict_t *d) {return d->vtable->get_size(d->vobj);}
 static inline bool udict_is_empty(const udict_t *d) {return d->vtable->is_empty(d->vobj);}
@@ -100,6 +110,7 @@ static inline int udict_fprint(const udict_t *d, FILE *out) {return d->vtable->f
 static inline int udict_print(const udict_t *d) {return udict_fprint(d, stdout); }
 static inline uvector_t *udict_get_items(const udict_t *d, udict_items_kind_t kind, bool deep) {return d->vtable->get_items(d->vobj, kind, deep);}
 void udict_destroy(udict_t *d);
+umem_usage_t udict_get_memory_usage(const udict_t *d);
 int udict_compare(const udict_t *d1, const udict_t *d2);
 void udict_set_void_hasher(udict_t *d, void_hasher_t hasher);
 void udict_set_void_key_comparator(udict_t *d, void_cmp_t cmp);
@@ -109,6 +120,15 @@ static inline uvector_t *udict_get_values(const udict_t *d, bool deep) {return u
 
 void *udict_copy(const udict_t *d);
 void *udict_deep_copy(const udict_t *d);
+/*
+ * O(1) copy sharing storage with d until either of them is modified, then
+ * that one gets storage of its own: a deep copy if it owns the data, a
+ * shallow one otherwise. Dicts sharing storage may be read, copied and
+ * destroyed from different threads, making the first copy of a dict counts
+ * as modifying it. Ownership and handlers have to be set before sharing,
+ * they are shared as well.
+ */
+udict_t *udict_cow_copy(const udict_t *d);
 udict_iterator_t *udict_iterator_create(const udict_t *d);
 static inline ugeneric_kv_t udict_iterator_get_next(udict_iterator_t *di) {return di->vtable->next(di->vobj);}
 static inline bool udict_iterator_has_next(const udict_iterator_t *di) {return di->vtable->has_next(di->vobj);}
@@ -0,0 +1,32 @@
+#ifndef UEXTSORT_H__
+#define UEXTSORT_H__
+
+#include "generic.h"
+
+/*
+ * External merge sort of binary record files (see ufile_writer_write_generic())
+ * larger than memory. Input is cut into runs of at most memory_budget bytes
+ * (items together with the data they refer to), each run is sorted with
+ * uvector_sort() and spilled to a temporary file, then the runs are merged
+ * k-way with a loser tree, at most EXTSORT_MAX_FAN_IN at once. Input which
+ * fits into the budget is never spilled. Temporary files are created with
+ * mkstemp() in tmp_dir ("." if NULL) and are removed when the iterator is
+ * destroyed.
+ */
+#define EXTSORT_DEFAULT_MEMORY_BUDGET (64 * 1024 * 1024)
+#define EXTSORT_MAX_FAN_IN 64
+
+typedef struct uextsort_iterator_opaq uextsort_iterator_t;
+
+ugeneric_t uextsort_iterator_create(const char *path, size_t memory_budget,
+                                    const char *tmp_dir);
+bool uextsort_iterator_has_next(const uextsort_iterator_t *it);
+// Items are handed over to the caller.
+ugeneric_t uextsort_iterator_get_next(uextsort_iterator_t *it);
+void uextsort_iterator_destroy(uextsort_iterator_t *it);
+
+// Writes sorted records of input_path to output_path.
+ugeneric_t uextsort_file(const char *input_path, const char *output_path,
+                         size_t memory_budget, const char *tmp_dir);
+
+#endif
@@ -2,6 +2,7 @@
 #define UFILE_UTILS_H__
 
 #include "generic.h"
+#include "rope.h"
 #include "string_utils.h"
 #include "vector.h"
 #include <errno.h>
@@ -32,11 +33,30 @@ size_t ufile_reader_get_buffer_size(const ufile_reader_t *fr);
 bool ufile_reader_has_next(const ufile_reader_t *fr);
 ugeneric_t ufile_reader_destroy(ufile_reader_t *fr);
 
+/*
+ * Binary record stream of generics (anything but void data and errors),
+ * each one as ugeneric_encode_binary() output preceded by its 64 bit length
+ * in host byte order. Strings, memchunks, vectors and dicts read back are
+ * allocated and belong to the caller.
+ */
+ugeneric_t ufile_reader_read_generic(ufile_reader_t *fr);
+ugeneric_t ufile_writer_write_generic(ufile_writer_t *fw, ugeneric_t g);
+
 ugeneric_t ufile_writer_create(const char *path);
+// Creates a new file of the owner only, named by mkstemp(): the trailing
+// XXXXXX of path_template are replaced with the name actually used.
+ugeneric_t ufile_writer_create_unique(char *path_template);
 ugeneric_t ufile_writer_write(ufile_writer_t *fw, umemchunk_t mchunk);
+// Writes all the segments of r with writev(), nothing is copied.
+ugeneric_t ufile_writer_write_rope(ufile_writer_t *fw, const urope_t *r);
 ugeneric_t ufile_writer_get_file_size(ufile_writer_t *fw);
 ugeneric_t ufile_writer_get_position(const ufile_writer_t *fw);
 ugeneric_t ufile_writer_set_position(ufile_writer_t *fw, size_t position);
 ugeneric_t ufile_writer_destroy(ufile_writer_t *fw);
 
+// Writes serialized g block by block, without building it in memory first.
+ugeneric_t ufile_writer_serialize_v(ufile_writer_t *fw, ugeneric_t g,
+                                    void_s8r_t void_serializer);
+#define ufile_writer_serialize(fw, g) ufile_writer_serialize_v(fw, g, NULL)
+
 #endif
@@ -155,22 +155,43 @@ typedef char *(*void_s8r_t)(const void *ptr, size_t *output_size);
 typedef size_t (*void_hasher_t)(const void *ptr);
 typedef bool (*ugeneric_kv_iter_t)(ugeneric_t k, ugeneric_t v, void *data);
 typedef void (*ugeneric_sorter_t)(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
+typedef ugeneric_t (*ugeneric_key_fn_t)(ugeneric_t g);
 
 size_t ugeneric_hash(ugeneric_t g, void_hasher_t hasher);
 ugeneric_t ugeneric_copy_v(ugeneric_t g, void_cpy_t cpy);
 int ugeneric_compare_v(ugeneric_t g1, ugeneric_t g2, void_cmp_t cmp);
 void ugeneric_destroy_v(ugeneric_t g, void_dtr_t dtr);
 
+// Heap bytes an item refers to, i.e. what destroying it would release.
+size_t ugeneric_get_memory_usage(ugeneric_t g);
+
 void ugeneric_error_destroy(ugeneric_t g);
 void ugeneric_error_print(ugeneric_t g);
 
 ugeneric_t ugeneric_parse(const char *str);
+// Strings, memchunks and containers of the result are all placed on the arena
+// and are released together with it, the result must not be destroyed.
+ugeneric_t ugeneric_parse_with_arena(const char *str, uarena_t *arena);
+
+/*
+ * Compact binary counterpart of serialize/parse. Decoded strings are G_CSTR
+ * pointing into data, so data must outlive the result; memchunks are copied.
+ * Containers nested deeper than UGENERIC_BINARY_MAX_DEPTH fail to decode.
+ */
+#define UGENERIC_BINARY_MAX_DEPTH 1000
+void ugeneric_encode_binary(ugeneric_t g, ubuffer_t *buf);
+ugeneric_t ugeneric_decode_binary(const void *data, size_t size);
 
 void ugeneric_array_reverse(ugeneric_t *base, size_t nmemb, size_t l, size_t r);
 bool ugeneric_array_is_sorted(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
 bool ugeneric_array_next_permutation(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
 size_t ugeneric_array_bsearch(ugeneric_t *base, size_t nmemb, ugeneric_t e,
                               void_cmp_t cmp);
+// Position of the first item equal to e at or after start, SIZE_MAX if none.
+size_t ugeneric_array_find(const ugeneric_t *base, size_t nmemb, size_t start,
+                           ugeneric_t e, void_cmp_t cmp);
+size_t ugeneric_array_count(const ugeneric_t *base, size_t nmemb, ugeneric_t e,
+                            void_cmp_t cmp);
 /* PRN */
 unsigned int ugeneric_random_init(void);
 void ugeneric_random_init_with_seed(unsigned int seed);
@@ -221,6 +242,7 @@ typedef struct {
 typedef struct {
     uvoid_handlers_t void_handlers;
     bool is_data_owner;
+    const uallocator_t *allocator;
 } ugeneric_base_t;
 
 #define DEFINE_BASE_FUNCS(_type_, _name_) \
@@ -235,5 +257,6 @@ static inline void_s8r_t _type_##_get_void_serializer(_type_##_t *(_name_))
 static inline void _type_##_take_data_ownership(_type_##_t *(_name_))                 {_type_##_get_base(_name_)->is_data_owner = true;}     \
 static inline void _type_##_drop_data_ownership(_type_##_t *(_name_))                 {_type_##_get_base(_name_)->is_data_owner = false;}    \
 static inline bool _type_##_is_data_owner(_type_##_t *(_name_))                       {return _type_##_get_base(_name_)->is_data_owner;}     \
+static inline const uallocator_t *_type_##_get_allocator(_type_##_t *(_name_))        {return _type_##_get_base(_name_)->allocator;}         \
 
 #endif
@@ -51,6 +51,7 @@ void ugraph_dump_to_dot(const ugraph_t *g, const char *name, FILE *out);
 //ugraph_t ugraph_load_from_dot(FILE *in);
 
 void ugraph_destroy(ugraph_t *g);
+umem_usage_t ugraph_get_memory_usage(const ugraph_t *g);
 
 ugraph_edge_iterator_t *ugraph_edge_iterator_create(const ugraph_t *g, size_t n);
 const ugraph_edge_t *ugraph_edge_iterator_get_next(ugraph_edge_iterator_t *ei);
@@ -16,7 +16,8 @@ typedef enum {
 } uheap_type_t;
 
 uheap_t *uheap_create(void);
-uheap_t *uheap_create_ext(size_t capacity, uheap_type_t type);
+uheap_t *uheap_create_ext(size_t capacity, uheap_type_t type,
+                          const uallocator_t *allocator);
 uheap_t *uheap_build_from_array(const ugeneric_t *base, size_t nmemb,
                                 uheap_type_t type,
                                 uvoid_handlers_t *void_handlers);
@@ -47,6 +48,7 @@ static inline int uheap_print(const uheap_t *h) {return uheap_fprint(h, stdout);
 
 void uheap_dump_to_dot(const uheap_t *h, const char *name, FILE *out);
 
+umem_usage_t uheap_get_memory_usage(const uheap_t *h);
 ugeneric_base_t *uheap_get_base(uheap_t *h);
 DEFINE_BASE_FUNCS(uheap, h)
 
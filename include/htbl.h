@@ -16,6 +16,8 @@ typedef struct uhtbl_iterator_opaq uhtbl_iterator_t;
 
 uhtbl_t *uhtbl_create(void);
 uhtbl_t *uhtbl_create_with_type(uhtbl_type_t type);
+uhtbl_t *uhtbl_create_ext(uhtbl_type_t type, const uallocator_t *allocator);
+uhtbl_t *uhtbl_create_with_arena(uhtbl_type_t type, uarena_t *arena);
 void uhtbl_set_void_key_comparator(uhtbl_t *h, void_cmp_t cmp);
 void_cmp_t uhtbl_get_void_key_comparator(const uhtbl_t *h);
 void uhtbl_set_void_hasher(uhtbl_t *h, void_hasher_t hasher);
@@ -52,6 +54,7 @@ uvector_t *uhtbl_get_items(const uhtbl_t *h, udict_items_kind_t kind, bool deep)
 static inline uvector_t *uhtbl_get_keys(const uhtbl_t *h, bool deep) {return uhtbl_get_items(h, UDICT_KEYS, deep);}
 static inline uvector_t *uhtbl_get_values(const uhtbl_t *h, bool deep) {return uhtbl_get_items(h, UDICT_VALUES, deep);}
 
+umem_usage_t uhtbl_get_memory_usage(const uhtbl_t *h);
 ugeneric_base_t *uhtbl_get_base(uhtbl_t *h);
 DEFINE_BASE_FUNCS(uhtbl, h)
 
@@ -7,6 +7,8 @@ typedef struct ulist_opaq ulist_t;
 typedef struct ulist_iterator_opaq ulist_iterator_t;
 
 ulist_t *ulist_create(void);
+ulist_t *ulist_create_ext(const uallocator_t *allocator);
+ulist_t *ulist_create_with_arena(uarena_t *arena);
 void ulist_clear(ulist_t *l);
 void ulist_destroy(ulist_t *l);
 void ulist_insert_at(ulist_t *l, size_t i, ugeneric_t e);
@@ -49,6 +51,7 @@ bool ulist_iterator_has_prev(const ulist_iterator_t *li);
 void ulist_iterator_reset(ulist_iterator_t *li);
 void ulist_iterator_destroy(ulist_iterator_t *li);
 
+umem_usage_t ulist_get_memory_usage(const ulist_t *l);
 ugeneric_base_t *ulist_get_base(ulist_t *l);
 DEFINE_BASE_FUNCS(ulist, l)
 
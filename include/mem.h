@@ -17,14 +17,185 @@ void ufree(void *ptr);
 
 static inline void *uzalloc(size_t size) {return ucalloc(size, 1);}
 
+/*
+ * Allocator interface containers take all their internal memory from. Sizes
+ * are passed to realloc and free as well, so size-class pools don't have to
+ * keep them in a header. NULL given instead of an allocator anywhere stands
+ * for the default one which is a thin wrapper around umalloc() and friends.
+ */
+typedef struct {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t size);
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} uallocator_t;
+
+const uallocator_t *uallocator_get_default(void);
+
+static inline void *uallocator_alloc(const uallocator_t *a, size_t size)
+{
+    return a->alloc(a->ctx, size);
+}
+
+static inline void *uallocator_zalloc(const uallocator_t *a, size_t size)
+{
+    return memset(a->alloc(a->ctx, size), 0, size);
+}
+
+static inline void *uallocator_realloc(const uallocator_t *a, void *ptr,
+                                       size_t old_size, size_t size)
+{
+    return a->realloc(a->ctx, ptr, old_size, size);
+}
+
+static inline void uallocator_free(const uallocator_t *a, void *ptr, size_t size)
+{
+    if (ptr)
+    {
+        a->free(a->ctx, ptr, size);
+    }
+}
+
+/*
+ * Opt-in allocation statistics. The global ones cover everything that goes
+ * through the default allocator, i.e. internals of containers created without
+ * an explicit allocator. A tracker is an allocator gathering the same numbers
+ * for whichever containers are created with it, one per container or per
+ * subsystem. Histogram class i counts allocations of (2^(i-1), 2^i] bytes.
+ * The global counters may be updated from any thread, a tracker's ones are
+ * plain and it shouldn't be shared between threads. Blocks allocated before
+ * the counting was enabled (or reset) are counted as frees when released but
+ * don't take bytes_live below zero, so it is exact only for what has been
+ * allocated since.
+ */
+#define UMEM_SIZE_CLASSES 32
+
+typedef struct {
+    size_t bytes_live;
+    size_t bytes_peak;
+    size_t allocs;
+    size_t frees;
+    size_t histogram[UMEM_SIZE_CLASSES];
+} umem_stats_t;
+
+void libugeneric_enable_mem_stats(bool enable);
+void libugeneric_get_mem_stats(umem_stats_t *stats);
+void libugeneric_reset_mem_stats(void);
+
+typedef struct {
+    uallocator_t allocator; // to be passed to *_create_ext()
+    const uallocator_t *upstream;
+    umem_stats_t stats;
+} umem_tracker_t;
+
+void umem_tracker_init(umem_tracker_t *t, const uallocator_t *upstream);
+
+/*
+ * Policy for big backing arrays: vector and heap cells, open addressing
+ * buckets. Blocks of at least threshold bytes are mapped directly with mmap(),
+ * aligned to and rounded up to a huge page, and advised to be backed by
+ * transparent huge pages, so random access into them misses TLB far less
+ * often. Optionally the pages are bound to a NUMA node. Smaller blocks (the
+ * container structure, nodes) go to the upstream allocator as usual. Both
+ * huge pages and the binding are hints, the memory is still usable if the
+ * kernel ignores them.
+ */
+#define HUGEPAGE_SIZE (2 * 1024 * 1024)
+#define HUGEPAGE_DEFAULT_THRESHOLD HUGEPAGE_SIZE
+#define UNUMA_NODE_ANY (-1)
+
+typedef struct {
+    uallocator_t allocator; // to be passed to *_create_ext()
+    const uallocator_t *upstream;
+    size_t threshold;
+    int numa_node;
+    size_t bytes_mapped; // currently held in the mappings
+} uhugepage_allocator_t;
+
+void uhugepage_allocator_init(uhugepage_allocator_t *h,
+                              const uallocator_t *upstream, size_t threshold,
+                              int numa_node);
+
+// Memory held by a container, in bytes.
+typedef struct {
+    size_t header;  // the container structure itself
+    size_t nodes;   // list items, tree nodes, hash records (whole slabs)
+    size_t buckets; // cell and bucket arrays (whole capacity)
+    size_t payload; // strings, memchunks and nested containers it owns
+} umem_usage_t;
+
+static inline size_t umem_usage_get_total(umem_usage_t u)
+{
+    return u.header + u.nodes + u.buckets + u.payload;
+}
+
+/*
+ * Region allocator: memory is carved out of big blocks with a pointer bump
+ * and is never freed individually, everything goes away at once on reset or
+ * destroy. Containers created on an arena keep all their internals there,
+ * so a whole structure can be dropped by resetting the arena instead of
+ * destroying it item by item.
+ */
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+typedef struct uarena_opaq uarena_t;
+
+uarena_t *uarena_create(void);
+uarena_t *uarena_create_with_block_size(size_t block_size);
+void *uarena_alloc(uarena_t *a, size_t size);
+void *uarena_realloc(uarena_t *a, void *ptr, size_t old_size, size_t size);
+char *uarena_strdup(uarena_t *a, const char *str);
+void uarena_reset(uarena_t *a);
+void uarena_destroy(uarena_t *a);
+size_t uarena_get_allocated_size(const uarena_t *a);
+const uallocator_t *uarena_get_allocator(uarena_t *a);
+// Allocator for copies of a container allocated with a. Copies of arena
+// backed containers (copy-on-write ones too) are ordinary heap objects, they
+// survive uarena_reset() just like the data they own.
+const uallocator_t *uallocator_get_copy_allocator(const uallocator_t *a);
+
+/*
+ * Pool of equally sized objects (container nodes). Objects are cut out of
+ * slabs taken from the backing allocator, freed ones are chained into a free
+ * list and handed out first, so both alloc and free are O(1) and objects of
+ * one pool stay densely packed. Slabs are only given back on reset/destroy.
+ * Objects are aligned for pointers, types with a stricter alignment (long
+ * double, max_align_t) need an object_size that is a multiple of it.
+ */
+#define POOL_MIN_SLAB_OBJECTS 4
+#define POOL_MAX_SLAB_SIZE (64 * 1024)
+
+typedef struct upool_opaq upool_t;
+
+upool_t *upool_create(size_t object_size, const uallocator_t *allocator);
+void *upool_alloc(upool_t *p);
+void upool_free(upool_t *p, void *ptr);
+void upool_reset(upool_t *p);
+void upool_destroy(upool_t *p);
+size_t upool_get_allocated_size(const upool_t *p); // slabs and the pool itself
+
+// Allocate on the arena when there is one and on the heap otherwise.
+void *umalloc_in(uarena_t *a, size_t size);
+void *ucalloc_in(uarena_t *a, size_t nmemb, size_t size);
+void *urealloc_in(uarena_t *a, void *ptr, size_t old_size, size_t size);
+void ufree_in(uarena_t *a, void *ptr);
+
 #define BUFFER_INITIAL_CAPACITY 16
+#define BUFFER_SINK_BLOCK_SIZE (64 * 1024)
+
+// Consumer of the buffered data, returns false on failure.
+typedef bool (*ubuffer_sink_t)(const void *data, size_t size, void *ctx);
 
 // Handy abstraction for simple memory buffer operations, was not intended to
 // be fully opaque so all the fields are public.
+// Buffer with a sink attached doesn't grow past its block size, instead it
+// hands the accumulated data over to the sink whenever it runs out of space.
 typedef struct {
     void *data;
     size_t data_size;
     size_t capacity;
+    ubuffer_sink_t sink;
+    void *sink_ctx;
 } ubuffer_t;
 
 // Just for simplifying passing pointer together with size of the data it
@@ -41,6 +212,9 @@ void ubuffer_append_buffer(ubuffer_t *buf, const ubuffer_t *data);
 void ubuffer_append_byte(ubuffer_t *buf, char byte);
 void ubuffer_append_string(ubuffer_t *buf, const char *str);
 void ubuffer_null_terminate(ubuffer_t *buf);
+void ubuffer_attach_sink(ubuffer_t *buf, ubuffer_sink_t sink, void *ctx);
+bool ubuffer_flush(ubuffer_t *buf);
+bool ubuffer_file_sink(const void *data, size_t size, void *ctx);
 
 static inline void ubuffer_reset(ubuffer_t *buf)   {buf->data_size = 0;}
 static inline void ubuffer_destroy(ubuffer_t *buf) {ufree(buf->data);}
@@ -48,6 +222,11 @@ static inline void ubuffer_destroy(ubuffer_t *buf) {ufree(buf->data);}
 char *umemchunk_as_str(umemchunk_t m);
 void umemchunk_serialize(umemchunk_t m, ubuffer_t *buf);
 int umemchunk_fprint(umemchunk_t m, FILE *out);
+
+// Streams whatever serializer puts to a buffer for obj to out followed by a
+// new line, memory usage doesn't depend on the size of the output.
+typedef void (*ubuffer_s8r_t)(const void *obj, ubuffer_t *buf);
+int ubuffer_fprint_serialized(ubuffer_s8r_t s8r, const void *obj, FILE *out);
 static inline int umemchunk_print(umemchunk_t m) {return umemchunk_fprint(m, stdout);}
 
 #endif
@@ -0,0 +1,18 @@
+#ifndef UNUM_UTILS_H__
+#define UNUM_UTILS_H__
+
+#include "generic.h"
+
+// Enough room for any output of the formatters below, no '\0' is written.
+#define UNUM_MAX_FORMATTED_LEN 32
+
+size_t unum_format_long(long v, char *out);
+size_t unum_format_size(size_t v, char *out);
+size_t unum_format_real(double v, char *out);
+
+// Parses a JSON-like number at *str and advances *str past it on success.
+// Integers yield G_INT (or G_SIZE when too big for long), anything with a
+// fraction or exponent yields a correctly rounded G_REAL.
+ugeneric_t unum_parse(const char **str);
+
+#endif
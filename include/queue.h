@@ -8,6 +8,7 @@
 typedef struct uqueue_opaq uqueue_t;
 
 uqueue_t *uqueue_create(void);
+uqueue_t *uqueue_create_ext(const uallocator_t *allocator);
 void uqueue_destroy(uqueue_t *q);
 void uqueue_reserve_capacity(uqueue_t *q, size_t new_capacity);
 void uqueue_clear(uqueue_t *q);
@@ -27,6 +28,7 @@ static void uqueue_take_data_ownership(uqueue_t *q);
 static void uqueue_drop_data_ownership(uqueue_t *q);
 static bool uqueue_is_data_owner(uqueue_t *q);
 
+umem_usage_t uqueue_get_memory_usage(const uqueue_t *q);
 ugeneric_base_t *uqueue_get_base(uqueue_t *q);
 DEFINE_BASE_FUNCS(uqueue, q)
 
@@ -0,0 +1,38 @@
+#ifndef UROPE_H__
+#define UROPE_H__
+
+#include "generic.h"
+
+/*
+ * Output buffer made of a chain of segments. Appending never moves the data
+ * which is already there: when the last segment is full a new one is added,
+ * so building a huge output costs no reallocation copies. Segments can be
+ * handed to writev() as they are (see ufile_writer_write_rope()).
+ *
+ * A rope can also back an ordinary ubuffer_t, so any serializer writes
+ * directly into its segments: every time the buffer fills up its block is
+ * taken over by the rope as is and the buffer gets a fresh one.
+ */
+#define ROPE_DEFAULT_SEGMENT_SIZE (64 * 1024)
+
+typedef struct urope_opaq urope_t;
+
+urope_t *urope_create(void);
+urope_t *urope_create_with_segment_size(size_t segment_size);
+void urope_clear(urope_t *r);
+void urope_destroy(urope_t *r);
+
+void urope_append_data(urope_t *r, const void *data, size_t size);
+void urope_append_string(urope_t *r, const char *str);
+size_t urope_get_size(const urope_t *r);
+size_t urope_get_segment_count(const urope_t *r);
+umemchunk_t urope_get_segment(const urope_t *r, size_t i);
+char *urope_as_str(const urope_t *r);
+
+void urope_attach_buffer(urope_t *r, ubuffer_t *buf);
+void urope_detach_buffer(urope_t *r, ubuffer_t *buf);
+
+void urope_serialize_v(urope_t *r, ugeneric_t g, void_s8r_t void_serializer);
+#define urope_serialize(r, g) urope_serialize_v(r, g, NULL)
+
+#endif
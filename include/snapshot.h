@@ -0,0 +1,34 @@
+#ifndef USNAPSHOT_H__
+#define USNAPSHOT_H__
+
+#include "generic.h"
+
+/*
+ * Relocatable on-disk image of a generic (usually a vector or a dict) that is
+ * opened with mmap() instead of being parsed. All references inside of the
+ * image are offsets from its beginning, sections are 8-byte aligned, dicts
+ * carry their own open addressing hash index. The image uses host byte order
+ * and type sizes, it is not meant to be moved between different platforms.
+ *
+ * Items obtained from an opened snapshot point into the read-only mapping:
+ * strings come as G_CSTR, memchunks as G_MEMCHUNK and vectors and dicts as
+ * G_CPTR handles to be passed to the accessors below. None of them may be
+ * modified or destroyed and all of them become invalid after the snapshot
+ * is closed, use usnapshot_load() to get an ordinary independent copy.
+ */
+typedef struct usnapshot_opaq usnapshot_t;
+
+ugeneric_t usnapshot_write(const char *path, ugeneric_t g);
+ugeneric_t usnapshot_open(const char *path);
+ugeneric_t usnapshot_close(usnapshot_t *s);
+
+ugeneric_t usnapshot_get_root(const usnapshot_t *s);
+ugeneric_type_e usnapshot_get_type(const usnapshot_t *s, ugeneric_t item);
+size_t usnapshot_get_size(const usnapshot_t *s, ugeneric_t container);
+ugeneric_t usnapshot_vector_get_at(const usnapshot_t *s, ugeneric_t v, size_t i);
+ugeneric_kv_t usnapshot_dict_get_at(const usnapshot_t *s, ugeneric_t d, size_t i);
+ugeneric_t usnapshot_dict_get(const usnapshot_t *s, ugeneric_t d, ugeneric_t k,
+                              ugeneric_t vdef);
+ugeneric_t usnapshot_load(const usnapshot_t *s, ugeneric_t item);
+
+#endif
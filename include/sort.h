@@ -4,6 +4,8 @@
 #include "generic.h"
 
 #define USORT_HYBRID_THRESHOLD 4
+#define USORT_RADIX_THRESHOLD 64
+#define USORT_PARALLEL_CUTOFF (16 * 1024) // min elements per thread
 
 void quick_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
 void merge_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
@@ -12,4 +14,62 @@ void selection_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
 size_t count_inversions(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
 void hybrid_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
 
+/*
+ * Pattern-defeating quicksort: O(n log n) worst case (heapsort fallback),
+ * O(log n) stack, linear on sorted, reversed and all-equal input. Not stable.
+ */
+void pdq_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
+
+/*
+ * Adaptive stable merge sort (TimSort): O(n) on sorted or reversed input and
+ * on a few runs, O(n log n) worst case, at most n / 2 scratch space.
+ */
+void tim_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
+
+/*
+ * Stable O(n * k) sort of arrays made of only G_INT, only G_SIZE or only
+ * G_REAL (LSD radix on 64 bit keys) or of only strings (MSD radix on bytes).
+ * Anything else is handed to pdq_sort().
+ */
+void radix_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
+
+/*
+ * Stable sort by keys extracted once per item: key() is called n times rather
+ * than the comparator n log n times, then compact records of an 8 byte key
+ * prefix and the original position are sorted and items are moved once. Keys
+ * must be all numbers of one type or all strings, they are borrowed and have
+ * to stay valid during the call. NULL key uses items themselves as keys.
+ */
+void key_sort(ugeneric_t *base, size_t nmemb, ugeneric_key_fn_t key);
+
+// Sorts an array of strings caching their 8 byte prefixes (see key_sort()),
+// anything else is handed to pdq_sort().
+void prefix_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
+
+/*
+ * Sorts runs on nthreads threads and merges them pairwise in parallel. Zero
+ * threads means one per online CPU, small arrays are sorted on the calling
+ * thread. The comparator is called concurrently, so it has to be thread safe.
+ */
+void parallel_sort_ext(ugeneric_t *base, size_t nmemb, void_cmp_t cmp,
+                       size_t nthreads);
+void parallel_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
+
+/*
+ * Selection. nth_element() moves the element which would be at position n in
+ * sorted order there, with nothing greater before it and nothing less after
+ * it, in O(n) on average (Floyd-Rivest introselect, O(n log n) worst case).
+ * partial_sort() puts the k smallest elements sorted in front in
+ * O(n + k log k), top_k() the k greatest ones in descending order using a
+ * bounded heap, O(n log k). The rest of the array is left in no particular
+ * order.
+ */
+void nth_element(ugeneric_t *base, size_t nmemb, size_t n, void_cmp_t cmp);
+void partial_sort(ugeneric_t *base, size_t nmemb, size_t k, void_cmp_t cmp);
+void top_k(ugeneric_t *base, size_t nmemb, size_t k, void_cmp_t cmp);
+// top_k() of parts on nthreads threads (see parallel_sort_ext()), then of
+// their winners.
+void parallel_top_k(ugeneric_t *base, size_t nmemb, size_t k, void_cmp_t cmp,
+                    size_t nthreads);
+
 #endif
@@ -0,0 +1,46 @@
+#ifndef USORTED_INDEX_H__
+#define USORTED_INDEX_H__
+
+#include "generic.h"
+#include "mem.h"
+#include "tvector.h"
+#include "vector.h"
+
+/*
+ * Read-only search index over a sorted vector. Items are laid out in
+ * Eytzinger (breadth-first) order, so the first levels of every search share
+ * a few cache lines and the next ones are prefetched while the current one is
+ * compared, the descent itself has no unpredictable branches. Vectors of only
+ * G_INT or only G_SIZE items (and typed ones) keep plain 64 bit keys, anything
+ * else keeps the cells, which have to outlive the index. Results are positions
+ * in the source vector. Query keys of other types are compared as
+ * ugeneric_compare() does, on a slower path.
+ */
+#define USORTED_INDEX_BATCH 8 // searches interleaved by the batch lookups
+
+typedef struct usorted_index_opaq usorted_index_t;
+
+usorted_index_t *usorted_index_create(const uvector_t *v);
+usorted_index_t *usorted_index_create_from_i64(const uvector_i64_t *v);
+usorted_index_t *usorted_index_create_from_size(const uvector_size_t *v);
+void usorted_index_destroy(usorted_index_t *si);
+size_t usorted_index_get_size(const usorted_index_t *si);
+
+// First position with item not less than e (greater than e), size if none.
+size_t usorted_index_lower_bound(const usorted_index_t *si, ugeneric_t e);
+size_t usorted_index_upper_bound(const usorted_index_t *si, ugeneric_t e);
+// Position of the first item equal to e, SIZE_MAX if there is none.
+size_t usorted_index_find(const usorted_index_t *si, ugeneric_t e);
+bool usorted_index_contains(const usorted_index_t *si, ugeneric_t e);
+// Number of items in [lo, hi), the first one is at *first.
+size_t usorted_index_get_range(const usorted_index_t *si, ugeneric_t lo,
+                               ugeneric_t hi, size_t *first);
+
+// Lower bounds of n keys at once, cache misses of several searches overlap.
+void usorted_index_lower_bound_batch(const usorted_index_t *si,
+                                     const ugeneric_t *keys, size_t n,
+                                     size_t *positions);
+
+umem_usage_t usorted_index_get_memory_usage(const usorted_index_t *si);
+
+#endif
@@ -6,6 +6,7 @@
 typedef struct ustack_opaq ustack_t;
 
 ustack_t *ustack_create(void);
+ustack_t *ustack_create_ext(const uallocator_t *allocator);
 void ustack_destroy(ustack_t *s);
 ugeneric_t ustack_pop(ustack_t *s);
 ugeneric_t ustack_peek(const ustack_t *s);
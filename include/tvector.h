@@ -0,0 +1,79 @@
+#ifndef UTVECTOR_H__
+#define UTVECTOR_H__
+
+#include "generic.h"
+#include "vector.h"
+
+/*
+ * Unboxed vectors of scalars. Cells are plain C values instead of 16 byte
+ * generics, so the data takes half the memory (or less) and can be handed to
+ * anything working on ordinary arrays. All of them are generated from one
+ * template and follow the uvector API, elements are passed by value.
+ *
+ * Numbers of any type can be converted to a typed vector as long as they are
+ * kept exactly, otherwise (or for anything but a number) _from_uvector() and
+ * _create_from_raw_array() return NULL. The latter imports arrays described
+ * as for uvector_create_from_array(): signed integers for G_INT_T, unsigned
+ * ones for G_SIZE_T and floats or doubles for G_REAL_T, of any width.
+ *
+ *   uvector_i64_t  - int64_t, G_INT
+ *   uvector_f64_t  - double,  G_REAL
+ *   uvector_size_t - size_t,  G_SIZE
+ */
+#define DECLARE_TYPED_VECTOR(_name_, _type_)                                   \
+typedef struct _name_##_opaq _name_##_t;                                       \
+                                                                               \
+_name_##_t *_name_##_create(void);                                             \
+_name_##_t *_name_##_create_ext(const uallocator_t *allocator);                \
+_name_##_t *_name_##_create_with_size(size_t size, _type_ value);              \
+_name_##_t *_name_##_create_from_array(const _type_ *array, size_t array_len); \
+_name_##_t *_name_##_create_from_raw_array(const void *array, size_t array_len,\
+                                           size_t array_element_size,          \
+                                           ugeneric_type_e array_element_type);\
+void _name_##_clear(_name_##_t *v);                                            \
+void _name_##_destroy(_name_##_t *v);                                          \
+                                                                               \
+_name_##_t *_name_##_copy(const _name_##_t *v);                                \
+int _name_##_compare(const _name_##_t *v1, const _name_##_t *v2);              \
+                                                                               \
+void _name_##_append(_name_##_t *v, _type_ e);                                 \
+void _name_##_insert_at(_name_##_t *v, size_t i, _type_ e);                    \
+void _name_##_remove_at(_name_##_t *v, size_t i);                              \
+_type_ _name_##_pop_back(_name_##_t *v);                                       \
+_type_ _name_##_get_at(const _name_##_t *v, size_t i);                         \
+_type_ _name_##_get_back(const _name_##_t *v);                                 \
+void _name_##_set_at(_name_##_t *v, size_t i, _type_ e);                       \
+_type_ *_name_##_get_cells(const _name_##_t *v);                               \
+_type_ *_name_##_find(_name_##_t *v, _type_ e);                                \
+bool _name_##_contains(const _name_##_t *v, _type_ e);                         \
+                                                                               \
+bool _name_##_is_empty(const _name_##_t *v);                                   \
+size_t _name_##_get_size(const _name_##_t *v);                                 \
+void _name_##_resize(_name_##_t *v, size_t new_size, _type_ value);            \
+void _name_##_shrink_to_size(_name_##_t *v);                                   \
+void _name_##_reserve_capacity(_name_##_t *v, size_t new_capacity);            \
+size_t _name_##_get_capacity(const _name_##_t *v);                             \
+const uallocator_t *_name_##_get_allocator(const _name_##_t *v);               \
+                                                                               \
+void _name_##_reverse(_name_##_t *v);                                          \
+void _name_##_sort(_name_##_t *v);                                             \
+bool _name_##_is_sorted(const _name_##_t *v);                                  \
+size_t _name_##_bsearch(const _name_##_t *v, _type_ e);                        \
+                                                                               \
+uvector_t *_name_##_to_uvector(const _name_##_t *v);                           \
+_name_##_t *_name_##_from_uvector(const uvector_t *v);                         \
+                                                                               \
+char *_name_##_as_str(const _name_##_t *v);                                    \
+void _name_##_serialize(const _name_##_t *v, ubuffer_t *buf);                  \
+int _name_##_fprint(const _name_##_t *v, FILE *out);                           \
+static inline int _name_##_print(const _name_##_t *v)                          \
+{                                                                              \
+    return _name_##_fprint(v, stdout);                                         \
+}                                                                              \
+umem_usage_t _name_##_get_memory_usage(const _name_##_t *v);
+
+DECLARE_TYPED_VECTOR(uvector_i64, int64_t)
+DECLARE_TYPED_VECTOR(uvector_f64, double)
+DECLARE_TYPED_VECTOR(uvector_size, size_t)
+
+#endif
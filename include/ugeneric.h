@@ -8,15 +8,21 @@ extern "C" {
 #include "bst.h"
 #include "dict.h"
 #include "dsu.h"
+#include "extsort.h"
 #include "file_utils.h"
 #include "heap.h"
 #include "htbl.h"
 #include "list.h"
 #include "mem.h"
+#include "num_utils.h"
 #include "queue.h"
+#include "rope.h"
 #include "set.h"
+#include "snapshot.h"
 #include "sort.h"
+#include "sorted_index.h"
 #include "string_utils.h"
+#include "tvector.h"
 #include "vector.h"
 
 #if defined(__cplusplus)
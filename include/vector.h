@@ -8,6 +8,8 @@
 typedef struct uvector_opaq uvector_t;
 
 uvector_t *uvector_create(void);
+uvector_t *uvector_create_ext(const uallocator_t *allocator);
+uvector_t *uvector_create_with_arena(uarena_t *arena);
 uvector_t *uvector_create_with_size(size_t size, ugeneric_t value);
 uvector_t *uvector_create_from_array(void *array, size_t array_len,
                                      size_t array_element_size,
@@ -17,6 +19,15 @@ void uvector_destroy(uvector_t *v);
 
 uvector_t *uvector_copy(const uvector_t *v);
 uvector_t *uvector_deep_copy(const uvector_t *v);
+/*
+ * O(1) copy sharing cells with v until either of them is modified, then that
+ * one gets cells of its own: a deep copy if it owns the data, a shallow one
+ * otherwise. Vectors sharing cells may be read, copied and destroyed from
+ * different threads, making the first copy of a vector counts as modifying
+ * it. Ownership and handlers should be set before sharing, cells obtained
+ * with uvector_get_cells() are read-only while shared.
+ */
+uvector_t *uvector_cow_copy(const uvector_t *v);
 int uvector_compare(const uvector_t *v1, const uvector_t *v2);
 
 void uvector_append(uvector_t *v, ugeneric_t e);
@@ -32,7 +43,15 @@ ugeneric_t uvector_get_at_random(const uvector_t *v);
 void uvector_set_at(uvector_t *v, size_t i, ugeneric_t e);
 ugeneric_t *uvector_get_cells(const uvector_t *v);
 bool uvector_contains(const uvector_t *v, ugeneric_t e);
+// Pointer to the first item equal to e (NULL if none), v stops sharing its
+// cells when there is one, so it may be written through.
 ugeneric_t *uvector_find(uvector_t *v, ugeneric_t e);
+size_t uvector_count(const uvector_t *v, ugeneric_t e);
+// Vector of G_SIZE positions of items equal to e.
+uvector_t *uvector_find_all(const uvector_t *v, ugeneric_t e);
+// Counts parts on nthreads threads, zero means one per online CPU. The void
+// comparator, if any, is called concurrently.
+size_t uvector_count_parallel(const uvector_t *v, ugeneric_t e, size_t nthreads);
 
 bool uvector_is_empty(const uvector_t *v);
 size_t uvector_get_size(const uvector_t *v);
@@ -44,12 +63,60 @@ size_t uvector_get_capacity(const uvector_t *v);
 uvector_t *uvector_get_slice(const uvector_t *v, size_t begin, size_t end,
                              size_t stride);
 
+/*
+ * Read-only window over every stride-th cell of [begin, end) of a vector.
+ * Taking a view (or a view of a view) is O(1), nothing is allocated or
+ * copied, so views are passed around by value. A view is valid as long as
+ * the vector it looks at isn't modified or destroyed, items stay owned by
+ * the vector. Items are visited with uvector_view_get_at() over
+ * [0, view.size).
+ */
+typedef struct {
+    const ugeneric_t *cells;
+    size_t size;
+    size_t stride;
+    uvoid_handlers_t void_handlers;
+    const uallocator_t *allocator;
+} uvector_view_t;
+
+uvector_view_t uvector_get_view(const uvector_t *v, size_t begin, size_t end,
+                                size_t stride);
+uvector_view_t uvector_view_get_view(const uvector_view_t *w, size_t begin,
+                                     size_t end, size_t stride);
+size_t uvector_view_get_size(const uvector_view_t *w);
+bool uvector_view_is_empty(const uvector_view_t *w);
+ugeneric_t uvector_view_get_at(const uvector_view_t *w, size_t i);
+// Positions are in the view, SIZE_MAX if there is no such item.
+size_t uvector_view_find(const uvector_view_t *w, ugeneric_t e);
+bool uvector_view_contains(const uvector_view_t *w, ugeneric_t e);
+size_t uvector_view_bsearch(const uvector_view_t *w, ugeneric_t e);
+// Appends the items to out in sorted order. They are still owned by the
+// source, out shouldn't own its data and can't be what the view looks at.
+void uvector_view_sort_into(const uvector_view_t *w, uvector_t *out);
+// Vector of the items, same as uvector_get_slice() of the source.
+uvector_t *uvector_view_to_vector(const uvector_view_t *w);
+char *uvector_view_as_str(const uvector_view_t *w);
+void uvector_view_serialize(const uvector_view_t *w, ubuffer_t *buf);
+
 void uvector_swap(uvector_t *v, size_t l, size_t r);
 void uvector_reverse(uvector_t *v);
 void uvector_reverse_range(uvector_t *v, size_t l, size_t r);
 void uvector_sort(uvector_t *v);
+void uvector_sort_parallel(uvector_t *v, size_t nthreads);
+void uvector_sort_by_key(uvector_t *v, ugeneric_key_fn_t key);
+void uvector_set_sorter(uvector_t *v, ugeneric_sorter_t sorter);
 bool uvector_is_sorted(const uvector_t *v);
+// See nth_element(), partial_sort() and top_k().
+void uvector_nth_element(uvector_t *v, size_t n);
+void uvector_partial_sort(uvector_t *v, size_t k);
+void uvector_top_k(uvector_t *v, size_t k);
+void uvector_top_k_parallel(uvector_t *v, size_t k, size_t nthreads);
 size_t uvector_bsearch(const uvector_t *v, ugeneric_t e);
+// Drop repeated items (destroyed if v owns them). uvector_unique() keeps the
+// first occurrences in their order, items have to be hashable. The sorted
+// variant sorts v first and works with anything comparable.
+void uvector_unique(uvector_t *v);
+void uvector_unique_sorted(uvector_t *v);
 bool uvector_next_permutation(uvector_t *v);
 
 static void uvector_take_data_ownership(uvector_t *v);
@@ -70,6 +137,7 @@ typedef struct {
 void uvector_dump_to_gnuplot(const uvector_t *v, gnuplot_attrs_t *attrs,
                              FILE *out);
 
+umem_usage_t uvector_get_memory_usage(const uvector_t *v);
 ugeneric_base_t *uvector_get_base(uvector_t *v);
 DEFINE_BASE_FUNCS(uvector, v)
 
@@ -24,6 +24,8 @@ typedef bool (*ubst_node_cb_t)(ubst_node_t *node, void *data);
 struct ubst_opaq {
     uvoid_handlers_t void_handlers;
     bool is_data_owner;
+    const uallocator_t *allocator;
+    upool_t *nodes;
     ubst_node_t *root;
     ubst_balancing_mode_t balancing_mode;
     size_t size;
@@ -31,6 +33,7 @@ struct ubst_opaq {
 
 struct ubst_iterator_opaq {
     const ubst_t *bst;
+    const uallocator_t *allocator;
     ustack_t *stack;
     ubst_node_t *node;
 };
@@ -160,18 +163,14 @@ static ubst_node_t **_get_inorder_successor(ubst_t *b, ubst_node_t **node)
     return successor;
 }
 
-void _ubst_nodes_destroy(ubst_t *b, ubst_node_t *node)
+void _ubst_nodes_destroy_data(ubst_t *b, ubst_node_t *node)
 {
     if (node)
     {
-        _ubst_nodes_destroy(b, node->left);
-        _ubst_nodes_destroy(b, node->right);
-        if (b->is_data_owner)
-        {
-            ugeneric_destroy_v(node->k, b->void_handlers.dtr);
-            ugeneric_destroy_v(node->v, b->void_handlers.dtr);
-        }
-        ufree(node);
+        _ubst_nodes_destroy_data(b, node->left);
+        _ubst_nodes_destroy_data(b, node->right);
+        ugeneric_destroy_v(node->k, b->void_handlers.dtr);
+        ugeneric_destroy_v(node->v, b->void_handlers.dtr);
     }
 }
 
@@ -287,9 +286,9 @@ static ubst_node_t *_rotate_right_twice(ubst_node_t *node)
     return _rotate_right_once(node);
 }
 
-static ubst_node_t *_make_new_node(ugeneric_t k, ugeneric_t v)
+static ubst_node_t *_make_new_node(ubst_t *b, ugeneric_t k, ugeneric_t v)
 {
-    ubst_node_t *n = umalloc(sizeof(*n));
+    ubst_node_t *n = upool_alloc(b->nodes);
     n->k = k;
     n->v = v;
     n->left = NULL;
@@ -305,15 +304,18 @@ static void _put_not_balanced(ubst_t *b, ugeneric_t k, ugeneric_t v)
     if (*node)
     {
         /* Update case. */
-        ugeneric_destroy_v((*node)->k, b->void_handlers.dtr);
-        ugeneric_destroy_v((*node)->v, b->void_handlers.dtr);
+        if (b->is_data_owner)
+        {
+            ugeneric_destroy_v((*node)->k, b->void_handlers.dtr);
+            ugeneric_destroy_v((*node)->v, b->void_handlers.dtr);
+        }
         (*node)->k = k;
         (*node)->v = v;
     }
     else
     {
         /* Insert case. */
-        *node = _make_new_node(k, v);
+        *node = _make_new_node(b, k, v);
         b->size += 1;
     }
 }
@@ -344,7 +346,7 @@ static void _put_red_black(ubst_t *b, ugeneric_t k, ugeneric_t v)
     {
         if (!x)
         {
-            *npos = x = _make_new_node(k, v);
+            *npos = x = _make_new_node(b, k, v);
             inserted = true;
         }
 
@@ -402,8 +404,11 @@ static void _put_red_black(ubst_t *b, ugeneric_t k, ugeneric_t v)
         else
         {
             // Found the node to be updated, update and get out of here.
-            ugeneric_destroy_v(p->k, b->void_handlers.dtr);
-            ugeneric_destroy_v(p->v, b->void_handlers.dtr);
+            if (b->is_data_owner)
+            {
+                ugeneric_destroy_v(p->k, b->void_handlers.dtr);
+                ugeneric_destroy_v(p->v, b->void_handlers.dtr);
+            }
             p->k = k;
             p->v = v;
             break;
@@ -480,7 +485,7 @@ static ugeneric_t _pop_not_balanced(ubst_t *b, ugeneric_t k, ugeneric_t vdef)
             /* Case 2: no child nodes, just delete the node. */
             if (!(*pos)->left && !(*pos)->right)
             {
-                ufree(*pos); // free node
+                upool_free(b->nodes, *pos); // free node
                 *pos = NULL; // clear pointer in the parent node
             }
             /* Case 3: one child */
@@ -488,13 +493,13 @@ static ugeneric_t _pop_not_balanced(ubst_t *b, ugeneric_t k, ugeneric_t vdef)
             {
                 ubst_node_t *t = *pos;
                 *pos = (*pos)->right;
-                ufree(t);
+                upool_free(b->nodes, t);
             }
             else if (!(*pos)->right)
             {
                 ubst_node_t *t = *pos;
                 *pos = (*pos)->left;
-                ufree(t);
+                upool_free(b->nodes, t);
             }
             else
             {
@@ -514,13 +519,17 @@ static ugeneric_t _pop_splay(ubst_t *b, ugeneric_t k, ugeneric_t vdef)
     UABORT("not implemented");
 }
 
-ubst_t *ubst_create_ext(ubst_balancing_mode_t mode)
+ubst_t *ubst_create_ext(ubst_balancing_mode_t mode,
+                        const uallocator_t *allocator)
 {
     UASSERT_INPUT(mode >= UBST_DEFAULT_BALANCING);
     UASSERT_INPUT(mode < UBST_BALANCING_MODES_COUNT);
 
-    ubst_t *b = umalloc(sizeof(*b));
+    allocator = allocator ? allocator : uallocator_get_default();
+    ubst_t *b = uallocator_alloc(allocator, sizeof(*b));
 
+    b->allocator = allocator;
+    b->nodes = upool_create(sizeof(ubst_node_t), allocator);
     b->root = NULL;
     b->size = 0;
     b->is_data_owner = true;
@@ -538,9 +547,14 @@ ubst_t *ubst_create_ext(ubst_balancing_mode_t mode)
     return b;
 }
 
+ubst_t *ubst_create_with_arena(ubst_balancing_mode_t mode, uarena_t *arena)
+{
+    return ubst_create_ext(mode, arena ? uarena_get_allocator(arena) : NULL);
+}
+
 ubst_t *ubst_create(void)
 {
-    return ubst_create_ext(UBST_DEFAULT_BALANCING);
+    return ubst_create_ext(UBST_DEFAULT_BALANCING, NULL);
 }
 
 void ubst_put(ubst_t *b, ugeneric_t k, ugeneric_t v)
@@ -639,15 +653,21 @@ void ubst_destroy(ubst_t *b)
 {
     if (b)
     {
-        _ubst_nodes_destroy(b, b->root);
-        ufree(b);
+        ubst_clear(b);
+        upool_destroy(b->nodes);
+        uallocator_free(b->allocator, b, sizeof(*b));
     }
 }
 
 void ubst_clear(ubst_t *b)
 {
     UASSERT_INPUT(b);
-    _ubst_nodes_destroy(b, b->root);
+    if (b->is_data_owner)
+    {
+        _ubst_nodes_destroy_data(b, b->root);
+    }
+    // All the nodes go away with their slabs.
+    upool_reset(b->nodes);
     b->root = NULL;
     b->size = 0;
 }
@@ -742,20 +762,17 @@ int ubst_fprint(const ubst_t *b, FILE *out)
     UASSERT_INPUT(b);
     UASSERT_INPUT(out);
 
-    char *str = ubst_as_str(b);
-    int ret = fprintf(out, "%s\n", str);
-    ufree(str);
-
-    return ret;
+    return ubuffer_fprint_serialized((ubuffer_s8r_t)ubst_serialize, b, out);
 }
 
 ubst_iterator_t *ubst_iterator_create(const ubst_t *b)
 {
     UASSERT_INPUT(b);
 
-    ubst_iterator_t *bi = umalloc(sizeof(*bi));
+    ubst_iterator_t *bi = uallocator_alloc(b->allocator, sizeof(*bi));
     bi->bst = b;
-    bi->stack = ustack_create();
+    bi->allocator = b->allocator;
+    bi->stack = ustack_create_ext(b->allocator);
     ustack_drop_data_ownership(bi->stack);
     bi->node = b->root;
     return bi;
@@ -826,10 +843,38 @@ void ubst_iterator_destroy(ubst_iterator_t *bi)
     if (bi)
     {
         ustack_destroy(bi->stack);
-        ufree(bi);
+        uallocator_free(bi->allocator, bi, sizeof(*bi));
     }
 }
 
+ugeneric_base_t *ubst_get_base(ubst_t *b)
+{
+    UASSERT_INPUT(b);
+    return (ugeneric_base_t *)b;
+}
+
+static bool _add_payload(ugeneric_t k, ugeneric_t v, void *data)
+{
+    size_t *payload = data;
+    *payload += ugeneric_get_memory_usage(k) + ugeneric_get_memory_usage(v);
+    return false;
+}
+
+umem_usage_t ubst_get_memory_usage(const ubst_t *b)
+{
+    UASSERT_INPUT(b);
+
+    umem_usage_t u = {0};
+    u.header = sizeof(*b);
+    u.nodes = upool_get_allocated_size(b->nodes);
+    if (b->is_data_owner)
+    {
+        ubst_traverse(b, UBST_INORDER, _add_payload, &u.payload);
+    }
+
+    return u;
+}
+
 uvector_t *ubst_get_items(const ubst_t *b, udict_items_kind_t kind, bool deep)
 {
     UASSERT_INPUT(b);
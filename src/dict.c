@@ -20,6 +20,7 @@ static const udict_vtable_t _uhtbl_vtable = {
     .fprint              = (f_udict_fprint)uhtbl_fprint,
     .get_base            = (f_udict_get_base)uhtbl_get_base,
     .get_items           = (f_udict_get_items)uhtbl_get_items,
+    .get_memory_usage    = (f_udict_get_memory_usage)uhtbl_get_memory_usage,
 };
 
 static const udict_vtable_t _ubst_vtable = {
@@ -34,8 +35,9 @@ static const udict_vtable_t _ubst_vtable = {
     .serialize           = (f_udict_serialize)ubst_serialize,
     .as_str              = (f_udict_as_str)ubst_as_str,
     .fprint              = (f_udict_fprint)ubst_fprint,
-    .get_base            = (f_udict_get_base)uhtbl_get_base,
+    .get_base            = (f_udict_get_base)ubst_get_base,
     .get_items           = (f_udict_get_items)ubst_get_items,
+    .get_memory_usage    = (f_udict_get_memory_usage)ubst_get_memory_usage,
 };
 
 static const udict_iterator_vtable_t _uhtbl_iterator_vtable = {
@@ -72,28 +74,41 @@ udict_t *udict_create(void)
 }
 
 udict_t *udict_create_with_backend(udict_backend_t backend)
+{
+    return udict_create_ext(backend, NULL);
+}
+
+udict_t *udict_create_with_arena(udict_backend_t backend, uarena_t *arena)
+{
+    return udict_create_ext(backend, arena ? uarena_get_allocator(arena) : NULL);
+}
+
+udict_t *udict_create_ext(udict_backend_t backend, const uallocator_t *allocator)
 {
     UASSERT_INPUT(backend >= UDICT_BACKEND_DEFAULT);
     UASSERT_INPUT(backend < UDICT_BACKEND_MAX);
 
-    udict_t *d = umalloc(sizeof(*d));
+    allocator = allocator ? allocator : uallocator_get_default();
+    udict_t *d = uallocator_alloc(allocator, sizeof(*d));
+    d->allocator = allocator;
+    d->refs = NULL;
     d->backend = (backend == UDICT_BACKEND_DEFAULT) ? _default_backend : backend;
     switch (d->backend)
     {
         case UDICT_BACKEND_HTBL_WITH_CHAINING:
-            d->vobj = uhtbl_create_with_type(UHTBL_TYPE_CHAINING);
+            d->vobj = uhtbl_create_ext(UHTBL_TYPE_CHAINING, allocator);
             d->vtable = &_uhtbl_vtable;
             break;
         case UDICT_BACKEND_HTBL_WITH_OPEN_ADDRESSING:
-            d->vobj = uhtbl_create_with_type(UHTBL_TYPE_OPEN_ADDRESSING);
+            d->vobj = uhtbl_create_ext(UHTBL_TYPE_OPEN_ADDRESSING, allocator);
             d->vtable = &_uhtbl_vtable;
             break;
         case UDICT_BACKEND_BST_PLAIN:
-            d->vobj = ubst_create_ext(UBST_NO_BALANCING);
+            d->vobj = ubst_create_ext(UBST_NO_BALANCING, allocator);
             d->vtable = &_ubst_vtable;
             break;
         case UDICT_BACKEND_BST_RB:
-            d->vobj = ubst_create_ext(UBST_RB_BALANCING);
+            d->vobj = ubst_create_ext(UBST_RB_BALANCING, allocator);
             d->vtable = &_ubst_vtable;
             break;
         default:
@@ -117,10 +132,8 @@ void udict_update(udict_t *d, udict_t *update)
     udict_iterator_destroy(di);
 }
 
-void udict_destroy(udict_t *d)
+static void _destroy_vobj(udict_t *d)
 {
-    UASSERT_INPUT(d);
-
     switch (d->backend)
     {
         case UDICT_BACKEND_HTBL_WITH_CHAINING:
@@ -134,14 +147,68 @@ void udict_destroy(udict_t *d)
         default:
             UABORT("internal error");
     }
-    ufree(d);
+    d->vobj = NULL;
+}
+
+/*
+ * Copy-on-write: copies made by udict_cow_copy() point to the same backend
+ * object and count references to it. Whatever is about to change it first
+ * gets the dict an object of its own, the last dict to let go of a shared
+ * one destroys it.
+ */
+static bool _release_vobj(udict_t *d)
+{
+    bool last = true;
+    if (d->refs)
+    {
+        last = (atomic_fetch_sub(d->refs, 1) == 1);
+        if (last)
+        {
+            uallocator_free(d->allocator, d->refs, sizeof(*d->refs));
+        }
+        d->refs = NULL;
+    }
+
+    return last;
+}
+
+// Lets go of the object of d and takes the one of the dict with.
+static void _replace_vobj(udict_t *d, udict_t *with)
+{
+    if (_release_vobj(d))
+    {
+        _destroy_vobj(d);
+    }
+    d->vobj = with->vobj;
+    uallocator_free(with->allocator, with, sizeof(*with));
+}
+
+void udict_destroy(udict_t *d)
+{
+    UASSERT_INPUT(d);
+
+    if (_release_vobj(d))
+    {
+        _destroy_vobj(d);
+    }
+    uallocator_free(d->allocator, d, sizeof(*d));
+}
+
+umem_usage_t udict_get_memory_usage(const udict_t *d)
+{
+    UASSERT_INPUT(d);
+
+    umem_usage_t u = d->vtable->get_memory_usage(d->vobj);
+    u.header += sizeof(*d);
+
+    return u;
 }
 
 udict_iterator_t *udict_iterator_create(const udict_t *d)
 {
     UASSERT_INPUT(d);
 
-    udict_iterator_t *di = umalloc(sizeof(*di));
+    udict_iterator_t *di = uallocator_alloc(d->allocator, sizeof(*di));
     di->dict = d;
     switch (d->backend)
     {
@@ -179,7 +246,7 @@ void udict_iterator_destroy(udict_iterator_t *di)
             default:
                 UABORT("internal error");
         }
-        ufree(di);
+        uallocator_free(di->dict->allocator, di, sizeof(*di));
     }
 }
 // min([key for key in d1 if key not in d2 or d1[key] != d2[key]])
@@ -248,10 +315,11 @@ int udict_compare(const udict_t *d1, const udict_t *d2)
                               udict_get(d2, min_diff_key_b, G_ERROR("")), cmp);
 }
 
-udict_t *_dcpy(const udict_t *d, bool deep)
+// Empty dict with the backend and handlers of d.
+static udict_t *_create_like(const udict_t *d, bool deep)
 {
-    udict_t *copy = udict_create_with_backend(d->backend);
-    udict_iterator_t *di = udict_iterator_create(d);
+    udict_t *copy = udict_create_ext(d->backend,
+                                     uallocator_get_copy_allocator(d->allocator));
 
     if (UDICT_ON_HTBL(d))
     {
@@ -268,6 +336,15 @@ udict_t *_dcpy(const udict_t *d, bool deep)
     udict_set_void_serializer(copy, udict_get_void_serializer((udict_t *)d));
     udict_set_void_copier(copy, cpy);
 
+    return copy;
+}
+
+udict_t *_dcpy(const udict_t *d, bool deep)
+{
+    udict_t *copy = _create_like(d, deep);
+    udict_iterator_t *di = udict_iterator_create(d);
+    void_cpy_t cpy = udict_get_void_copier((udict_t *)d);
+
     while (udict_iterator_has_next(di))
     {
         ugeneric_kv_t kv = udict_iterator_get_next(di);
@@ -292,10 +369,68 @@ void *udict_deep_copy(const udict_t *d)
     return _dcpy(d, true);
 }
 
+udict_t *udict_cow_copy(const udict_t *d)
+{
+    UASSERT_INPUT(d);
+
+    // Records on an arena can't be shared with a heap copy.
+    if (uallocator_get_copy_allocator(d->allocator) != d->allocator)
+    {
+        return _dcpy(d, udict_is_data_owner((udict_t *)d));
+    }
+
+    // Sharing is bookkeeping, the contents of d stay the same.
+    udict_t *shared = (udict_t *)d;
+    if (!shared->refs)
+    {
+        shared->refs = uallocator_alloc(d->allocator, sizeof(*d->refs));
+        atomic_init(shared->refs, 1);
+    }
+    atomic_fetch_add(shared->refs, 1);
+
+    udict_t *copy = uallocator_alloc(d->allocator, sizeof(*copy));
+    *copy = *d;
+
+    return copy;
+}
+
+void udict_unshare(udict_t *d)
+{
+    UASSERT_INPUT(d);
+
+    if (!d->refs)
+    {
+        return;
+    }
+    if (atomic_load(d->refs) == 1)
+    {
+        _release_vobj(d);
+        return;
+    }
+
+    // Items of an owner are shared as well, so they get copied too.
+    _replace_vobj(d, _dcpy(d, udict_is_data_owner(d)));
+}
+
+void udict_clear(udict_t *d)
+{
+    UASSERT_INPUT(d);
+
+    if (d->refs)
+    {
+        _replace_vobj(d, _create_like(d, udict_is_data_owner(d)));
+    }
+    else
+    {
+        d->vtable->clear(d->vobj);
+    }
+}
+
 void udict_set_void_hasher(udict_t *d, void_hasher_t hasher)
 {
     UASSERT_INPUT(d);
     UASSERT_INPUT(UDICT_ON_HTBL(d));
+    udict_unshare(d);
     uhtbl_set_void_hasher(d->vobj, hasher);
 }
 
@@ -303,5 +438,6 @@ void udict_set_void_key_comparator(udict_t *d, void_cmp_t cmp)
 {
     UASSERT_INPUT(d);
     UASSERT_INPUT(UDICT_ON_HTBL(d));
+    udict_unshare(d);
     uhtbl_set_void_key_comparator(d->vobj, cmp);
 }
@@ -0,0 +1,397 @@
+#include "extsort.h"
+
+#include "asserts.h"
+#include "file_utils.h"
+#include "mem.h"
+#include "string_utils.h"
+#include "vector.h"
+#include <string.h>
+
+// Reader's own buffer holds one record at a time, it grows when needed.
+#define EXTSORT_READER_BUFFER_SIZE 256
+
+/*
+ * Loser tree over k sources: tree[1..k) hold losers of the matches played in
+ * the inner nodes, tree[0] the overall winner. Replacing the winner's item
+ * replays only the matches on its path, log2(k) comparisons per item.
+ */
+typedef struct {
+    size_t k;
+    ufile_reader_t **readers;
+    ugeneric_t *heads; // current item of every source
+    bool *done;
+    size_t *tree;
+} _merger_t;
+
+struct uextsort_iterator_opaq {
+    uvector_t *run;   // the whole input if nothing has been spilled
+    size_t run_pos;
+    uvector_t *paths; // spilled runs
+    char *tmp_dir;
+    _merger_t merger;
+};
+
+// Index k is the sentinel which beats everyone, ties go to the earlier run.
+static bool _beats(const _merger_t *m, size_t a, size_t b)
+{
+    if ((a == m->k) || (b == m->k))
+    {
+        return a == m->k;
+    }
+    if (m->done[a] || m->done[b])
+    {
+        return !m->done[a];
+    }
+
+    int diff = ugeneric_compare(m->heads[a], m->heads[b]);
+    return (diff < 0) || ((diff == 0) && (a < b));
+}
+
+static void _replay(_merger_t *m, size_t s)
+{
+    for (size_t t = (s + m->k) / 2; t > 0; t /= 2)
+    {
+        if (_beats(m, m->tree[t], s))
+        {
+            size_t tmp = m->tree[t];
+            m->tree[t] = s;
+            s = tmp;
+        }
+    }
+    m->tree[0] = s;
+}
+
+static ugeneric_t _advance(_merger_t *m, size_t s)
+{
+    m->done[s] = !ufile_reader_has_next(m->readers[s]);
+    if (!m->done[s])
+    {
+        m->heads[s] = ufile_reader_read_generic(m->readers[s]);
+        if (G_IS_ERROR(m->heads[s]))
+        {
+            ugeneric_t e = m->heads[s];
+            m->done[s] = true;
+            return e;
+        }
+    }
+
+    return G_NULL();
+}
+
+static void _merger_deinit(_merger_t *m)
+{
+    for (size_t i = 0; i < m->k; i++)
+    {
+        if (!m->done[i])
+        {
+            ugeneric_destroy(m->heads[i]);
+        }
+        ufile_reader_destroy(m->readers[i]);
+    }
+    ufree(m->readers);
+    ufree(m->heads);
+    ufree(m->done);
+    ufree(m->tree);
+    memset(m, 0, sizeof(*m));
+}
+
+// Merges k runs of paths starting from the first one.
+static ugeneric_t _merger_init(_merger_t *m, const uvector_t *paths,
+                               size_t first, size_t k)
+{
+    m->k = k;
+    m->readers = ucalloc(k, sizeof(m->readers[0]));
+    m->heads = ucalloc(k, sizeof(m->heads[0]));
+    m->done = ucalloc(k, sizeof(m->done[0]));
+    m->tree = ucalloc(k, sizeof(m->tree[0]));
+
+    for (size_t i = 0; i < k; i++)
+    {
+        m->done[i] = true;
+    }
+
+    ugeneric_t g = G_NULL();
+    for (size_t i = 0; (i < k) && !G_IS_ERROR(g); i++)
+    {
+        const char *path = G_AS_STR(uvector_get_at(paths, first + i));
+        g = ufile_reader_create(path, EXTSORT_READER_BUFFER_SIZE);
+        if (!G_IS_ERROR(g))
+        {
+            m->readers[i] = G_AS_PTR(g);
+            g = _advance(m, i);
+        }
+    }
+    if (G_IS_ERROR(g))
+    {
+        _merger_deinit(m);
+        return g;
+    }
+
+    for (size_t i = 0; i < k; i++)
+    {
+        m->tree[i] = k;
+    }
+    for (size_t i = k; i-- > 0;)
+    {
+        _replay(m, i);
+    }
+
+    return G_NULL();
+}
+
+static bool _merger_has_next(const _merger_t *m)
+{
+    return m->k && !m->done[m->tree[0]];
+}
+
+static ugeneric_t _merger_get_next(_merger_t *m)
+{
+    size_t w = m->tree[0];
+    ugeneric_t item = m->heads[w];
+
+    ugeneric_t g = _advance(m, w);
+    if (G_IS_ERROR(g))
+    {
+        ugeneric_destroy(item);
+        return g;
+    }
+    _replay(m, w);
+
+    return item;
+}
+
+static ugeneric_t _new_run(uextsort_iterator_t *it, ufile_writer_t **fw)
+{
+    char *path = ustring_fmt("%s/uextsort-XXXXXX", it->tmp_dir);
+    ugeneric_t g = ufile_writer_create_unique(path);
+    if (G_IS_ERROR(g))
+    {
+        ufree(path);
+        return g;
+    }
+    *fw = G_AS_PTR(g);
+    uvector_append(it->paths, G_STR(path));
+
+    return G_NULL();
+}
+
+static ugeneric_t _spill(uextsort_iterator_t *it)
+{
+    ufile_writer_t *fw;
+    ugeneric_t g = _new_run(it, &fw);
+    if (G_IS_ERROR(g))
+    {
+        return g;
+    }
+
+    uvector_sort(it->run);
+    size_t size = uvector_get_size(it->run);
+    for (size_t i = 0; (i < size) && !G_IS_ERROR(g); i++)
+    {
+        g = ufile_writer_write_generic(fw, uvector_get_at(it->run, i));
+    }
+    uvector_clear(it->run);
+
+    ugeneric_t c = ufile_writer_destroy(fw);
+    return G_IS_ERROR(g) ? g : c;
+}
+
+// Merges the first EXTSORT_MAX_FAN_IN runs into a new one.
+static ugeneric_t _merge_pass(uextsort_iterator_t *it)
+{
+    ufile_writer_t *fw;
+    ugeneric_t g = _new_run(it, &fw);
+    if (G_IS_ERROR(g))
+    {
+        return g;
+    }
+
+    _merger_t m;
+    g = _merger_init(&m, it->paths, 0, EXTSORT_MAX_FAN_IN);
+    while (!G_IS_ERROR(g) && _merger_has_next(&m))
+    {
+        g = _merger_get_next(&m);
+        if (!G_IS_ERROR(g))
+        {
+            ugeneric_t item = g;
+            g = ufile_writer_write_generic(fw, item);
+            ugeneric_destroy(item);
+        }
+    }
+    if (m.k)
+    {
+        _merger_deinit(&m);
+    }
+
+    ugeneric_t c = ufile_writer_destroy(fw);
+    for (size_t i = 0; i < EXTSORT_MAX_FAN_IN; i++)
+    {
+        remove(G_AS_STR(uvector_get_front(it->paths)));
+        uvector_remove_at(it->paths, 0);
+    }
+
+    return G_IS_ERROR(g) ? g : c;
+}
+
+static ugeneric_t _read_runs(uextsort_iterator_t *it, const char *path,
+                             size_t memory_budget)
+{
+    ugeneric_t g = ufile_reader_create(path, EXTSORT_READER_BUFFER_SIZE);
+    if (G_IS_ERROR(g))
+    {
+        return g;
+    }
+    ufile_reader_t *fr = G_AS_PTR(g);
+
+    size_t used = 0;
+    g = G_NULL();
+    while (!G_IS_ERROR(g) && ufile_reader_has_next(fr))
+    {
+        g = ufile_reader_read_generic(fr);
+        if (!G_IS_ERROR(g))
+        {
+            uvector_append(it->run, g);
+            used += sizeof(g) + ugeneric_get_memory_usage(g);
+            if (used >= memory_budget)
+            {
+                g = _spill(it);
+                used = 0;
+            }
+        }
+    }
+    ufile_reader_destroy(fr);
+
+    return g;
+}
+
+ugeneric_t uextsort_iterator_create(const char *path, size_t memory_budget,
+                                    const char *tmp_dir)
+{
+    UASSERT_INPUT(path);
+    UASSERT_INPUT(memory_budget);
+
+    uextsort_iterator_t *it = uzalloc(sizeof(*it));
+    it->run = uvector_create();
+    it->paths = uvector_create();
+    it->tmp_dir = ustring_dup(tmp_dir ? tmp_dir : ".");
+
+    ugeneric_t g = _read_runs(it, path, memory_budget);
+    if (!G_IS_ERROR(g) && uvector_get_size(it->paths))
+    {
+        if (!uvector_is_empty(it->run))
+        {
+            g = _spill(it);
+        }
+        while (!G_IS_ERROR(g) && (uvector_get_size(it->paths) > EXTSORT_MAX_FAN_IN))
+        {
+            g = _merge_pass(it);
+        }
+        if (!G_IS_ERROR(g))
+        {
+            g = _merger_init(&it->merger, it->paths, 0,
+                             uvector_get_size(it->paths));
+        }
+    }
+    else
+    {
+        uvector_sort(it->run);
+    }
+
+    if (G_IS_ERROR(g))
+    {
+        uextsort_iterator_destroy(it);
+        return g;
+    }
+
+    return G_PTR(it);
+}
+
+bool uextsort_iterator_has_next(const uextsort_iterator_t *it)
+{
+    UASSERT_INPUT(it);
+
+    if (it->merger.k)
+    {
+        return _merger_has_next(&it->merger);
+    }
+
+    return it->run_pos < uvector_get_size(it->run);
+}
+
+ugeneric_t uextsort_iterator_get_next(uextsort_iterator_t *it)
+{
+    UASSERT_INPUT(it);
+    UASSERT_INPUT(uextsort_iterator_has_next(it));
+
+    if (it->merger.k)
+    {
+        return _merger_get_next(&it->merger);
+    }
+
+    // Items are handed over one by one, the vector doesn't own them anymore.
+    uvector_drop_data_ownership(it->run);
+    return uvector_get_at(it->run, it->run_pos++);
+}
+
+void uextsort_iterator_destroy(uextsort_iterator_t *it)
+{
+    if (it)
+    {
+        if (it->merger.k)
+        {
+            _merger_deinit(&it->merger);
+        }
+        for (size_t i = 0; i < uvector_get_size(it->paths); i++)
+        {
+            remove(G_AS_STR(uvector_get_at(it->paths, i)));
+        }
+
+        // What hasn't been handed over yet is still ours.
+        for (size_t i = it->run_pos; i < uvector_get_size(it->run); i++)
+        {
+            ugeneric_destroy(uvector_get_at(it->run, i));
+        }
+        uvector_drop_data_ownership(it->run);
+        uvector_destroy(it->run);
+        uvector_destroy(it->paths);
+        ufree(it->tmp_dir);
+        ufree(it);
+    }
+}
+
+ugeneric_t uextsort_file(const char *input_path, const char *output_path,
+                         size_t memory_budget, const char *tmp_dir)
+{
+    UASSERT_INPUT(output_path);
+
+    ugeneric_t g = uextsort_iterator_create(input_path, memory_budget, tmp_dir);
+    if (G_IS_ERROR(g))
+    {
+        return g;
+    }
+    uextsort_iterator_t *it = G_AS_PTR(g);
+
+    if (G_IS_ERROR(g = ufile_writer_create(output_path)))
+    {
+        uextsort_iterator_destroy(it);
+        return g;
+    }
+    ufile_writer_t *fw = G_AS_PTR(g);
+
+    g = G_NULL();
+    while (!G_IS_ERROR(g) && uextsort_iterator_has_next(it))
+    {
+        g = uextsort_iterator_get_next(it);
+        if (!G_IS_ERROR(g))
+        {
+            ugeneric_t item = g;
+            g = ufile_writer_write_generic(fw, item);
+            ugeneric_destroy(item);
+        }
+    }
+
+    ugeneric_t c = ufile_writer_destroy(fw);
+    uextsort_iterator_destroy(it);
+
+    return G_IS_ERROR(g) ? g : c;
+}
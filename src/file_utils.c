@@ -1,10 +1,16 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "file_utils.h"
 
 #include "asserts.h"
 #include "mem.h"
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #define IO_ERROR_MSG "I/O error at %s:%u:%s(): %s"
 #define G_ERROR_IO G_ERROR(ustring_fmt(IO_ERROR_MSG, __FILE__, __LINE__, __func__, strerror(errno)))
+#define WRITEV_BATCH 64
 
 struct ufile_reader_opaq {
     FILE *file;
@@ -16,6 +22,7 @@ struct ufile_reader_opaq {
 
 struct ufile_writer_opaq {
     FILE *file;
+    ubuffer_t record; // scratch of ufile_writer_write_generic()
 };
 
 // Default handler does nothing besides propagating error up.
@@ -308,6 +315,57 @@ ugeneric_t ufile_reader_read(ufile_reader_t *fr, size_t size, void *buffer)
     return (buffer ? G_MEMCHUNK(buffer, r) : G_MEMCHUNK(fr->buffer, r));
 }
 
+static ugeneric_t _read_exactly(ufile_reader_t *fr, size_t size, void *buffer)
+{
+    ugeneric_t g = ufile_reader_read(fr, size, buffer);
+    if (!G_IS_ERROR(g) && (G_AS_MEMCHUNK_SIZE(g) < size))
+    {
+        g = G_ERROR(ustring_fmt("truncated binary record at offset %zu",
+                                fr->read_offset));
+    }
+
+    return g;
+}
+
+ugeneric_t ufile_reader_read_generic(ufile_reader_t *fr)
+{
+    UASSERT_INPUT(fr);
+
+    uint64_t size;
+    ugeneric_t g = _read_exactly(fr, sizeof(size), &size);
+    if (!G_IS_ERROR(g))
+    {
+        // The length comes from the file, don't allocate more than is left.
+        if ((fr->read_offset > fr->file_size) ||
+            (size > fr->file_size - fr->read_offset))
+        {
+            return G_ERROR(ustring_fmt("truncated binary record at offset %zu",
+                                       fr->read_offset));
+        }
+        g = _read_exactly(fr, size, NULL);
+    }
+    if (G_IS_ERROR(g))
+    {
+        return g;
+    }
+
+    // Decoded strings (on their own or in containers) point into the
+    // reader's buffer, the caller gets a copy of its own.
+    g = ugeneric_decode_binary(G_AS_MEMCHUNK_DATA(g), size);
+    if (G_IS_CSTR(g))
+    {
+        g = G_STR(ustring_dup(G_AS_STR(g)));
+    }
+    else if (G_IS_VECTOR(g) || G_IS_DICT(g))
+    {
+        ugeneric_t copy = ugeneric_copy(g);
+        ugeneric_destroy(g);
+        g = copy;
+    }
+
+    return g;
+}
+
 bool ufile_reader_has_next(const ufile_reader_t *fr)
 {
     return fr->read_offset < fr->file_size;
@@ -365,12 +423,35 @@ ugeneric_t ufile_writer_create(const char *path)
     {
         return g;
     }
-    ufile_writer_t *fw = umalloc(sizeof(*fw));
+    ufile_writer_t *fw = uzalloc(sizeof(*fw));
     fw->file = G_AS_PTR(g);
 
     return G_PTR(fw);
 }
 
+ugeneric_t ufile_writer_create_unique(char *path_template)
+{
+    UASSERT_INPUT(path_template);
+
+    int fd = mkstemp(path_template);
+    if (fd == -1)
+    {
+        return _error_handler(G_ERROR_IO, _error_handler_ctx);
+    }
+    FILE *file = fdopen(fd, "wb");
+    if (!file)
+    {
+        ugeneric_t g = _error_handler(G_ERROR_IO, _error_handler_ctx);
+        close(fd);
+        unlink(path_template);
+        return g;
+    }
+    ufile_writer_t *fw = uzalloc(sizeof(*fw));
+    fw->file = file;
+
+    return G_PTR(fw);
+}
+
 ugeneric_t ufile_writer_write(ufile_writer_t *fw, umemchunk_t mchunk)
 {
     UASSERT_INPUT(fw);
@@ -386,6 +467,108 @@ ugeneric_t ufile_writer_write(ufile_writer_t *fw, umemchunk_t mchunk)
     return G_NULL();
 }
 
+ugeneric_t ufile_writer_write_rope(ufile_writer_t *fw, const urope_t *r)
+{
+    UASSERT_INPUT(fw);
+    UASSERT_INPUT(r);
+
+    // Whatever stdio has buffered goes first, segments then go directly.
+    if (fflush(fw->file))
+    {
+        return _error_handler(G_ERROR_IO, _error_handler_ctx);
+    }
+
+    int fd = fileno(fw->file);
+    size_t count = urope_get_segment_count(r);
+    size_t i = 0;      // first segment not fully written yet
+    size_t offset = 0; // bytes of it already written
+
+    while (i < count)
+    {
+        struct iovec iov[WRITEV_BATCH];
+        int n = 0;
+        for (size_t j = i; (j < count) && (n < WRITEV_BATCH); j++)
+        {
+            umemchunk_t m = urope_get_segment(r, j);
+            size_t skip = (j == i) ? offset : 0;
+            iov[n].iov_base = (char *)m.data + skip;
+            iov[n].iov_len = m.size - skip;
+            n++;
+        }
+
+        ssize_t written = writev(fd, iov, n);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return _error_handler(G_ERROR_IO, _error_handler_ctx);
+        }
+
+        // Step over what is written, the last segment may be written partially.
+        size_t left = written;
+        while ((i < count) && (left >= urope_get_segment(r, i).size - offset))
+        {
+            left -= urope_get_segment(r, i).size - offset;
+            offset = 0;
+            i++;
+        }
+        offset += left;
+    }
+
+    return G_NULL();
+}
+
+typedef struct {
+    ufile_writer_t *fw;
+    ugeneric_t status;
+} _writer_sink_ctx_t;
+
+static bool _writer_sink(const void *data, size_t size, void *ctx)
+{
+    _writer_sink_ctx_t *c = ctx;
+    if (!G_IS_ERROR(c->status))
+    {
+        umemchunk_t m = {(void *)data, size};
+        c->status = ufile_writer_write(c->fw, m);
+    }
+
+    return !G_IS_ERROR(c->status);
+}
+
+ugeneric_t ufile_writer_serialize_v(ufile_writer_t *fw, ugeneric_t g,
+                                    void_s8r_t void_serializer)
+{
+    UASSERT_INPUT(fw);
+
+    ubuffer_t buf = {0};
+    _writer_sink_ctx_t ctx = {fw, G_NULL()};
+
+    ubuffer_attach_sink(&buf, _writer_sink, &ctx);
+    ugeneric_serialize_v(g, &buf, void_serializer);
+    ubuffer_flush(&buf);
+    ubuffer_destroy(&buf);
+
+    return ctx.status;
+}
+
+ugeneric_t ufile_writer_write_generic(ufile_writer_t *fw, ugeneric_t g)
+{
+    UASSERT_INPUT(fw);
+
+    // Length goes first, it is known once the item is encoded.
+    uint64_t size = 0;
+    ubuffer_reset(&fw->record);
+    ubuffer_append_data(&fw->record, &size, sizeof(size));
+    ugeneric_encode_binary(g, &fw->record);
+    size = fw->record.data_size - sizeof(size);
+    memcpy(fw->record.data, &size, sizeof(size));
+
+    return ufile_writer_write(fw, (umemchunk_t){fw->record.data,
+                                                fw->record.data_size});
+}
+
 ugeneric_t ufile_writer_get_file_size(ufile_writer_t *fw)
 {
     UASSERT_INPUT(fw);
@@ -410,6 +593,7 @@ ugeneric_t ufile_writer_destroy(ufile_writer_t *fw)
     if (fw)
     {
         g = ufile_close(fw->file);
+        ubuffer_destroy(&fw->record);
         ufree(fw);
     }
 
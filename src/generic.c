@@ -1,18 +1,18 @@
 #include "generic.h"
 
 #include "dict.h"
+#include "num_utils.h"
 #include "string_utils.h"
 #include "vector.h"
 #include <ctype.h>
-#include <errno.h>
-#include <inttypes.h>
 #include <limits.h>
+#include <stdint.h>
 #include <time.h>
 
 #define THREE_WAY_CMP(x, y) ((((x) > (y)) - ((x) < (y))))
 #define IS_NAN(x) ((x) != (x))
 
-static ugeneric_t _parse_item(const char **str);
+static ugeneric_t _parse_item(const char **str, uarena_t *arena);
 
 static inline void _skip_whitespaces(const char **str)
 {
@@ -216,8 +216,9 @@ int ugeneric_compare_v(ugeneric_t g1, ugeneric_t g2, void_cmp_t cmp)
             case G_MEMCHUNK_T:
                 s1 = G_AS_MEMCHUNK_SIZE(g1);
                 s2 = G_AS_MEMCHUNK_SIZE(g2);
-                ret = memcmp(G_AS_MEMCHUNK_DATA(g1), G_AS_MEMCHUNK_DATA(g2),
-                             MIN(s1, s2));
+                ret = (s1 && s2) ? memcmp(G_AS_MEMCHUNK_DATA(g1),
+                                          G_AS_MEMCHUNK_DATA(g2), MIN(s1, s2))
+                                 : 0;
                 if (ret == 0)
                 {
                     ret = THREE_WAY_CMP(s1, s2);
@@ -293,6 +294,24 @@ void ugeneric_destroy_v(ugeneric_t g, void_dtr_t dtr)
     }
 }
 
+size_t ugeneric_get_memory_usage(ugeneric_t g)
+{
+    switch (ugeneric_get_type(g))
+    {
+        case G_STR_T:
+            return strlen(G_AS_STR(g)) + 1;
+        case G_MEMCHUNK_T:
+            return G_AS_MEMCHUNK_SIZE(g);
+        case G_VECTOR_T:
+            return umem_usage_get_total(uvector_get_memory_usage(G_AS_PTR(g)));
+        case G_DICT_T:
+            return umem_usage_get_total(udict_get_memory_usage(G_AS_PTR(g)));
+        default:
+            // Scalars take no memory of their own, void data is opaque.
+            return 0;
+    }
+}
+
 void ugeneric_error_print(ugeneric_t g)
 {
     UASSERT_INPUT(ugeneric_get_type(g) == G_ERROR_T);
@@ -364,7 +383,7 @@ ugeneric_t ugeneric_copy_v(ugeneric_t g, void_cpy_t cpy)
         case G_MEMCHUNK_T:
             size = G_AS_MEMCHUNK_SIZE(g);
             data = G_AS_MEMCHUNK_DATA(g);
-            ret = G_MEMCHUNK(umemdup(data, size), size);
+            ret = G_MEMCHUNK(size ? umemdup(data, size) : NULL, size);
             break;
 
         default:
@@ -374,15 +393,21 @@ ugeneric_t ugeneric_copy_v(ugeneric_t g, void_cpy_t cpy)
     return ret;
 }
 
-int ugeneric_fprint_v(ugeneric_t g, FILE *out, void_s8r_t void_serializer)
-{
-    UASSERT_INPUT(out);
+typedef struct {
+    ugeneric_t g;
+    void_s8r_t void_serializer;
+} _s8r_args_t;
 
-    char *str = ugeneric_as_str_v(g, void_serializer);
-    int ret = fprintf(out, "%s\n", str);
-    ufree(str);
+static void _serialize_args(const void *args, ubuffer_t *buf)
+{
+    const _s8r_args_t *a = args;
+    ugeneric_serialize_v(a->g, buf, a->void_serializer);
+}
 
-    return ret;
+int ugeneric_fprint_v(ugeneric_t g, FILE *out, void_s8r_t void_serializer)
+{
+    _s8r_args_t args = {g, void_serializer};
+    return ubuffer_fprint_serialized(_serialize_args, &args, out);
 }
 
 char *ugeneric_as_str_v(ugeneric_t g, void_s8r_t void_serializer)
@@ -395,6 +420,97 @@ char *ugeneric_as_str_v(ugeneric_t g, void_s8r_t void_serializer)
     return buf.data;
 }
 
+/*
+ * Make sure there are at least size bytes available past the data
+ * in the buffer and return a pointer to them, so formatters can
+ * write their output in place.
+ */
+static inline char *_reserve_tail(ubuffer_t *buf, size_t size)
+{
+    ubuffer_reserve_capacity(buf, buf->data_size + size);
+    return (char *)buf->data + buf->data_size;
+}
+
+/*
+ * SWAR helpers, every byte of the result has its top bit set if the
+ * corresponding byte of the word is zero (is less than n for n <= 128).
+ * Nothing but the fact of having a nonzero result is reliable.
+ */
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+#define SWAR_HAS_ZERO(w)    (((w) - SWAR_ONES) & ~(w) & SWAR_HIGHS)
+#define SWAR_HAS_LESS(w, n) (((w) - SWAR_ONES * (n)) & ~(w) & SWAR_HIGHS)
+
+static inline bool _needs_escape(unsigned char c)
+{
+    return (c < 0x20) || (c == '"') || (c == '\\');
+}
+
+static inline uint64_t _escape_mask(const char *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return SWAR_HAS_LESS(w, 0x20) |
+           SWAR_HAS_ZERO(w ^ (SWAR_ONES * '"')) |
+           SWAR_HAS_ZERO(w ^ (SWAR_ONES * '\\'));
+}
+
+// Find the first character in [p, end) that has to be escaped, or end.
+static const char *_find_escape(const char *p, const char *end)
+{
+    while ((end - p >= 16) && !(_escape_mask(p) | _escape_mask(p + 8)))
+    {
+        p += 16;
+    }
+    while ((p < end) && !_needs_escape(*p))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+static void _serialize_string(const char *str, ubuffer_t *buf)
+{
+    static const char hex[] = "0123456789abcdef";
+    char esc[6] = {'\\', 'u', '0', '0'};
+    const char *end = str + strlen(str);
+
+    ubuffer_append_byte(buf, '"');
+    while (str < end)
+    {
+        const char *p = _find_escape(str, end);
+        if (p > str)
+        {
+            ubuffer_append_data(buf, str, p - str);
+        }
+        if (p == end)
+        {
+            break;
+        }
+
+        size_t len = 2;
+        switch (*p)
+        {
+            case '"':  esc[1] = '"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\b': esc[1] = 'b';  break;
+            case '\f': esc[1] = 'f';  break;
+            case '\n': esc[1] = 'n';  break;
+            case '\r': esc[1] = 'r';  break;
+            case '\t': esc[1] = 't';  break;
+            default:
+                esc[1] = 'u';
+                esc[4] = hex[*p >> 4];
+                esc[5] = hex[*p & 0x0f];
+                len = 6;
+        }
+        ubuffer_append_data(buf, esc, len);
+        str = p + 1;
+    }
+    ubuffer_append_byte(buf, '"');
+}
+
 void ugeneric_serialize_v(ugeneric_t g, ubuffer_t *buf, void_s8r_t void_serializer)
 {
     UASSERT_INPUT(buf);
@@ -427,36 +543,22 @@ void ugeneric_serialize_v(ugeneric_t g, ubuffer_t *buf, void_s8r_t void_serializ
 
         case G_STR_T:
         case G_CSTR_T:
-            ubuffer_append_byte(buf, '\"');
-            s = G_AS_STR(g);
-            while (*s)
-            {
-                if (*s == '"')
-                {
-                    ubuffer_append_byte(buf, '\\');
-                }
-                ubuffer_append_byte(buf, *s++);
-            }
-            ubuffer_append_byte(buf, '\"');
+            _serialize_string(G_AS_STR(g), buf);
             break;
 
         case G_INT_T:
-            snprintf(tmp, sizeof(tmp), "%ld", G_AS_INT(g));
-            m.data = tmp, m.size = strlen(tmp);
-            ubuffer_append_memchunk(buf, &m);
+            s = _reserve_tail(buf, UNUM_MAX_FORMATTED_LEN);
+            buf->data_size += unum_format_long(G_AS_INT(g), s);
             break;
 
         case G_REAL_T:
-//            snprintf(tmp, sizeof(tmp), "%.3f", G_AS_REAL(g));
-            snprintf(tmp, sizeof(tmp), "%g", G_AS_REAL(g));
-            m.data = tmp, m.size = strlen(tmp);
-            ubuffer_append_memchunk(buf, &m);
+            s = _reserve_tail(buf, UNUM_MAX_FORMATTED_LEN);
+            buf->data_size += unum_format_real(G_AS_REAL(g), s);
             break;
 
         case G_SIZE_T:
-            snprintf(tmp, sizeof(tmp), "%zu", G_AS_SIZE(g));
-            m.data = tmp, m.size = strlen(tmp);
-            ubuffer_append_memchunk(buf, &m);
+            s = _reserve_tail(buf, UNUM_MAX_FORMATTED_LEN);
+            buf->data_size += unum_format_size(G_AS_SIZE(g), s);
             break;
 
         case G_VECTOR_T:
@@ -489,7 +591,7 @@ static inline int htoi(int x)
     return 9 * (x >> 6) + (x & 0x0f);
 }
 
-static ugeneric_t _parse_memchunk(const char **str)
+static ugeneric_t _parse_memchunk(const char **str, uarena_t *arena)
 {
     const char *p = *str;
 
@@ -510,7 +612,7 @@ static ugeneric_t _parse_memchunk(const char **str)
         return G_ERROR(ustring_dup("invalid size"));
     }
 
-    char *m = umalloc(len / 2);
+    char *m = umalloc_in(arena, len / 2);
     p = *str;
 
     for (size_t i = 0; i < len / 2; i++)
@@ -522,122 +624,158 @@ static ugeneric_t _parse_memchunk(const char **str)
     return G_MEMCHUNK(m, len / 2);
 }
 
-static ugeneric_t _parse_string(const char **str)
+static int _parse_hex4(const char *p)
+{
+    int v = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!isxdigit(p[i]))
+        {
+            return -1;
+        }
+        v = 16 * v + htoi(p[i]);
+    }
+
+    return v;
+}
+
+static size_t _encode_utf8(unsigned long cp, char *out)
+{
+    if (cp < 0x80)
+    {
+        out[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800)
+    {
+        out[0] = 0xc0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3f);
+        return 2;
+    }
+    if (cp < 0x10000)
+    {
+        out[0] = 0xe0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3f);
+        out[2] = 0x80 | (cp & 0x3f);
+        return 3;
+    }
+    out[0] = 0xf0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3f);
+    out[2] = 0x80 | ((cp >> 6) & 0x3f);
+    out[3] = 0x80 | (cp & 0x3f);
+    return 4;
+}
+
+// Decode \uXXXX (or a surrogate pair of them) at p, which points past "\u".
+static const char *_parse_unicode_escape(const char *p, char **out)
+{
+    long cp = _parse_hex4(p);
+    p += 4;
+
+    if (cp >= 0xd800 && cp <= 0xdbff)
+    {
+        long lo = (p[0] == '\\' && p[1] == 'u') ? _parse_hex4(p + 2) : -1;
+        if (lo < 0xdc00 || lo > 0xdfff)
+        {
+            return NULL;
+        }
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+        p += 6;
+    }
+    else if (cp <= 0 || (cp >= 0xdc00 && cp <= 0xdfff))
+    {
+        // Malformed, lone low surrogate or '\0' which can't be stored.
+        return NULL;
+    }
+
+    *out += _encode_utf8(cp, *out);
+    return p;
+}
+
+static ugeneric_t _parse_string(const char **str, uarena_t *arena)
 {
-    size_t len = 0;
     const char *q = *str + 1;
     char delim = **str;
 
     // Step over opening quote.
     *str += 1;
 
-    // Calculate string length skipping escape characters.
+    // Find the closing quote, escaped characters never get longer.
     while ((**str != delim) && **str)
     {
-        if (**str == '\\')
+        if ((**str == '\\') && (*str)[1])
         {
             *str += 1;
         }
         *str += 1;
-        len++;
     }
 
     if (**str != delim)
     {
         return G_ERROR(ustring_dup("unexpected end of string"));
     }
+    const char *end = *str;
     // Step over closing quote.
     *str += 1;
 
-    // Extract the string content.
-    char *s = umalloc(len + 1);
+    // Extract the string content copying runs without escapes at once.
+    char *s = umalloc_in(arena, end - q + 1);
     char *t = s;
-    while (*q && len)
+    while (q < end)
     {
-        if (*q == '\\')
+        const char *p = memchr(q, '\\', end - q);
+        p = p ? p : end;
+        memcpy(t, q, p - q);
+        t += p - q;
+        if (p == end)
         {
-            q++;
+            break;
         }
-        *t++ = *q++;
-        len--;
-    }
-    t[len] = 0;
-
-    return G_STR(s);
-}
-
-static ugeneric_t _parse_number(const char **str)
-{
-    const char *p = *str;
-    bool is_real = false;
-    ugeneric_t g;
 
-    if (*p == '-')
-    {
-        p++;
-    }
-    while (isdigit(*p))
-    {
-        p++;
-    }
-    if (*p == '.')
-    {
-        is_real = true;
-    }
-    else if (*p == 'e' || *p == 'E')
-    {
-        is_real = true;
-    }
-
-    errno = 0;
-    char *endptr = 0;
-    if (is_real)
-    {
-        double r = strtod(*str, &endptr);
-        g = G_REAL(r);
-    }
-    else
-    {
-        long int l = strtol(*str, &endptr, 10);
-        g = G_INT(l);
-        if (errno == ERANGE && **str != '-')
+        q = p + 2;
+        switch (p[1])
         {
-            // The token looks like a huge positive integer number
-            // which doesn't fit to long int, let's try to parse
-            // it as size_t.
-            errno = 0;
-            endptr = 0;
-            uintmax_t t = strtoumax(*str, &endptr, 10);
-            g = G_SIZE(t);
-            if (errno != ERANGE)
-            {
-                // Check for the case when size_t and uintmax_t
-                // are different in width.
-                if (t != (size_t)t)
+            case 'b': *t++ = '\b'; break;
+            case 'f': *t++ = '\f'; break;
+            case 'n': *t++ = '\n'; break;
+            case 'r': *t++ = '\r'; break;
+            case 't': *t++ = '\t'; break;
+            case 'u':
+                if (!(q = _parse_unicode_escape(q, &t)))
                 {
-                    errno = ERANGE;
+                    ufree_in(arena, s);
+                    *str = p;
+                    return G_ERROR(ustring_dup("invalid escape sequence"));
                 }
-            }
+                break;
+
+            // Anything else stands for itself: \" \\ \/ \'.
+            default:
+                *t++ = p[1];
         }
     }
-    if (errno == ERANGE)
-    {
-        return G_ERROR(ustring_fmt("%s", strerror(errno)));
-    }
-    if (endptr == *str)
-    {
-        return G_ERROR(ustring_dup("cannot parse the numerical value"));
-    }
+    *t = 0;
 
-    *str += (endptr - *str);
+    return G_STR(s);
+}
 
-    return g;
+// Items parsed on an arena are not freed one by one, the arena owns them.
+static void _parse_discard(ugeneric_t g, uarena_t *arena)
+{
+    if (!arena)
+    {
+        ugeneric_destroy(g);
+    }
 }
 
-static ugeneric_t _parse_vector(const char **str)
+static ugeneric_t _parse_vector(const char **str, uarena_t *arena)
 {
     ugeneric_t g;
-    uvector_t *v = uvector_create();
+    uvector_t *v = uvector_create_with_arena(arena);
+    if (arena)
+    {
+        uvector_drop_data_ownership(v);
+    }
 
     (*str)++;
 
@@ -648,7 +786,7 @@ static ugeneric_t _parse_vector(const char **str)
         {
             break;
         }
-        if (G_IS_ERROR(g = _parse_item(str)))
+        if (G_IS_ERROR(g = _parse_item(str, arena)))
         {
             uvector_destroy(v);
             return g;
@@ -677,10 +815,14 @@ static ugeneric_t _parse_vector(const char **str)
     return G_VECTOR(v);
 }
 
-static ugeneric_t _parse_dict(const char **str)
+static ugeneric_t _parse_dict(const char **str, uarena_t *arena)
 {
     ugeneric_t k, v, g;
-    udict_t *d = udict_create();
+    udict_t *d = udict_create_with_arena(UDICT_BACKEND_DEFAULT, arena);
+    if (arena)
+    {
+        udict_drop_data_ownership(d);
+    }
 
     (*str)++;
 
@@ -692,7 +834,7 @@ static ugeneric_t _parse_dict(const char **str)
             break;
         }
 
-        if (G_IS_ERROR(k = _parse_item(str)))
+        if (G_IS_ERROR(k = _parse_item(str, arena)))
         {
             udict_destroy(d);
             return k;
@@ -700,7 +842,7 @@ static ugeneric_t _parse_dict(const char **str)
 
         if (**str != ':')
         {
-            ugeneric_destroy(k);
+            _parse_discard(k, arena);
             g = G_ERROR(ustring_dup("expected ':' was not found"));
             udict_destroy(d);
             return g;
@@ -708,9 +850,9 @@ static ugeneric_t _parse_dict(const char **str)
 
         (*str)++;
 
-        if (G_IS_ERROR(v = _parse_item(str)))
+        if (G_IS_ERROR(v = _parse_item(str, arena)))
         {
-            ugeneric_destroy(k);
+            _parse_discard(k, arena);
             udict_destroy(d);
             return v;
         }
@@ -733,7 +875,7 @@ static ugeneric_t _parse_dict(const char **str)
     return G_DICT(d);
 }
 
-static ugeneric_t _parse_item(const char **str)
+static ugeneric_t _parse_item(const char **str, uarena_t *arena)
 {
     ugeneric_t g;
 
@@ -741,19 +883,19 @@ static ugeneric_t _parse_item(const char **str)
 
     if (**str == '\"' || **str == '\'')
     {
-       g = _parse_string(str);
+       g = _parse_string(str, arena);
     }
     else if ((**str >= '0' && **str <= '9') || **str == '-')
     {
-        g = _parse_number(str);
+        g = unum_parse(str);
     }
     else if (**str == '[')
     {
-        g = _parse_vector(str);
+        g = _parse_vector(str, arena);
     }
     else if (**str == '{')
     {
-        g = _parse_dict(str);
+        g = _parse_dict(str, arena);
     }
     else if (!strncmp(*str, "null", 4))
     {
@@ -773,7 +915,7 @@ static ugeneric_t _parse_item(const char **str)
     else if (!strncmp(*str, "mem:", 4))
     {
         *str += 4;
-        g = _parse_memchunk(str);
+        g = _parse_memchunk(str, arena);
     }
     else
     {
@@ -786,15 +928,20 @@ static ugeneric_t _parse_item(const char **str)
 }
 
 ugeneric_t ugeneric_parse(const char *str)
+{
+    return ugeneric_parse_with_arena(str, NULL);
+}
+
+ugeneric_t ugeneric_parse_with_arena(const char *str, uarena_t *arena)
 {
     UASSERT_INPUT(str);
     const char *err_msg = "Parsing failed at offset %zu: %s.";
 
     const char *pos = str;
-    ugeneric_t g = _parse_item(&pos);
+    ugeneric_t g = _parse_item(&pos, arena);
     if (*pos != 0 && !G_IS_ERROR(g))
     {
-        ugeneric_destroy(g);
+        _parse_discard(g, arena);
         g = G_ERROR(ustring_fmt(err_msg, pos - str, "unexpected end of text"));
     }
     else if (G_IS_ERROR(g))
@@ -807,6 +954,345 @@ ugeneric_t ugeneric_parse(const char *str)
     return g;
 }
 
+/*
+ * Binary encoding: every item starts with a tag byte holding its
+ * ugeneric_type_e followed by the payload. Sizes and integers are LEB128
+ * varints (integers zigzag encoded first), reals are 8 little-endian bytes
+ * of their IEEE-754 representation. Strings are stored with their length and
+ * a terminating '\0', so the decoder can hand them out without copying.
+ * Memchunks are stored raw, vectors and dicts as a count followed by their
+ * items (key and value for every dict pair).
+ */
+static void _encode_varint(ubuffer_t *buf, uintmax_t v)
+{
+    unsigned char *p = (unsigned char *)_reserve_tail(buf, 10);
+    size_t n = 0;
+
+    while (v >= 0x80)
+    {
+        p[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    buf->data_size += n;
+}
+
+static void _encode_real(ubuffer_t *buf, double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+
+    unsigned char *p = (unsigned char *)_reserve_tail(buf, sizeof(bits));
+    for (size_t i = 0; i < sizeof(bits); i++)
+    {
+        p[i] = bits >> (8 * i);
+    }
+    buf->data_size += sizeof(bits);
+}
+
+void ugeneric_encode_binary(ugeneric_t g, ubuffer_t *buf)
+{
+    UASSERT_INPUT(buf);
+
+    size_t size;
+    uvector_t *v;
+    udict_iterator_t *di;
+    ugeneric_kv_t kv;
+    ugeneric_type_e t = ugeneric_get_type(g);
+
+    ubuffer_append_byte(buf, (t == G_CSTR_T) ? G_STR_T : t);
+
+    switch (t)
+    {
+        case G_NULL_T:
+            break;
+
+        case G_BOOL_T:
+            ubuffer_append_byte(buf, G_AS_BOOL(g));
+            break;
+
+        case G_INT_T:
+            _encode_varint(buf, ((uintmax_t)G_AS_INT(g) << 1) ^
+                                (uintmax_t)-(G_AS_INT(g) < 0));
+            break;
+
+        case G_SIZE_T:
+            _encode_varint(buf, G_AS_SIZE(g));
+            break;
+
+        case G_REAL_T:
+            _encode_real(buf, G_AS_REAL(g));
+            break;
+
+        case G_STR_T:
+        case G_CSTR_T:
+            size = strlen(G_AS_STR(g));
+            _encode_varint(buf, size);
+            ubuffer_append_data(buf, G_AS_STR(g), size + 1);
+            break;
+
+        case G_MEMCHUNK_T:
+            size = G_AS_MEMCHUNK_SIZE(g);
+            _encode_varint(buf, size);
+            if (size)
+            {
+                ubuffer_append_data(buf, G_AS_MEMCHUNK_DATA(g), size);
+            }
+            break;
+
+        case G_VECTOR_T:
+            v = G_AS_PTR(g);
+            size = uvector_get_size(v);
+            _encode_varint(buf, size);
+            for (size_t i = 0; i < size; i++)
+            {
+                ugeneric_encode_binary(uvector_get_cells(v)[i], buf);
+            }
+            break;
+
+        case G_DICT_T:
+            _encode_varint(buf, udict_get_size(G_AS_PTR(g)));
+            di = udict_iterator_create(G_AS_PTR(g));
+            while (udict_iterator_has_next(di))
+            {
+                kv = udict_iterator_get_next(di);
+                ugeneric_encode_binary(kv.k, buf);
+                ugeneric_encode_binary(kv.v, buf);
+            }
+            udict_iterator_destroy(di);
+            break;
+
+        case G_PTR_T:
+        case G_CPTR_T:
+            UABORT("attempt to encode void data");
+            break;
+
+        case G_ERROR_T:
+            UABORT("attempt to encode G_ERROR object");
+            break;
+
+        default:
+            UASSERT_INTERNAL("unknown type");
+    }
+}
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    size_t depth; // containers being decoded
+} _decoder_t;
+
+static ugeneric_t _decode_item(_decoder_t *d);
+
+static bool _decode_varint(_decoder_t *d, uintmax_t *v)
+{
+    *v = 0;
+    for (unsigned int shift = 0; d->p < d->end; shift += 7)
+    {
+        unsigned char b = *d->p++;
+        if (shift >= sizeof(*v) * CHAR_BIT ||
+            ((uintmax_t)(b & 0x7f) << shift) >> shift != (b & 0x7fu))
+        {
+            return false;
+        }
+        *v |= (uintmax_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Size of something that is going to occupy at least that many bytes of the
+// input, anything bigger can't be there.
+static bool _decode_size(_decoder_t *d, size_t *size)
+{
+    uintmax_t v;
+    if (!_decode_varint(d, &v) || v > (uintmax_t)(d->end - d->p))
+    {
+        return false;
+    }
+    *size = v;
+
+    return true;
+}
+
+static ugeneric_t _decode_vector(_decoder_t *d)
+{
+    size_t size;
+    ugeneric_t g;
+
+    if (d->depth == UGENERIC_BINARY_MAX_DEPTH)
+    {
+        return G_ERROR(ustring_dup("nesting too deep"));
+    }
+    if (!_decode_size(d, &size))
+    {
+        return G_ERROR(ustring_dup("invalid vector size"));
+    }
+    d->depth++;
+
+    uvector_t *v = uvector_create();
+    uvector_reserve_capacity(v, size);
+    while (size--)
+    {
+        if (G_IS_ERROR(g = _decode_item(d)))
+        {
+            uvector_destroy(v);
+            return g;
+        }
+        uvector_append(v, g);
+    }
+    d->depth--;
+
+    return G_VECTOR(v);
+}
+
+static ugeneric_t _decode_dict(_decoder_t *d)
+{
+    size_t size;
+    ugeneric_t k, v;
+
+    if (d->depth == UGENERIC_BINARY_MAX_DEPTH)
+    {
+        return G_ERROR(ustring_dup("nesting too deep"));
+    }
+    if (!_decode_size(d, &size))
+    {
+        return G_ERROR(ustring_dup("invalid dict size"));
+    }
+    d->depth++;
+
+    udict_t *dict = udict_create();
+    while (size--)
+    {
+        if (G_IS_ERROR(k = _decode_item(d)))
+        {
+            udict_destroy(dict);
+            return k;
+        }
+        if (G_IS_ERROR(v = _decode_item(d)))
+        {
+            ugeneric_destroy(k);
+            udict_destroy(dict);
+            return v;
+        }
+        udict_put(dict, k, v);
+    }
+    d->depth--;
+
+    return G_DICT(dict);
+}
+
+static ugeneric_t _decode_item(_decoder_t *d)
+{
+    uintmax_t u;
+    uint64_t bits;
+    double real;
+    size_t size;
+    void *data;
+
+    if (d->p == d->end)
+    {
+        return G_ERROR(ustring_dup("unexpected end of data"));
+    }
+
+    switch (*d->p++)
+    {
+        case G_NULL_T:
+            return G_NULL();
+
+        case G_BOOL_T:
+            if (d->p == d->end || *d->p > 1)
+            {
+                return G_ERROR(ustring_dup("invalid boolean"));
+            }
+            return G_BOOL(*d->p++);
+
+        case G_INT_T:
+            if (!_decode_varint(d, &u) || (u >> 1) > LONG_MAX)
+            {
+                return G_ERROR(ustring_dup("invalid integer"));
+            }
+            return G_INT((u & 1) ? -(long)(u >> 1) - 1 : (long)(u >> 1));
+
+        case G_SIZE_T:
+            if (!_decode_varint(d, &u) || u > SIZE_MAX)
+            {
+                return G_ERROR(ustring_dup("invalid size"));
+            }
+            return G_SIZE(u);
+
+        case G_REAL_T:
+            if (d->end - d->p < (ptrdiff_t)sizeof(bits))
+            {
+                return G_ERROR(ustring_dup("unexpected end of data"));
+            }
+            bits = 0;
+            for (size_t i = 0; i < sizeof(bits); i++)
+            {
+                bits |= (uint64_t)*d->p++ << (8 * i);
+            }
+            memcpy(&real, &bits, sizeof(real));
+            return G_REAL(real);
+
+        case G_STR_T:
+            if (!_decode_size(d, &size) || size == (size_t)(d->end - d->p) ||
+                d->p[size] != '\0' || memchr(d->p, '\0', size))
+            {
+                return G_ERROR(ustring_dup("invalid string"));
+            }
+            data = (void *)d->p;
+            d->p += size + 1;
+            return G_CSTR(data);
+
+        case G_MEMCHUNK_T:
+            if (!_decode_size(d, &size))
+            {
+                return G_ERROR(ustring_dup("invalid memchunk size"));
+            }
+            data = size ? umemdup(d->p, size) : NULL;
+            d->p += size;
+            return G_MEMCHUNK(data, size);
+
+        case G_VECTOR_T:
+            return _decode_vector(d);
+
+        case G_DICT_T:
+            return _decode_dict(d);
+
+        default:
+            d->p--;
+            return G_ERROR(ustring_dup("unexpected type tag"));
+    }
+}
+
+ugeneric_t ugeneric_decode_binary(const void *data, size_t size)
+{
+    UASSERT_INPUT(data || !size);
+    const char *err_msg = "Decoding failed at offset %zu: %s.";
+
+    _decoder_t d = {data, (const unsigned char *)data + size, 0};
+    ugeneric_t g = _decode_item(&d);
+    size_t offset = d.p - (const unsigned char *)data;
+
+    if (d.p != d.end && !G_IS_ERROR(g))
+    {
+        ugeneric_destroy(g);
+        g = G_ERROR(ustring_fmt(err_msg, offset, "trailing data"));
+    }
+    else if (G_IS_ERROR(g))
+    {
+        ugeneric_t t = G_ERROR(ustring_fmt(err_msg, offset, G_AS_STR(g)));
+        ugeneric_error_destroy(g);
+        g = t;
+    }
+
+    return g;
+}
+
 // [l, r]
 void ugeneric_array_reverse(ugeneric_t *base, size_t nmemb, size_t l, size_t r)
 {
@@ -905,6 +1391,156 @@ size_t ugeneric_array_bsearch(ugeneric_t *base, size_t nmemb, ugeneric_t e,
     return (nmemb) ? _bsearch(base, 0, nmemb - 1, e, cmp) : SIZE_MAX;
 }
 
+/*
+ * Linear search. An item equal to a number has one of at most three value
+ * words: the integer, the double and, for zero, negative zero. Blocks of
+ * cells are screened for those words without looking at the types, which
+ * compiles to a plain vectorizable loop, and only the candidates go through
+ * ugeneric_compare_v(). Numbers beyond 2^53 and NaN compare with rounding
+ * (or abort), so they take the slow path.
+ */
+#define FIND_BLOCK 64
+#define EXACT_DOUBLE_LIMIT 9007199254740992.0 // 2^53
+
+static bool _number_words(ugeneric_t e, uint64_t words[3])
+{
+    double d;
+    bool integral = true;
+    uint64_t i = 0;
+
+    switch (ugeneric_get_type(e))
+    {
+        case G_INT_T:
+            d = G_AS_INT(e);
+            i = G_AS_INT(e);
+            break;
+
+        case G_SIZE_T:
+            d = G_AS_SIZE(e);
+            i = G_AS_SIZE(e);
+            break;
+
+        case G_REAL_T:
+            d = G_AS_REAL(e);
+            break;
+
+        default:
+            return false;
+    }
+
+    // Also rejects NaN, and keeps the casts below in range.
+    if (!((d < EXACT_DOUBLE_LIMIT) && (d > -EXACT_DOUBLE_LIMIT)))
+    {
+        return false;
+    }
+    if (ugeneric_get_type(e) == G_REAL_T)
+    {
+        integral = ((double)(long)d == d);
+        i = (long)d;
+    }
+
+    d = (d == 0) ? 0.0 : d;
+    memcpy(&words[1], &d, sizeof(d));
+    d = -0.0;
+    memcpy(&words[2], &d, sizeof(d));
+    if (words[1] != 0)
+    {
+        words[2] = words[1];
+    }
+    words[0] = integral ? i : words[1];
+
+    return true;
+}
+
+// Bit i is set if the value word of base[i] is one of words.
+static uint64_t _candidates(const ugeneric_t *base, size_t nmemb,
+                            const uint64_t words[3])
+{
+    const uint64_t w0 = words[0];
+    const uint64_t w1 = words[1];
+    const uint64_t w2 = words[2];
+    uint64_t mask = 0;
+    for (size_t i = 0; i < nmemb; i++)
+    {
+        uint64_t w = base[i].v.size;
+        mask |= (uint64_t)((w == w0) | (w == w1) | (w == w2)) << i;
+    }
+
+    return mask;
+}
+
+static inline size_t _lowest_bit(uint64_t mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#else
+    size_t i = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+// Matches of e in [start, nmemb), stops after limit of them.
+static size_t _find(const ugeneric_t *base, size_t nmemb, size_t start,
+                    ugeneric_t e, void_cmp_t cmp, size_t limit,
+                    size_t *first)
+{
+    size_t count = 0;
+    uint64_t words[3];
+    *first = SIZE_MAX;
+
+    if (!_number_words(e, words))
+    {
+        for (size_t i = start; (i < nmemb) && (count < limit); i++)
+        {
+            if ((ugeneric_compare_v(base[i], e, cmp) == 0) && (count++ == 0))
+            {
+                *first = i;
+            }
+        }
+        return count;
+    }
+
+    for (size_t i = start; (i < nmemb) && (count < limit); i += FIND_BLOCK)
+    {
+        uint64_t mask = _candidates(base + i, MIN(nmemb - i, FIND_BLOCK), words);
+        for (; mask && (count < limit); mask &= mask - 1)
+        {
+            size_t j = i + _lowest_bit(mask);
+            if ((ugeneric_compare_v(base[j], e, cmp) == 0) && (count++ == 0))
+            {
+                *first = j;
+            }
+        }
+    }
+
+    return count;
+}
+
+size_t ugeneric_array_find(const ugeneric_t *base, size_t nmemb, size_t start,
+                           ugeneric_t e, void_cmp_t cmp)
+{
+    UASSERT_INPUT(base || !nmemb);
+
+    size_t first;
+    _find(base, nmemb, start, e, cmp, 1, &first);
+
+    return first;
+}
+
+size_t ugeneric_array_count(const ugeneric_t *base, size_t nmemb, ugeneric_t e,
+                            void_cmp_t cmp)
+{
+    UASSERT_INPUT(base || !nmemb);
+
+    size_t first;
+    return _find(base, nmemb, 0, e, cmp, SIZE_MAX, &first);
+}
+
 /*
  * murmur3 hash implementation, credits to Austin Appleby.
  */
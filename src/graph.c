@@ -149,6 +149,25 @@ void ugraph_destroy(ugraph_t *g)
     }
 }
 
+umem_usage_t ugraph_get_memory_usage(const ugraph_t *g)
+{
+    UASSERT_INPUT(g);
+
+    // Adjacency lists are reported as nodes of the graph and edges as its
+    // payload, both are opaque pointers for the vector holding them.
+    umem_usage_t u = uvector_get_memory_usage(g->adj);
+    u.header += sizeof(*g);
+    for (size_t i = 0; i < g->n; i++)
+    {
+        umem_usage_t lu = ulist_get_memory_usage(G_AS_PTR(uvector_get_at(g->adj, i)));
+        u.nodes += lu.header + lu.nodes;
+        u.payload += ulist_get_size(G_AS_PTR(uvector_get_at(g->adj, i))) *
+                     sizeof(ugraph_edge_t);
+    }
+
+    return u;
+}
+
 uvector_t *ugraph_get_edges(const ugraph_t *g)
 {
     UASSERT_INPUT(g);
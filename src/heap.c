@@ -20,9 +20,10 @@ struct uheap_opaq {
 
 static uheap_t *_hcpy(const uheap_t *h, bool deep)
 {
-    uheap_t *copy = umalloc(sizeof(*copy));
+    uvector_t *data = deep ? uvector_deep_copy(h->data) : uvector_copy(h->data);
+    uheap_t *copy = uallocator_alloc(uvector_get_allocator(data), sizeof(*copy));
     *copy = *h;
-    copy->data = deep ? uvector_deep_copy(h->data) : uvector_copy(h->data);
+    copy->data = data;
     return copy;
 }
 
@@ -60,7 +61,7 @@ uheap_t *uheap_build_from_array(const ugeneric_t *base, size_t nmemb,
                                 uheap_type_t type,
                                 uvoid_handlers_t *void_handlers)
 {
-    uheap_t *h = uheap_create_ext(nmemb, type);
+    uheap_t *h = uheap_create_ext(nmemb, type, NULL);
 
     if (void_handlers)
     {
@@ -95,14 +96,16 @@ uheap_t *uheap_build_from_array(const ugeneric_t *base, size_t nmemb,
 
 uheap_t *uheap_create(void)
 {
-    return uheap_create_ext(HEAP_INITIAL_CAPACITY, UHEAP_TYPE_MIN);
+    return uheap_create_ext(HEAP_INITIAL_CAPACITY, UHEAP_TYPE_MIN, NULL);
 }
 
-uheap_t *uheap_create_ext(size_t capacity, uheap_type_t type)
+uheap_t *uheap_create_ext(size_t capacity, uheap_type_t type,
+                          const uallocator_t *allocator)
 {
     UASSERT_INPUT((type == UHEAP_TYPE_MIN) || (type == UHEAP_TYPE_MAX));
-    uheap_t *h = umalloc(sizeof(*h));
-    h->data = uvector_create();
+    allocator = allocator ? allocator : uallocator_get_default();
+    uheap_t *h = uallocator_alloc(allocator, sizeof(*h));
+    h->data = uvector_create_ext(allocator);
     uvector_reserve_capacity(h->data, capacity);
     h->type = type;
 
@@ -113,8 +116,9 @@ void uheap_destroy(uheap_t *h)
 {
     if (h)
     {
+        const uallocator_t *allocator = uvector_get_allocator(h->data);
         uvector_destroy(h->data);
-        ufree(h);
+        uallocator_free(allocator, h, sizeof(*h));
     }
 }
 
@@ -262,6 +266,16 @@ ugeneric_base_t *uheap_get_base(uheap_t *h)
     return uvector_get_base(h->data);
 }
 
+umem_usage_t uheap_get_memory_usage(const uheap_t *h)
+{
+    UASSERT_INPUT(h);
+
+    umem_usage_t u = uvector_get_memory_usage(h->data);
+    u.header += sizeof(*h);
+
+    return u;
+}
+
 char *uheap_as_str(const uheap_t *h)
 {
     return uvector_as_str(h->data);
@@ -32,6 +32,8 @@ typedef struct {
 struct uhtbl_opaq {
     uvoid_handlers_t void_handlers;
     bool is_data_owner;
+    const uallocator_t *allocator;
+    upool_t *records; // chaining only
     uhtbl_type_t type;
     union {
         uhtbl_record_t **c_buckets; // chaining
@@ -47,6 +49,7 @@ struct uhtbl_opaq {
 
 struct uhtbl_iterator_opaq {
     const uhtbl_t *htbl;
+    const uallocator_t *allocator;
     uhtbl_record_t *current_dr;
     size_t bucket;
     size_t records_to_iterate;
@@ -80,9 +83,10 @@ static const uhtbl_vtable_t _uhtbl_c_table = {
     .load_threshold = UHTBL_C_LOAD_THRESHOLD,
 };
 
-static ugeneric_kv_t *_oa_allocate_buckets(size_t count)
+static ugeneric_kv_t *_oa_allocate_buckets(uhtbl_t *h, size_t count)
 {
-    ugeneric_kv_t *buckets = umalloc(count * sizeof(*buckets));
+    ugeneric_kv_t *buckets = uallocator_alloc(h->allocator,
+                                              count * sizeof(*buckets));
     for (size_t i = 0; i < count; i++)
     {
         _SET_TO_EMPTY(buckets + i);
@@ -109,20 +113,18 @@ static void _c_destroy_buckets(uhtbl_t *h)
 {
     for (size_t i = 0; i < h->number_of_buckets; i++)
     {
-        uhtbl_record_t *hr = h->c_buckets[i];
-        while (hr)
+        if (h->is_data_owner)
         {
-            uhtbl_record_t *hr_next = hr->next;
-            if (h->is_data_owner)
+            for (uhtbl_record_t *hr = h->c_buckets[i]; hr; hr = hr->next)
             {
                 ugeneric_destroy_v(hr->kv.k, h->void_handlers.dtr);
                 ugeneric_destroy_v(hr->kv.v, h->void_handlers.dtr);
             }
-            ufree(hr);
-            hr = hr_next;
         }
         h->c_buckets[i] = NULL;
     }
+    // All the records go away with their slabs.
+    upool_reset(h->records);
 }
 
 /*
@@ -319,7 +321,7 @@ static void _c_put(uhtbl_t *h, ugeneric_t k, ugeneric_t v)
     else
     {
         // Insert a new one.
-        *hr = umalloc(sizeof(uhtbl_record_t));
+        *hr = upool_alloc(h->records);
         (*hr)->kv.k = k;
         (*hr)->kv.v = v;
         (*hr)->next = NULL;
@@ -355,7 +357,7 @@ static bool _c_pop(uhtbl_t *h, ugeneric_t k, ugeneric_t *out)
         *out = del->kv.v;
         ugeneric_destroy_v(del->kv.k, h->void_handlers.dtr);
         *hr = (*hr)->next;
-        ufree(del);
+        upool_free(h->records, del);
         h->number_of_records -= 1;
         ret = true;
     }
@@ -374,8 +376,8 @@ static void _resize(uhtbl_t *h)
     switch (h->type)
     {
         case UHTBL_TYPE_CHAINING:
-            new_table.oa_buckets = ucalloc(new_table.number_of_buckets,
-                                           sizeof(new_table.c_buckets[0]));
+            new_table.c_buckets = uallocator_zalloc(h->allocator,
+                new_table.number_of_buckets * sizeof(new_table.c_buckets[0]));
             for (size_t i = 0; i < h->number_of_buckets; i++)
             {
                 uhtbl_record_t *hr = h->c_buckets[i];
@@ -383,14 +385,15 @@ static void _resize(uhtbl_t *h)
                 {
                     uhtbl_record_t *t = hr->next;
                     _c_put(&new_table, hr->kv.k, hr->kv.v);
-                    ufree(hr);
+                    upool_free(h->records, hr);
                     hr = t;
                 }
             }
-            ufree(h->c_buckets);
+            uallocator_free(h->allocator, h->c_buckets,
+                            h->number_of_buckets * sizeof(h->c_buckets[0]));
             break;
         case UHTBL_TYPE_OPEN_ADDRESSING:
-            new_table.oa_buckets = _oa_allocate_buckets(new_table.number_of_buckets);
+            new_table.oa_buckets = _oa_allocate_buckets(h, new_table.number_of_buckets);
             for (size_t i = 0; i < h->number_of_buckets; i++)
             {
                 ugeneric_kv_t *kv = &h->oa_buckets[i];
@@ -399,7 +402,8 @@ static void _resize(uhtbl_t *h)
                     _oa_put(&new_table, kv->k, kv->v);
                 }
             }
-            ufree(h->oa_buckets);
+            uallocator_free(h->allocator, h->oa_buckets,
+                            h->number_of_buckets * sizeof(h->oa_buckets[0]));
             break;
         default:
             UABORT("internal error");
@@ -415,23 +419,38 @@ uhtbl_t *uhtbl_create(void)
 }
 
 uhtbl_t *uhtbl_create_with_type(uhtbl_type_t type)
+{
+    return uhtbl_create_ext(type, NULL);
+}
+
+uhtbl_t *uhtbl_create_with_arena(uhtbl_type_t type, uarena_t *arena)
+{
+    return uhtbl_create_ext(type, arena ? uarena_get_allocator(arena) : NULL);
+}
+
+uhtbl_t *uhtbl_create_ext(uhtbl_type_t type, const uallocator_t *allocator)
 {
     UASSERT_INPUT(type >= UHTBL_TYPE_DEFAULT);
     UASSERT_INPUT(type < UHTBL_TYPE_MAX);
 
-    uhtbl_t *h = umalloc(sizeof(*h));
+    allocator = allocator ? allocator : uallocator_get_default();
+    uhtbl_t *h = uallocator_alloc(allocator, sizeof(*h));
 
+    h->allocator = allocator;
+    h->records = NULL;
     h->type = (type == UHTBL_TYPE_DEFAULT) ? _default_type : type;
 
     switch (h->type)
     {
         case UHTBL_TYPE_CHAINING:
             h->vtable = &_uhtbl_c_table;
-            h->c_buckets = ucalloc(UHTBL_INITIAL_NUM_OF_BUCKETS, sizeof(h->c_buckets[0]));
+            h->records = upool_create(sizeof(uhtbl_record_t), allocator);
+            h->c_buckets = uallocator_zalloc(allocator,
+                UHTBL_INITIAL_NUM_OF_BUCKETS * sizeof(h->c_buckets[0]));
             break;
         case UHTBL_TYPE_OPEN_ADDRESSING:
             h->vtable = &_uhtbl_oa_table;
-            h->oa_buckets = _oa_allocate_buckets(UHTBL_INITIAL_NUM_OF_BUCKETS);
+            h->oa_buckets = _oa_allocate_buckets(h, UHTBL_INITIAL_NUM_OF_BUCKETS);
             break;
         default:
             UABORT("internal error");
@@ -530,15 +549,18 @@ void uhtbl_destroy(uhtbl_t *h)
         switch (h->type)
         {
             case UHTBL_TYPE_CHAINING:
-                ufree(h->c_buckets);
+                uallocator_free(h->allocator, h->c_buckets,
+                                h->number_of_buckets * sizeof(h->c_buckets[0]));
                 break;
             case UHTBL_TYPE_OPEN_ADDRESSING:
-                ufree(h->oa_buckets);
+                uallocator_free(h->allocator, h->oa_buckets,
+                                h->number_of_buckets * sizeof(h->oa_buckets[0]));
                 break;
             default:
                 UABORT("internal error");
         }
-        ufree(h);
+        upool_destroy(h->records);
+        uallocator_free(h->allocator, h, sizeof(*h));
     }
 }
 
@@ -588,11 +610,7 @@ int uhtbl_fprint(const uhtbl_t *h, FILE *out)
     UASSERT_INPUT(h);
     UASSERT_INPUT(out);
 
-    char *str = uhtbl_as_str(h);
-    int ret = fprintf(out, "%s\n", str);
-    ufree(str);
-
-    return ret;
+    return ubuffer_fprint_serialized((ubuffer_s8r_t)uhtbl_serialize, h, out);
 }
 
 void uhtbl_dump_to_dot(const uhtbl_t *h, const char *name, FILE *out)
@@ -678,8 +696,9 @@ uhtbl_iterator_t *uhtbl_iterator_create(const uhtbl_t *h)
 {
     UASSERT_INPUT(h);
 
-    uhtbl_iterator_t *hi = umalloc(sizeof(*hi));
+    uhtbl_iterator_t *hi = uallocator_alloc(h->allocator, sizeof(*hi));
     hi->htbl = h;
+    hi->allocator = h->allocator;
     hi->bucket = 0;
     hi->records_to_iterate = h->number_of_records;
     hi->current_dr = NULL;
@@ -731,7 +750,7 @@ void uhtbl_iterator_destroy(uhtbl_iterator_t *hi)
 {
     if (hi)
     {
-        ufree(hi);
+        uallocator_free(hi->allocator, hi, sizeof(*hi));
     }
 }
 
@@ -797,3 +816,42 @@ ugeneric_base_t *uhtbl_get_base(uhtbl_t *h)
     UASSERT_INPUT(h);
     return (ugeneric_base_t *)h;
 }
+
+umem_usage_t uhtbl_get_memory_usage(const uhtbl_t *h)
+{
+    UASSERT_INPUT(h);
+
+    umem_usage_t u = {0};
+    u.header = sizeof(*h);
+    switch (h->type)
+    {
+        case UHTBL_TYPE_CHAINING:
+            u.nodes = upool_get_allocated_size(h->records);
+            u.buckets = h->number_of_buckets * sizeof(h->c_buckets[0]);
+            for (size_t i = 0; h->is_data_owner && (i < h->number_of_buckets); i++)
+            {
+                for (uhtbl_record_t *hr = h->c_buckets[i]; hr; hr = hr->next)
+                {
+                    u.payload += ugeneric_get_memory_usage(hr->kv.k);
+                    u.payload += ugeneric_get_memory_usage(hr->kv.v);
+                }
+            }
+            break;
+        case UHTBL_TYPE_OPEN_ADDRESSING:
+            u.buckets = h->number_of_buckets * sizeof(h->oa_buckets[0]);
+            for (size_t i = 0; h->is_data_owner && (i < h->number_of_buckets); i++)
+            {
+                const ugeneric_kv_t *kv = &h->oa_buckets[i];
+                if (!_IS_EMPTY(kv) && !_IS_TOMBSTONE(kv))
+                {
+                    u.payload += ugeneric_get_memory_usage(kv->k);
+                    u.payload += ugeneric_get_memory_usage(kv->v);
+                }
+            }
+            break;
+        default:
+            UABORT("internal error");
+    }
+
+    return u;
+}
@@ -12,6 +12,8 @@ typedef struct ulist_item {
 struct ulist_opaq {
     uvoid_handlers_t void_handlers;
     bool is_data_owner;
+    const uallocator_t *allocator;
+    upool_t *items;
     size_t size;
     ulist_item_t *head;
     ulist_item_t *tail;
@@ -19,6 +21,7 @@ struct ulist_opaq {
 
 struct ulist_iterator_opaq {
     const ulist_t *list;
+    const uallocator_t *allocator;
     ulist_item_t *current;
     ulist_item_t fake;
     bool rev;
@@ -58,7 +61,7 @@ static ugeneric_t _pop_at(ulist_t *l, size_t i)
         t->prev->next = t->next;
     }
 
-    ufree(t);
+    upool_free(l->items, t);
     l->size--;
 
     return g;
@@ -68,8 +71,12 @@ static ulist_t *_lcpy(const ulist_t *l, bool deep)
 {
     UASSERT_INPUT(l);
 
-    ulist_t *copy = ulist_create();
+    const uallocator_t *allocator = uallocator_get_copy_allocator(l->allocator);
+    ulist_t *copy = ulist_create_ext(allocator);
+    upool_t *items = copy->items;
     *copy = *l;
+    copy->allocator = allocator;
+    copy->items = items;
 
     ulist_item_t *from = l->head;
     ulist_item_t **to = &copy->head;
@@ -78,7 +85,7 @@ static ulist_t *_lcpy(const ulist_t *l, bool deep)
     copy->is_data_owner = deep;
     while (from)
     {
-        *to = umalloc(sizeof(**to));
+        *to = upool_alloc(copy->items);
         (*to)->data = deep ? ugeneric_copy_v(from->data, l->void_handlers.cpy) : from->data;
         (*to)->next = NULL;
         (*to)->prev = prev;
@@ -94,8 +101,16 @@ static ulist_t *_lcpy(const ulist_t *l, bool deep)
 
 ulist_t *ulist_create(void)
 {
-    ulist_t *l = umalloc(sizeof(*l));
+    return ulist_create_ext(NULL);
+}
+
+ulist_t *ulist_create_ext(const uallocator_t *allocator)
+{
+    allocator = allocator ? allocator : uallocator_get_default();
+    ulist_t *l = uallocator_alloc(allocator, sizeof(*l));
 
+    l->allocator = allocator;
+    l->items = upool_create(sizeof(ulist_item_t), allocator);
     l->size = 0;
     l->is_data_owner = true;
     l->head = NULL;
@@ -105,12 +120,17 @@ ulist_t *ulist_create(void)
     return l;
 }
 
+ulist_t *ulist_create_with_arena(uarena_t *arena)
+{
+    return ulist_create_ext(arena ? uarena_get_allocator(arena) : NULL);
+}
+
 void ulist_insert_at(ulist_t *l, size_t i, ugeneric_t e)
 {
     UASSERT_INPUT(l);
     UASSERT_INPUT(i < l->size);
 
-    ulist_item_t *li = umalloc(sizeof(*li));
+    ulist_item_t *li = upool_alloc(l->items);
     li->data = e;
 
     ulist_item_t *t = _rewind_to(l, i);
@@ -137,7 +157,7 @@ void ulist_append(ulist_t *l, ugeneric_t e)
 {
     UASSERT_INPUT(l);
 
-    ulist_item_t *li = umalloc(sizeof(*li));
+    ulist_item_t *li = upool_alloc(l->items);
     li->data = e;
     li->next = NULL;
 
@@ -159,7 +179,7 @@ void ulist_prepend(ulist_t *l, ugeneric_t e)
 {
     UASSERT_INPUT(l);
 
-    ulist_item_t *li = umalloc(sizeof(*li));
+    ulist_item_t *li = upool_alloc(l->items);
     li->data = e;
     li->prev = NULL;
 
@@ -202,19 +222,15 @@ void ulist_clear(ulist_t *l)
 {
     UASSERT_INPUT(l);
 
-    ulist_item_t *li = l->head;
-    ulist_item_t *t;
-
-    while (li)
+    if (l->is_data_owner)
     {
-        if (l->is_data_owner)
+        for (ulist_item_t *li = l->head; li; li = li->next)
         {
             ugeneric_destroy_v(li->data, l->void_handlers.dtr);
         }
-        t = li;
-        li = li->next;
-        ufree(t);
     }
+    // All the items go away with their slabs.
+    upool_reset(l->items);
     l->head = NULL;
     l->tail = NULL;
     l->size = 0;
@@ -225,7 +241,8 @@ void ulist_destroy(ulist_t *l)
     if (l)
     {
         ulist_clear(l);
-        ufree(l);
+        upool_destroy(l->items);
+        uallocator_free(l->allocator, l, sizeof(*l));
     }
 }
 
@@ -376,11 +393,7 @@ int ulist_fprint(const ulist_t *l, FILE *out)
     UASSERT_INPUT(l);
     UASSERT_INPUT(out);
 
-    char *str = ulist_as_str(l);
-    int ret = fprintf(out, "%s\n", str);
-    ufree(str);
-
-    return ret;
+    return ubuffer_fprint_serialized((ubuffer_s8r_t)ulist_serialize, l, out);
 }
 
 void ulist_serialize(const ulist_t *l, ubuffer_t *buf)
@@ -433,9 +446,10 @@ static void _iterator_reset(ulist_iterator_t *li)
 static ulist_iterator_t *_iterator_create(const ulist_t *l, bool rev)
 {
     UASSERT_INPUT(l);
-    ulist_iterator_t *li = umalloc(sizeof(*li));
+    ulist_iterator_t *li = uallocator_alloc(l->allocator, sizeof(*li));
 
     li->list = l;
+    li->allocator = l->allocator;
     li->rev = rev;
 
     _iterator_reset(li);
@@ -547,7 +561,7 @@ void ulist_iterator_destroy(ulist_iterator_t *li)
 {
     if (li)
     {
-        ufree(li);
+        uallocator_free(li->allocator, li, sizeof(*li));
     }
 }
 
@@ -562,3 +576,21 @@ ugeneric_base_t *ulist_get_base(ulist_t *l)
     UASSERT_INPUT(l);
     return (ugeneric_base_t *)l;
 }
+
+umem_usage_t ulist_get_memory_usage(const ulist_t *l)
+{
+    UASSERT_INPUT(l);
+
+    umem_usage_t u = {0};
+    u.header = sizeof(*l);
+    u.nodes = upool_get_allocated_size(l->items);
+    if (l->is_data_owner)
+    {
+        for (ulist_item_t *li = l->head; li; li = li->next)
+        {
+            u.payload += ugeneric_get_memory_usage(li->data);
+        }
+    }
+
+    return u;
+}
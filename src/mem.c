@@ -1,6 +1,15 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, madvise() and syscall()
+
 #include "mem.h"
 #include "asserts.h"
 #include "generic.h"
+#include <limits.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 static bool _default_oom_handler(void *ctx)
 {
@@ -116,9 +125,681 @@ void *umemdup(const void *src, size_t n)
     return memcpy(umalloc(n), src, n);
 }
 
+static size_t _size_class(size_t size)
+{
+    size_t c = 0;
+    while ((c < UMEM_SIZE_CLASSES - 1) && (((size_t)1 << c) < size))
+    {
+        c++;
+    }
+
+    return c;
+}
+
+static void _stats_on_alloc(umem_stats_t *s, size_t size)
+{
+    s->histogram[_size_class(size)]++;
+    s->allocs++;
+    s->bytes_live += size;
+    s->bytes_peak = MAX(s->bytes_peak, s->bytes_live);
+}
+
+// Blocks allocated before the counting started may be freed later on.
+static void _stats_on_free(umem_stats_t *s, size_t size)
+{
+    s->frees++;
+    s->bytes_live -= MIN(size, s->bytes_live);
+}
+
+/*
+ * The global counters are updated from whichever thread allocates, they are
+ * atomic (relaxed, there is nothing to order them with) and consistent one
+ * by one only, not as a whole.
+ */
+typedef struct {
+    atomic_size_t bytes_live;
+    atomic_size_t bytes_peak;
+    atomic_size_t allocs;
+    atomic_size_t frees;
+    atomic_size_t histogram[UMEM_SIZE_CLASSES];
+} _shared_stats_t;
+
+static atomic_bool _mem_stats_enabled = false;
+static _shared_stats_t _mem_stats;
+
+static void _shared_stats_on_alloc(_shared_stats_t *s, size_t size)
+{
+    atomic_fetch_add_explicit(&s->histogram[_size_class(size)], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->allocs, 1, memory_order_relaxed);
+    size_t live = atomic_fetch_add_explicit(&s->bytes_live, size,
+                                            memory_order_relaxed) + size;
+    size_t peak = atomic_load_explicit(&s->bytes_peak, memory_order_relaxed);
+    while ((live > peak) &&
+           !atomic_compare_exchange_weak_explicit(&s->bytes_peak, &peak, live,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+    {
+    }
+}
+
+static void _shared_stats_on_free(_shared_stats_t *s, size_t size)
+{
+    atomic_fetch_add_explicit(&s->frees, 1, memory_order_relaxed);
+    size_t live = atomic_load_explicit(&s->bytes_live, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&s->bytes_live, &live,
+                                                  live - MIN(size, live),
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+    {
+    }
+}
+
+static bool _shared_stats_enabled(void)
+{
+    return atomic_load_explicit(&_mem_stats_enabled, memory_order_relaxed);
+}
+
+void libugeneric_enable_mem_stats(bool enable)
+{
+    atomic_store(&_mem_stats_enabled, enable);
+}
+
+void libugeneric_get_mem_stats(umem_stats_t *stats)
+{
+    UASSERT_INPUT(stats);
+
+    stats->bytes_live = atomic_load(&_mem_stats.bytes_live);
+    stats->bytes_peak = atomic_load(&_mem_stats.bytes_peak);
+    stats->allocs = atomic_load(&_mem_stats.allocs);
+    stats->frees = atomic_load(&_mem_stats.frees);
+    for (size_t i = 0; i < UMEM_SIZE_CLASSES; i++)
+    {
+        stats->histogram[i] = atomic_load(&_mem_stats.histogram[i]);
+    }
+}
+
+void libugeneric_reset_mem_stats(void)
+{
+    atomic_store(&_mem_stats.bytes_live, 0);
+    atomic_store(&_mem_stats.bytes_peak, 0);
+    atomic_store(&_mem_stats.allocs, 0);
+    atomic_store(&_mem_stats.frees, 0);
+    for (size_t i = 0; i < UMEM_SIZE_CLASSES; i++)
+    {
+        atomic_store(&_mem_stats.histogram[i], 0);
+    }
+}
+
+static void *_default_alloc(void *ctx, size_t size)
+{
+    (void)ctx;
+    if (_shared_stats_enabled())
+    {
+        _shared_stats_on_alloc(&_mem_stats, size);
+    }
+    return umalloc(size);
+}
+
+static void *_default_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+    (void)ctx;
+    if (_shared_stats_enabled())
+    {
+        // Accounted as freeing the old block and allocating a new one.
+        if (ptr)
+        {
+            _shared_stats_on_free(&_mem_stats, old_size);
+        }
+        _shared_stats_on_alloc(&_mem_stats, size);
+    }
+    return urealloc(ptr, size);
+}
+
+static void _default_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx;
+    if (_shared_stats_enabled())
+    {
+        _shared_stats_on_free(&_mem_stats, size);
+    }
+    ufree(ptr);
+}
+
+static const uallocator_t _default_allocator = {
+    .alloc   = _default_alloc,
+    .realloc = _default_realloc,
+    .free    = _default_free,
+    .ctx     = NULL,
+};
+
+const uallocator_t *uallocator_get_default(void)
+{
+    return &_default_allocator;
+}
+
+static void *_tracker_alloc(void *ctx, size_t size)
+{
+    umem_tracker_t *t = ctx;
+    _stats_on_alloc(&t->stats, size);
+    return uallocator_alloc(t->upstream, size);
+}
+
+static void *_tracker_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+    umem_tracker_t *t = ctx;
+    if (ptr)
+    {
+        _stats_on_free(&t->stats, old_size);
+    }
+    _stats_on_alloc(&t->stats, size);
+    return uallocator_realloc(t->upstream, ptr, old_size, size);
+}
+
+static void _tracker_free(void *ctx, void *ptr, size_t size)
+{
+    umem_tracker_t *t = ctx;
+    _stats_on_free(&t->stats, size);
+    uallocator_free(t->upstream, ptr, size);
+}
+
+void umem_tracker_init(umem_tracker_t *t, const uallocator_t *upstream)
+{
+    UASSERT_INPUT(t);
+
+    memset(&t->stats, 0, sizeof(t->stats));
+    t->upstream = upstream ? upstream : uallocator_get_default();
+    t->allocator.alloc = _tracker_alloc;
+    t->allocator.realloc = _tracker_realloc;
+    t->allocator.free = _tracker_free;
+    t->allocator.ctx = t;
+}
+
+#define HUGEPAGE_ROUND(size) \
+    (((size) + HUGEPAGE_SIZE - 1) & ~((size_t)HUGEPAGE_SIZE - 1))
+#define MPOL_BIND 2
+
+static void *_hugepage_map(uhugepage_allocator_t *h, size_t size)
+{
+    size_t len = HUGEPAGE_ROUND(size);
+
+    // Over-map by a huge page to be able to cut an aligned range out of it,
+    // otherwise the kernel can't back the edges with huge pages.
+    size_t map_len = len + HUGEPAGE_SIZE;
+    int prot = PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    char *p = mmap(NULL, map_len, prot, flags, -1, 0);
+
+    if ((p == MAP_FAILED) && _oom_handler(_oom_data))
+    {
+        p = mmap(NULL, map_len, prot, flags, -1, 0);
+    }
+
+    if (p == MAP_FAILED)
+    {
+        fprintf(stderr, "out of memory error\n");
+        utrace_print();
+        exit(UGENERIC_EXIT_OOM);
+    }
+
+    char *aligned = (char *)HUGEPAGE_ROUND((uintptr_t)p);
+    if (aligned != p)
+    {
+        munmap(p, aligned - p);
+    }
+    if (aligned + len != p + map_len)
+    {
+        munmap(aligned + len, (p + map_len) - (aligned + len));
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, len, MADV_HUGEPAGE);
+#endif
+
+#ifdef SYS_mbind
+    if (h->numa_node != UNUMA_NODE_ANY)
+    {
+        // Called directly to avoid a dependency on libnuma.
+        unsigned long nodemask = 1UL << h->numa_node;
+        syscall(SYS_mbind, aligned, len, MPOL_BIND, &nodemask,
+                sizeof(nodemask) * CHAR_BIT + 1, 0);
+    }
+#endif
+
+    h->bytes_mapped += len;
+
+    return aligned;
+}
+
+static void _hugepage_unmap(uhugepage_allocator_t *h, void *ptr, size_t size)
+{
+    size_t len = HUGEPAGE_ROUND(size);
+    munmap(ptr, len);
+    h->bytes_mapped -= len;
+}
+
+static void *_hugepage_alloc(void *ctx, size_t size)
+{
+    uhugepage_allocator_t *h = ctx;
+    if (size < h->threshold)
+    {
+        return uallocator_alloc(h->upstream, size);
+    }
+    return _hugepage_map(h, size);
+}
+
+static void *_hugepage_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+    uhugepage_allocator_t *h = ctx;
+    bool was_mapped = ptr && (old_size >= h->threshold);
+    bool is_mapped = size >= h->threshold;
+
+    if (!was_mapped && !is_mapped)
+    {
+        return uallocator_realloc(h->upstream, ptr, old_size, size);
+    }
+
+    if (was_mapped && is_mapped &&
+        (HUGEPAGE_ROUND(old_size) == HUGEPAGE_ROUND(size)))
+    {
+        return ptr;
+    }
+
+    void *p = _hugepage_alloc(h, size);
+    if (ptr)
+    {
+        memcpy(p, ptr, MIN(old_size, size));
+        if (was_mapped)
+        {
+            _hugepage_unmap(h, ptr, old_size);
+        }
+        else
+        {
+            uallocator_free(h->upstream, ptr, old_size);
+        }
+    }
+
+    return p;
+}
+
+static void _hugepage_free(void *ctx, void *ptr, size_t size)
+{
+    uhugepage_allocator_t *h = ctx;
+    if (size < h->threshold)
+    {
+        uallocator_free(h->upstream, ptr, size);
+    }
+    else
+    {
+        _hugepage_unmap(h, ptr, size);
+    }
+}
+
+void uhugepage_allocator_init(uhugepage_allocator_t *h,
+                              const uallocator_t *upstream, size_t threshold,
+                              int numa_node)
+{
+    UASSERT_INPUT(h);
+    UASSERT_INPUT(threshold);
+    UASSERT_INPUT((numa_node == UNUMA_NODE_ANY) ||
+                  ((numa_node >= 0) &&
+                   (numa_node < (int)(sizeof(unsigned long) * CHAR_BIT))));
+
+    h->upstream = upstream ? upstream : uallocator_get_default();
+    h->threshold = threshold;
+    h->numa_node = numa_node;
+    h->bytes_mapped = 0;
+    h->allocator.alloc = _hugepage_alloc;
+    h->allocator.realloc = _hugepage_realloc;
+    h->allocator.free = _hugepage_free;
+    h->allocator.ctx = h;
+}
+
+typedef struct uarena_block {
+    struct uarena_block *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} uarena_block_t;
+
+struct uarena_opaq {
+    uarena_block_t *head; // block to allocate from, older ones follow
+    size_t block_size;
+    size_t allocated;
+    uallocator_t allocator;
+};
+
+#define ARENA_ALIGN(size) \
+    (((size) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))
+
+uarena_t *uarena_create(void)
+{
+    return uarena_create_with_block_size(ARENA_DEFAULT_BLOCK_SIZE);
+}
+
+static void *_arena_alloc(void *ctx, size_t size)
+{
+    return uarena_alloc(ctx, size);
+}
+
+static void *_arena_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+    return uarena_realloc(ctx, ptr, old_size, size);
+}
+
+static void _arena_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx; (void)ptr; (void)size;
+}
+
+uarena_t *uarena_create_with_block_size(size_t block_size)
+{
+    UASSERT_INPUT(block_size);
+
+    uarena_t *a = umalloc(sizeof(*a));
+    a->head = NULL;
+    a->block_size = ARENA_ALIGN(block_size);
+    a->allocated = 0;
+    a->allocator.alloc = _arena_alloc;
+    a->allocator.realloc = _arena_realloc;
+    a->allocator.free = _arena_free;
+    a->allocator.ctx = a;
+
+    return a;
+}
+
+static uarena_block_t *_arena_block_create(size_t size)
+{
+    uarena_block_t *b = umalloc(sizeof(*b) + size);
+    b->size = size;
+    b->used = 0;
+    b->next = NULL;
+
+    return b;
+}
+
+void *uarena_alloc(uarena_t *a, size_t size)
+{
+    UASSERT_INPUT(a);
+
+    size = ARENA_ALIGN(MAX(size, 1));
+    uarena_block_t *b = a->head;
+
+    if (!b || (b->size - b->used < size))
+    {
+        if (b && (size > a->block_size / 4))
+        {
+            // Big ones get a block of their own to not waste the current one.
+            b = _arena_block_create(size);
+            b->next = a->head->next;
+            a->head->next = b;
+        }
+        else
+        {
+            b = _arena_block_create(MAX(size, a->block_size));
+            b->next = a->head;
+            a->head = b;
+        }
+    }
+
+    void *p = (char *)b->data + b->used;
+    b->used += size;
+    a->allocated += size;
+
+    return p;
+}
+
+void *uarena_realloc(uarena_t *a, void *ptr, size_t old_size, size_t size)
+{
+    UASSERT_INPUT(a);
+
+    if (!ptr)
+    {
+        return uarena_alloc(a, size);
+    }
+
+    old_size = ARENA_ALIGN(MAX(old_size, 1));
+    uarena_block_t *b = a->head;
+
+    // The last allocation can grow or shrink in place.
+    if ((char *)ptr + old_size == (char *)b->data + b->used)
+    {
+        size_t new_size = ARENA_ALIGN(MAX(size, 1));
+        if (new_size <= b->size - b->used + old_size)
+        {
+            b->used = b->used - old_size + new_size;
+            a->allocated = a->allocated - old_size + new_size;
+            return ptr;
+        }
+    }
+
+    void *p = uarena_alloc(a, size);
+    memcpy(p, ptr, MIN(old_size, size));
+
+    return p;
+}
+
+char *uarena_strdup(uarena_t *a, const char *str)
+{
+    UASSERT_INPUT(str);
+
+    size_t size = strlen(str) + 1;
+    return memcpy(uarena_alloc(a, size), str, size);
+}
+
+void uarena_reset(uarena_t *a)
+{
+    UASSERT_INPUT(a);
+
+    // Keep the newest block around if it is a regular one.
+    uarena_block_t *b = a->head;
+    if (b && (b->size == a->block_size))
+    {
+        b = b->next;
+        a->head->next = NULL;
+        a->head->used = 0;
+    }
+    else
+    {
+        a->head = NULL;
+    }
+
+    while (b)
+    {
+        uarena_block_t *next = b->next;
+        ufree(b);
+        b = next;
+    }
+    a->allocated = 0;
+}
+
+void uarena_destroy(uarena_t *a)
+{
+    if (a)
+    {
+        uarena_reset(a);
+        ufree(a->head);
+        ufree(a);
+    }
+}
+
+size_t uarena_get_allocated_size(const uarena_t *a)
+{
+    UASSERT_INPUT(a);
+    return a->allocated;
+}
+
+const uallocator_t *uarena_get_allocator(uarena_t *a)
+{
+    UASSERT_INPUT(a);
+    return &a->allocator;
+}
+
+const uallocator_t *uallocator_get_copy_allocator(const uallocator_t *a)
+{
+    return (!a || (a->alloc == _arena_alloc)) ? uallocator_get_default() : a;
+}
+
+typedef struct upool_slab {
+    struct upool_slab *next;
+    size_t size;
+    max_align_t data[];
+} upool_slab_t;
+
+struct upool_opaq {
+    const uallocator_t *allocator;
+    size_t object_size;
+    void *free_list;     // freed objects, linked through their first word
+    char *unused;        // never used tail of the newest slab
+    char *unused_end;
+    upool_slab_t *slabs;
+    size_t slab_objects; // number of objects in the next slab
+    size_t allocated;    // bytes in slabs
+};
+
+upool_t *upool_create(size_t object_size, const uallocator_t *allocator)
+{
+    UASSERT_INPUT(object_size);
+
+    allocator = allocator ? allocator : uallocator_get_default();
+    upool_t *p = uallocator_alloc(allocator, sizeof(*p));
+
+    // Objects follow each other from the max_align_t aligned start of a slab.
+    // Rounding the size up to a pointer aligns every object for pointers and
+    // leaves room for the free list link, stricter alignment holds only when
+    // the size is already a multiple of it.
+    object_size = MAX(object_size, sizeof(void *));
+    p->object_size = (object_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    p->allocator = allocator;
+    p->free_list = NULL;
+    p->unused = NULL;
+    p->unused_end = NULL;
+    p->slabs = NULL;
+    p->slab_objects = POOL_MIN_SLAB_OBJECTS;
+    p->allocated = 0;
+
+    return p;
+}
+
+void *upool_alloc(upool_t *p)
+{
+    UASSERT_INPUT(p);
+
+    if (p->free_list)
+    {
+        void *ptr = p->free_list;
+        p->free_list = *(void **)ptr;
+        return ptr;
+    }
+
+    if (p->unused == p->unused_end)
+    {
+        // Slabs grow geometrically, small containers don't waste much.
+        size_t size = p->slab_objects * p->object_size;
+        upool_slab_t *slab = uallocator_alloc(p->allocator, sizeof(*slab) + size);
+        slab->size = sizeof(*slab) + size;
+        p->allocated += slab->size;
+        slab->next = p->slabs;
+        p->slabs = slab;
+        p->unused = (char *)slab->data;
+        p->unused_end = p->unused + size;
+        if (2 * size <= POOL_MAX_SLAB_SIZE)
+        {
+            p->slab_objects *= 2;
+        }
+    }
+
+    void *ptr = p->unused;
+    p->unused += p->object_size;
+
+    return ptr;
+}
+
+void upool_free(upool_t *p, void *ptr)
+{
+    UASSERT_INPUT(p);
+
+    if (ptr)
+    {
+        *(void **)ptr = p->free_list;
+        p->free_list = ptr;
+    }
+}
+
+void upool_reset(upool_t *p)
+{
+    UASSERT_INPUT(p);
+
+    upool_slab_t *slab = p->slabs;
+    while (slab)
+    {
+        upool_slab_t *next = slab->next;
+        uallocator_free(p->allocator, slab, slab->size);
+        slab = next;
+    }
+
+    p->free_list = NULL;
+    p->unused = NULL;
+    p->unused_end = NULL;
+    p->slabs = NULL;
+    p->slab_objects = POOL_MIN_SLAB_OBJECTS;
+    p->allocated = 0;
+}
+
+void upool_destroy(upool_t *p)
+{
+    if (p)
+    {
+        upool_reset(p);
+        uallocator_free(p->allocator, p, sizeof(*p));
+    }
+}
+
+size_t upool_get_allocated_size(const upool_t *p)
+{
+    UASSERT_INPUT(p);
+    return sizeof(*p) + p->allocated;
+}
+
+void *umalloc_in(uarena_t *a, size_t size)
+{
+    return a ? uarena_alloc(a, size) : umalloc(size);
+}
+
+void *ucalloc_in(uarena_t *a, size_t nmemb, size_t size)
+{
+    if (a)
+    {
+        UASSERT_INPUT(!nmemb || (size <= SIZE_MAX / nmemb));
+        return memset(uarena_alloc(a, nmemb * size), 0, nmemb * size);
+    }
+
+    return ucalloc(nmemb, size);
+}
+
+void *urealloc_in(uarena_t *a, void *ptr, size_t old_size, size_t size)
+{
+    return a ? uarena_realloc(a, ptr, old_size, size) : urealloc(ptr, size);
+}
+
+void ufree_in(uarena_t *a, void *ptr)
+{
+    if (!a)
+    {
+        ufree(ptr);
+    }
+}
+
 void ubuffer_reserve_capacity(ubuffer_t *buf, size_t new_capacity)
 {
     UASSERT_INTERNAL(buf->data_size <= buf->capacity);
+    if (buf->sink && buf->data_size && (buf->capacity < new_capacity))
+    {
+        // The request is relative to the data which is about to go away.
+        new_capacity -= buf->data_size;
+        ubuffer_flush(buf);
+    }
+
     if (buf->capacity < new_capacity)
     {
         new_capacity = MAX(new_capacity * SCALE_FACTOR,
@@ -178,17 +859,85 @@ void ubuffer_null_terminate(ubuffer_t *buf)
     }
 }
 
-int umemchunk_fprint(umemchunk_t m, FILE *out)
+void ubuffer_attach_sink(ubuffer_t *buf, ubuffer_sink_t sink, void *ctx)
 {
-    UASSERT_INPUT(out);
+    UASSERT_INPUT(buf);
+    UASSERT_INPUT(sink);
+
+    buf->sink = sink;
+    buf->sink_ctx = ctx;
+    if (buf->capacity < BUFFER_SINK_BLOCK_SIZE)
+    {
+        buf->data = urealloc(buf->data, BUFFER_SINK_BLOCK_SIZE);
+        buf->capacity = BUFFER_SINK_BLOCK_SIZE;
+    }
+}
 
-    char *str = umemchunk_as_str(m);
-    int ret = fprintf(out, "%s\n", str);
-    ufree(str);
+bool ubuffer_flush(ubuffer_t *buf)
+{
+    UASSERT_INPUT(buf);
+    UASSERT_INPUT(buf->sink);
+
+    bool ret = true;
+    if (buf->data_size)
+    {
+        ret = buf->sink(buf->data, buf->data_size, buf->sink_ctx);
+        buf->data_size = 0;
+    }
 
     return ret;
 }
 
+bool ubuffer_file_sink(const void *data, size_t size, void *ctx)
+{
+    return fwrite(data, 1, size, ctx) == size;
+}
+
+typedef struct {
+    FILE *out;
+    size_t written;
+    bool failed;
+} _fprint_ctx_t;
+
+static bool _fprint_sink(const void *data, size_t size, void *ctx)
+{
+    _fprint_ctx_t *c = ctx;
+    if (!c->failed)
+    {
+        c->failed = !ubuffer_file_sink(data, size, c->out);
+        c->written += size;
+    }
+
+    return !c->failed;
+}
+
+int ubuffer_fprint_serialized(ubuffer_s8r_t s8r, const void *obj, FILE *out)
+{
+    UASSERT_INPUT(s8r);
+    UASSERT_INPUT(out);
+
+    ubuffer_t buf = {0};
+    _fprint_ctx_t ctx = {.out = out};
+
+    ubuffer_attach_sink(&buf, _fprint_sink, &ctx);
+    s8r(obj, &buf);
+    ubuffer_append_byte(&buf, '\n');
+    ubuffer_flush(&buf);
+    ubuffer_destroy(&buf);
+
+    return (ctx.failed || ctx.written > INT_MAX) ? -1 : (int)ctx.written;
+}
+
+static void _umemchunk_serialize(const void *m, ubuffer_t *buf)
+{
+    umemchunk_serialize(*(const umemchunk_t *)m, buf);
+}
+
+int umemchunk_fprint(umemchunk_t m, FILE *out)
+{
+    return ubuffer_fprint_serialized(_umemchunk_serialize, &m, out);
+}
+
 void umemchunk_serialize(umemchunk_t m, ubuffer_t *buf)
 {
     UASSERT_INPUT(buf);
@@ -197,14 +946,21 @@ void umemchunk_serialize(umemchunk_t m, ubuffer_t *buf)
     const char *hex = "0123456789abcdef";
 
     ubuffer_append_data(buf, "mem:", 4);
-    ubuffer_reserve_capacity(buf, buf->data_size + 2 * m.size);
-    for (size_t i = 0; i < m.size; i++)
+
+    // Go piece by piece so a buffer with a sink doesn't have to grow.
+    for (size_t done = 0; done < m.size; )
     {
-        unsigned char d = ((unsigned char *)m.data)[i];
-        ((char *)buf->data)[buf->data_size + 2 * i] = hex[d / 16];
-        ((char *)buf->data)[buf->data_size + 2 * i + 1] = hex[d % 16];
+        size_t n = MIN(m.size - done, BUFFER_SINK_BLOCK_SIZE / 4);
+        ubuffer_reserve_capacity(buf, buf->data_size + 2 * n);
+        for (size_t i = 0; i < n; i++)
+        {
+            unsigned char d = ((unsigned char *)m.data)[done + i];
+            ((char *)buf->data)[buf->data_size + 2 * i] = hex[d / 16];
+            ((char *)buf->data)[buf->data_size + 2 * i + 1] = hex[d % 16];
+        }
+        buf->data_size += (2 * n);
+        done += n;
     }
-    buf->data_size += (2 * m.size);
 }
 
 char *umemchunk_as_str(umemchunk_t m)
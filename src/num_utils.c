@@ -0,0 +1,1106 @@
+#include "num_utils.h"
+
+#include "asserts.h"
+#include "string_utils.h"
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+_Static_assert(sizeof(double) == sizeof(uint64_t), "IEEE-754 double is expected");
+
+static const char _digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static size_t _count_digits(uintmax_t v)
+{
+    size_t n = 1;
+
+    for (;;)
+    {
+        if (v < 10)    return n;
+        if (v < 100)   return n + 1;
+        if (v < 1000)  return n + 2;
+        if (v < 10000) return n + 3;
+        v /= 10000;
+        n += 4;
+    }
+}
+
+/*
+ * Digits are produced from the least significant end two at a time,
+ * so the length is calculated first to write them in place.
+ */
+static size_t _format_uint(uintmax_t v, char *out)
+{
+    size_t len = _count_digits(v);
+    char *p = out + len;
+
+    while (v >= 100)
+    {
+        size_t i = (v % 100) * 2;
+        v /= 100;
+        *--p = _digit_pairs[i + 1];
+        *--p = _digit_pairs[i];
+    }
+    if (v >= 10)
+    {
+        *--p = _digit_pairs[v * 2 + 1];
+        *--p = _digit_pairs[v * 2];
+    }
+    else
+    {
+        *--p = '0' + v;
+    }
+
+    return len;
+}
+
+size_t unum_format_long(long v, char *out)
+{
+    UASSERT_INPUT(out);
+
+    if (v < 0)
+    {
+        // Negate in unsigned domain, -LONG_MIN doesn't fit to long.
+        *out = '-';
+        return 1 + _format_uint(0 - (uintmax_t)v, out + 1);
+    }
+
+    return _format_uint(v, out);
+}
+
+size_t unum_format_size(size_t v, char *out)
+{
+    UASSERT_INPUT(out);
+    return _format_uint(v, out);
+}
+
+/*
+ * Double to string conversion is Grisu2 algorithm from "Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers" by
+ * Florian Loitsch, the code closely follows implementation by Milo Yip.
+ * The output is always read back to the same double and is the shortest
+ * such string for the overwhelming majority of inputs.
+ */
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS    (0x3ff + DP_SIGNIFICAND_SIZE)
+#define DP_SIGN_MASK        UINT64_C(0x8000000000000000)
+#define DP_EXPONENT_MASK    UINT64_C(0x7ff0000000000000)
+#define DP_SIGNIFICAND_MASK UINT64_C(0x000fffffffffffff)
+#define DP_HIDDEN_BIT       UINT64_C(0x0010000000000000)
+
+// Floating point number with 64-bit significand: f * 2^e.
+typedef struct {
+    uint64_t f;
+    int e;
+} diyfp_t;
+
+// Normalized 10^k for k = -348, -340, ..., 340.
+static const diyfp_t _cached_powers[] = {
+    {UINT64_C(0xfa8fd5a0081c0288), -1220}, // 10^-348
+    {UINT64_C(0xbaaee17fa23ebf76), -1193}, // 10^-340
+    {UINT64_C(0x8b16fb203055ac76), -1166}, // 10^-332
+    {UINT64_C(0xcf42894a5dce35ea), -1140}, // 10^-324
+    {UINT64_C(0x9a6bb0aa55653b2d), -1113}, // 10^-316
+    {UINT64_C(0xe61acf033d1a45df), -1087}, // 10^-308
+    {UINT64_C(0xab70fe17c79ac6ca), -1060}, // 10^-300
+    {UINT64_C(0xff77b1fcbebcdc4f), -1034}, // 10^-292
+    {UINT64_C(0xbe5691ef416bd60c), -1007}, // 10^-284
+    {UINT64_C(0x8dd01fad907ffc3c),  -980}, // 10^-276
+    {UINT64_C(0xd3515c2831559a83),  -954}, // 10^-268
+    {UINT64_C(0x9d71ac8fada6c9b5),  -927}, // 10^-260
+    {UINT64_C(0xea9c227723ee8bcb),  -901}, // 10^-252
+    {UINT64_C(0xaecc49914078536d),  -874}, // 10^-244
+    {UINT64_C(0x823c12795db6ce57),  -847}, // 10^-236
+    {UINT64_C(0xc21094364dfb5637),  -821}, // 10^-228
+    {UINT64_C(0x9096ea6f3848984f),  -794}, // 10^-220
+    {UINT64_C(0xd77485cb25823ac7),  -768}, // 10^-212
+    {UINT64_C(0xa086cfcd97bf97f4),  -741}, // 10^-204
+    {UINT64_C(0xef340a98172aace5),  -715}, // 10^-196
+    {UINT64_C(0xb23867fb2a35b28e),  -688}, // 10^-188
+    {UINT64_C(0x84c8d4dfd2c63f3b),  -661}, // 10^-180
+    {UINT64_C(0xc5dd44271ad3cdba),  -635}, // 10^-172
+    {UINT64_C(0x936b9fcebb25c996),  -608}, // 10^-164
+    {UINT64_C(0xdbac6c247d62a584),  -582}, // 10^-156
+    {UINT64_C(0xa3ab66580d5fdaf6),  -555}, // 10^-148
+    {UINT64_C(0xf3e2f893dec3f126),  -529}, // 10^-140
+    {UINT64_C(0xb5b5ada8aaff80b8),  -502}, // 10^-132
+    {UINT64_C(0x87625f056c7c4a8b),  -475}, // 10^-124
+    {UINT64_C(0xc9bcff6034c13053),  -449}, // 10^-116
+    {UINT64_C(0x964e858c91ba2655),  -422}, // 10^-108
+    {UINT64_C(0xdff9772470297ebd),  -396}, // 10^-100
+    {UINT64_C(0xa6dfbd9fb8e5b88f),  -369}, // 10^-92
+    {UINT64_C(0xf8a95fcf88747d94),  -343}, // 10^-84
+    {UINT64_C(0xb94470938fa89bcf),  -316}, // 10^-76
+    {UINT64_C(0x8a08f0f8bf0f156b),  -289}, // 10^-68
+    {UINT64_C(0xcdb02555653131b6),  -263}, // 10^-60
+    {UINT64_C(0x993fe2c6d07b7fac),  -236}, // 10^-52
+    {UINT64_C(0xe45c10c42a2b3b06),  -210}, // 10^-44
+    {UINT64_C(0xaa242499697392d3),  -183}, // 10^-36
+    {UINT64_C(0xfd87b5f28300ca0e),  -157}, // 10^-28
+    {UINT64_C(0xbce5086492111aeb),  -130}, // 10^-20
+    {UINT64_C(0x8cbccc096f5088cc),  -103}, // 10^-12
+    {UINT64_C(0xd1b71758e219652c),   -77}, // 10^-4
+    {UINT64_C(0x9c40000000000000),   -50}, // 10^4
+    {UINT64_C(0xe8d4a51000000000),   -24}, // 10^12
+    {UINT64_C(0xad78ebc5ac620000),     3}, // 10^20
+    {UINT64_C(0x813f3978f8940984),    30}, // 10^28
+    {UINT64_C(0xc097ce7bc90715b3),    56}, // 10^36
+    {UINT64_C(0x8f7e32ce7bea5c70),    83}, // 10^44
+    {UINT64_C(0xd5d238a4abe98068),   109}, // 10^52
+    {UINT64_C(0x9f4f2726179a2245),   136}, // 10^60
+    {UINT64_C(0xed63a231d4c4fb27),   162}, // 10^68
+    {UINT64_C(0xb0de65388cc8ada8),   189}, // 10^76
+    {UINT64_C(0x83c7088e1aab65db),   216}, // 10^84
+    {UINT64_C(0xc45d1df942711d9a),   242}, // 10^92
+    {UINT64_C(0x924d692ca61be758),   269}, // 10^100
+    {UINT64_C(0xda01ee641a708dea),   295}, // 10^108
+    {UINT64_C(0xa26da3999aef774a),   322}, // 10^116
+    {UINT64_C(0xf209787bb47d6b85),   348}, // 10^124
+    {UINT64_C(0xb454e4a179dd1877),   375}, // 10^132
+    {UINT64_C(0x865b86925b9bc5c2),   402}, // 10^140
+    {UINT64_C(0xc83553c5c8965d3d),   428}, // 10^148
+    {UINT64_C(0x952ab45cfa97a0b3),   455}, // 10^156
+    {UINT64_C(0xde469fbd99a05fe3),   481}, // 10^164
+    {UINT64_C(0xa59bc234db398c25),   508}, // 10^172
+    {UINT64_C(0xf6c69a72a3989f5c),   534}, // 10^180
+    {UINT64_C(0xb7dcbf5354e9bece),   561}, // 10^188
+    {UINT64_C(0x88fcf317f22241e2),   588}, // 10^196
+    {UINT64_C(0xcc20ce9bd35c78a5),   614}, // 10^204
+    {UINT64_C(0x98165af37b2153df),   641}, // 10^212
+    {UINT64_C(0xe2a0b5dc971f303a),   667}, // 10^220
+    {UINT64_C(0xa8d9d1535ce3b396),   694}, // 10^228
+    {UINT64_C(0xfb9b7cd9a4a7443c),   720}, // 10^236
+    {UINT64_C(0xbb764c4ca7a44410),   747}, // 10^244
+    {UINT64_C(0x8bab8eefb6409c1a),   774}, // 10^252
+    {UINT64_C(0xd01fef10a657842c),   800}, // 10^260
+    {UINT64_C(0x9b10a4e5e9913129),   827}, // 10^268
+    {UINT64_C(0xe7109bfba19c0c9d),   853}, // 10^276
+    {UINT64_C(0xac2820d9623bf429),   880}, // 10^284
+    {UINT64_C(0x80444b5e7aa7cf85),   907}, // 10^292
+    {UINT64_C(0xbf21e44003acdd2d),   933}, // 10^300
+    {UINT64_C(0x8e679c2f5e44ff8f),   960}, // 10^308
+    {UINT64_C(0xd433179d9c8cb841),   986}, // 10^316
+    {UINT64_C(0x9e19db92b4e31ba9),  1013}, // 10^324
+    {UINT64_C(0xeb96bf6ebadf77d9),  1039}, // 10^332
+    {UINT64_C(0xaf87023b9bf0ee6b),  1066}, // 10^340
+};
+
+static const uint64_t _pow10[] = {
+    UINT64_C(1),
+    UINT64_C(10),
+    UINT64_C(100),
+    UINT64_C(1000),
+    UINT64_C(10000),
+    UINT64_C(100000),
+    UINT64_C(1000000),
+    UINT64_C(10000000),
+    UINT64_C(100000000),
+    UINT64_C(1000000000),
+    UINT64_C(10000000000),
+    UINT64_C(100000000000),
+    UINT64_C(1000000000000),
+    UINT64_C(10000000000000),
+    UINT64_C(100000000000000),
+    UINT64_C(1000000000000000),
+    UINT64_C(10000000000000000),
+    UINT64_C(100000000000000000),
+    UINT64_C(1000000000000000000),
+    UINT64_C(10000000000000000000),
+};
+
+static diyfp_t _diyfp_from_bits(uint64_t bits)
+{
+    diyfp_t r;
+    int biased_e = (int)((bits & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+    uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+
+    if (biased_e)
+    {
+        r.f = significand + DP_HIDDEN_BIT;
+        r.e = biased_e - DP_EXPONENT_BIAS;
+    }
+    else
+    {
+        // Subnormal number.
+        r.f = significand;
+        r.e = 1 - DP_EXPONENT_BIAS;
+    }
+
+    return r;
+}
+
+static diyfp_t _diyfp_mul(diyfp_t x, diyfp_t y)
+{
+    const uint64_t m32 = UINT64_C(0xffffffff);
+    uint64_t a = x.f >> 32;
+    uint64_t b = x.f & m32;
+    uint64_t c = y.f >> 32;
+    uint64_t d = y.f & m32;
+    uint64_t ac = a * c;
+    uint64_t bc = b * c;
+    uint64_t ad = a * d;
+    uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+    tmp += UINT64_C(1) << 31; // round half up
+
+    diyfp_t r = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+    return r;
+}
+
+static diyfp_t _diyfp_normalize(diyfp_t x)
+{
+    while (!(x.f & DP_SIGN_MASK))
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+
+    return x;
+}
+
+/*
+ * Calculate boundaries m- and m+ of the rounding interval around v,
+ * both are brought to the same exponent as normalized m+.
+ */
+static void _diyfp_boundaries(diyfp_t v, diyfp_t *mm, diyfp_t *mp)
+{
+    diyfp_t p = {(v.f << 1) + 1, v.e - 1};
+    while (!(p.f & (DP_HIDDEN_BIT << 1)))
+    {
+        p.f <<= 1;
+        p.e--;
+    }
+    p.f <<= 64 - DP_SIGNIFICAND_SIZE - 2;
+    p.e -= 64 - DP_SIGNIFICAND_SIZE - 2;
+
+    // The lower boundary is closer when v is a power of two.
+    diyfp_t m;
+    if (v.f == DP_HIDDEN_BIT)
+    {
+        m.f = (v.f << 2) - 1;
+        m.e = v.e - 2;
+    }
+    else
+    {
+        m.f = (v.f << 1) - 1;
+        m.e = v.e - 1;
+    }
+    m.f <<= m.e - p.e;
+    m.e = p.e;
+
+    *mm = m;
+    *mp = p;
+}
+
+/*
+ * Find cached 10^-k such that binary exponent of the product
+ * with a number of binary exponent e lands in [-60, -32].
+ */
+static diyfp_t _get_cached_power(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (ik != dk)
+    {
+        ik++;
+    }
+
+    size_t index = (size_t)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+
+    return _cached_powers[index];
+}
+
+static void _grisu_round(char *digits, size_t len, uint64_t delta,
+                         uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    // Walk the last digit down while it gets closer to the real value.
+    while ((rest < wp_w) && (delta - rest >= ten_kappa) &&
+           ((rest + ten_kappa < wp_w) ||
+            (wp_w - rest > rest + ten_kappa - wp_w)))
+    {
+        digits[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static size_t _grisu_digit_gen(diyfp_t w, diyfp_t mp, uint64_t delta,
+                               char *digits, int *k)
+{
+    diyfp_t one = {UINT64_C(1) << -mp.e, mp.e};
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = (int)_count_digits(p1);
+    size_t len = 0;
+
+    // Integral part.
+    while (kappa > 0)
+    {
+        uint32_t d = p1 / _pow10[kappa - 1];
+        p1 %= _pow10[kappa - 1];
+        if (d || len)
+        {
+            digits[len++] = '0' + d;
+        }
+        kappa--;
+
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta)
+        {
+            *k += kappa;
+            _grisu_round(digits, len, delta, rest,
+                         _pow10[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+
+    // Fractional part.
+    for (;;)
+    {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || len)
+        {
+            digits[len++] = '0' + d;
+        }
+        p2 &= one.f - 1;
+        kappa--;
+
+        if (p2 < delta)
+        {
+            *k += kappa;
+            size_t index = -kappa;
+            _grisu_round(digits, len, delta, p2, one.f,
+                         wp_w * (index < ARRAY_LEN(_pow10) ? _pow10[index] : 0));
+            return len;
+        }
+    }
+}
+
+/*
+ * Produce decimal digits and exponent k such that v = digits * 10^k,
+ * v is expected to be positive and finite.
+ */
+static size_t _grisu2(uint64_t bits, char *digits, int *k)
+{
+    diyfp_t v = _diyfp_from_bits(bits);
+    diyfp_t mm, mp;
+    _diyfp_boundaries(v, &mm, &mp);
+
+    diyfp_t c_mk = _get_cached_power(mp.e, k);
+    diyfp_t w = _diyfp_mul(_diyfp_normalize(v), c_mk);
+    diyfp_t wp = _diyfp_mul(mp, c_mk);
+    diyfp_t wm = _diyfp_mul(mm, c_mk);
+
+    // Shrink the interval by one ulp on both ends to stay conservative.
+    wm.f++;
+    wp.f--;
+
+    return _grisu_digit_gen(w, wp, wp.f - wm.f, digits, k);
+}
+
+/*
+ * Lay out digits * 10^k similar to Python repr(): fixed notation when
+ * the decimal exponent is in [-4, 16), scientific one otherwise. Always
+ * keep a fractional part in fixed notation, so the value is parsed back
+ * as G_REAL rather than G_INT.
+ */
+static size_t _layout_real(const char *digits, size_t n, int k, char *out)
+{
+    char *p = out;
+    int point = (int)n + k; // position of decimal point in digits
+
+    if ((point > -4) && (point <= 16))
+    {
+        if (point >= (int)n)
+        {
+            memcpy(p, digits, n);
+            p += n;
+            memset(p, '0', point - n);
+            p += point - n;
+            *p++ = '.';
+            *p++ = '0';
+        }
+        else if (point > 0)
+        {
+            memcpy(p, digits, point);
+            p += point;
+            *p++ = '.';
+            memcpy(p, digits + point, n - point);
+            p += n - point;
+        }
+        else
+        {
+            *p++ = '0';
+            *p++ = '.';
+            memset(p, '0', -point);
+            p += -point;
+            memcpy(p, digits, n);
+            p += n;
+        }
+    }
+    else
+    {
+        int exp10 = point - 1;
+        *p++ = digits[0];
+        if (n > 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + 1, n - 1);
+            p += n - 1;
+        }
+        *p++ = 'e';
+        *p++ = (exp10 < 0) ? '-' : '+';
+        if (exp10 < 0)
+        {
+            exp10 = -exp10;
+        }
+        if (exp10 < 10)
+        {
+            *p++ = '0';
+        }
+        p += _format_uint(exp10, p);
+    }
+
+    return p - out;
+}
+
+size_t unum_format_real(double v, char *out)
+{
+    UASSERT_INPUT(out);
+
+    uint64_t bits;
+    char *p = out;
+    memcpy(&bits, &v, sizeof(bits));
+
+    if ((bits & DP_EXPONENT_MASK) == DP_EXPONENT_MASK)
+    {
+        if (bits & DP_SIGNIFICAND_MASK)
+        {
+            memcpy(p, "nan", 3);
+            return 3;
+        }
+        if (bits & DP_SIGN_MASK)
+        {
+            *p++ = '-';
+        }
+        memcpy(p, "inf", 3);
+        return p - out + 3;
+    }
+
+    if (bits & DP_SIGN_MASK)
+    {
+        *p++ = '-';
+        bits &= ~DP_SIGN_MASK;
+    }
+
+    if (bits == 0)
+    {
+        memcpy(p, "0.0", 3);
+        return p - out + 3;
+    }
+
+    char digits[24];
+    int k;
+    size_t n = _grisu2(bits, digits, &k);
+    p += _layout_real(digits, n, k, p);
+
+    return p - out;
+}
+
+/*
+ * String to number conversion. The digits are scanned once, integers
+ * are accumulated directly, reals go through three stages:
+ *  - Clinger's fast path: the significand and the power of ten are both
+ *    exactly representable as doubles, one IEEE operation gives correctly
+ *    rounded result;
+ *  - 64-bit approximation using the cached powers above, good enough
+ *    unless the value is too close to a midpoint between two doubles;
+ *  - exact comparison of the decimal input with the midpoints around
+ *    the approximation using big integers.
+ * Nothing depends on the current locale or errno.
+ */
+
+#define DP_MAX_EXACT_INT (UINT64_C(1) << 53)
+#define MAX_W_DIGITS 19          // decimal digits which always fit uint64_t
+#define MAX_SIG_DIGITS 780       // enough to decide rounding of any double
+#define BIGNUM_WORDS 128         // 4096 bits, see _bignum_cmp_to_midpoint
+#define MAX_EXPONENT 100000      // any larger exponent means inf or 0
+
+static const double _exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+typedef struct {
+    const char *digits;     // the first significant digit
+    const char *end;        // the end of significand
+    size_t nsig;            // number of significant digits
+    int e10;                // value is digits * 10^e10
+} decimal_t;
+
+typedef struct {
+    uint32_t d[BIGNUM_WORDS];
+    size_t n;
+} bignum_t;
+
+static inline bool _is_digit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static void _bignum_mul_small(bignum_t *b, uint32_t m)
+{
+    uint64_t carry = 0;
+    for (size_t i = 0; i < b->n; i++)
+    {
+        carry += (uint64_t)b->d[i] * m;
+        b->d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if (carry)
+    {
+        UASSERT_INTERNAL(b->n < BIGNUM_WORDS);
+        b->d[b->n++] = (uint32_t)carry;
+    }
+}
+
+static void _bignum_add_small(bignum_t *b, uint32_t a)
+{
+    uint64_t carry = a;
+    for (size_t i = 0; carry && (i < b->n); i++)
+    {
+        carry += b->d[i];
+        b->d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if (carry)
+    {
+        UASSERT_INTERNAL(b->n < BIGNUM_WORDS);
+        b->d[b->n++] = (uint32_t)carry;
+    }
+}
+
+static void _bignum_mul_pow10(bignum_t *b, int e)
+{
+    for (; e >= 9; e -= 9)
+    {
+        _bignum_mul_small(b, 1000000000);
+    }
+    if (e)
+    {
+        _bignum_mul_small(b, (uint32_t)_pow10[e]);
+    }
+}
+
+static void _bignum_shl(bignum_t *b, int shift)
+{
+    if (b->n == 0)
+    {
+        return;
+    }
+
+    size_t words = shift / 32;
+    int bits = shift % 32;
+    UASSERT_INTERNAL(b->n + words < BIGNUM_WORDS);
+
+    if (bits)
+    {
+        b->d[b->n] = 0;
+        for (size_t i = b->n; i > 0; i--)
+        {
+            b->d[i] |= b->d[i - 1] >> (32 - bits);
+            b->d[i - 1] <<= bits;
+        }
+        if (b->d[b->n])
+        {
+            b->n++;
+        }
+    }
+    if (words)
+    {
+        memmove(b->d + words, b->d, b->n * sizeof(b->d[0]));
+        memset(b->d, 0, words * sizeof(b->d[0]));
+        b->n += words;
+    }
+}
+
+static int _bignum_cmp(const bignum_t *a, const bignum_t *b)
+{
+    if (a->n != b->n)
+    {
+        return (a->n > b->n) ? 1 : -1;
+    }
+    for (size_t i = a->n; i > 0; i--)
+    {
+        if (a->d[i - 1] != b->d[i - 1])
+        {
+            return (a->d[i - 1] > b->d[i - 1]) ? 1 : -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Load up to MAX_SIG_DIGITS significant digits, return true if some
+ * of non-zero digits didn't fit, i.e. the real value is slightly larger.
+ */
+static bool _bignum_from_decimal(bignum_t *b, const decimal_t *dec, int *e10)
+{
+    const char *p = dec->digits;
+    size_t taken = 0;
+    uint32_t chunk = 0;
+    int chunk_len = 0;
+
+    b->n = 0;
+    for (; (p < dec->end) && (taken < MAX_SIG_DIGITS); p++)
+    {
+        if (_is_digit(*p))
+        {
+            chunk = chunk * 10 + (*p - '0');
+            taken++;
+            if (++chunk_len == 9)
+            {
+                _bignum_mul_small(b, 1000000000);
+                _bignum_add_small(b, chunk);
+                chunk = chunk_len = 0;
+            }
+        }
+    }
+    _bignum_mul_small(b, (uint32_t)_pow10[chunk_len]);
+    _bignum_add_small(b, chunk);
+    *e10 = dec->e10 + (int)(dec->nsig - taken);
+
+    for (; p < dec->end; p++)
+    {
+        if (_is_digit(*p) && (*p != '0'))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Compare big decimal * 10^e10 to m * 2^e2. All the values are brought
+ * to integers: with at most MAX_SIG_DIGITS digits in the decimal and the
+ * value within the double range neither side grows beyond ~3750 bits.
+ */
+static int _bignum_cmp_to_midpoint(const bignum_t *decimal, int e10,
+                                   uint64_t m, int e2)
+{
+    bignum_t l = *decimal;
+    bignum_t r = {{(uint32_t)m, (uint32_t)(m >> 32)}, (m >> 32) ? 2 : 1};
+
+    if (e10 >= 0)
+    {
+        _bignum_mul_pow10(&l, e10);
+    }
+    else
+    {
+        _bignum_mul_pow10(&r, -e10);
+    }
+
+    if (e2 >= 0)
+    {
+        _bignum_shl(&r, e2);
+    }
+    else
+    {
+        _bignum_shl(&l, -e2);
+    }
+
+    return _bignum_cmp(&l, &r);
+}
+
+/*
+ * Starting from the candidate which is at most a few ulps away, move to
+ * the double nearest to the decimal value, ties go to the even one.
+ */
+static uint64_t _correct_rounding(uint64_t bits, const decimal_t *dec)
+{
+    bignum_t decimal;
+    int e10;
+    bool sticky = _bignum_from_decimal(&decimal, dec, &e10);
+
+    // Start from DBL_MAX if the candidate is inf, step up if needed.
+    if (bits >= DP_EXPONENT_MASK)
+    {
+        bits = DP_EXPONENT_MASK - 1;
+    }
+
+    for (;;)
+    {
+        int biased_e = (int)(bits >> DP_SIGNIFICAND_SIZE);
+        uint64_t m = bits & DP_SIGNIFICAND_MASK;
+        int e2 = 1 - DP_EXPONENT_BIAS;
+        if (biased_e)
+        {
+            m |= DP_HIDDEN_BIT;
+            e2 = biased_e - DP_EXPONENT_BIAS;
+        }
+
+        // Upper midpoint is (m + 1/2) * 2^e2.
+        int cmp = _bignum_cmp_to_midpoint(&decimal, e10, 2 * m + 1, e2 - 1);
+        if ((cmp > 0) || ((cmp == 0) && sticky))
+        {
+            bits++;
+            if (bits == DP_EXPONENT_MASK)
+            {
+                return bits; // overflow to inf
+            }
+            continue;
+        }
+        if (cmp == 0)
+        {
+            return bits + (m & 1);
+        }
+
+        if (bits == 0)
+        {
+            return bits;
+        }
+
+        // Lower midpoint, the gap below is halved at powers of two.
+        if ((m == DP_HIDDEN_BIT) && (biased_e > 1))
+        {
+            cmp = _bignum_cmp_to_midpoint(&decimal, e10, 4 * m - 1, e2 - 2);
+        }
+        else
+        {
+            cmp = _bignum_cmp_to_midpoint(&decimal, e10, 2 * m - 1, e2 - 1);
+        }
+        if (cmp < 0)
+        {
+            bits--;
+            continue;
+        }
+        if ((cmp == 0) && !sticky)
+        {
+            return bits - (m & 1);
+        }
+
+        return bits;
+    }
+}
+
+/*
+ * Round w * 10^e10 to a double, if the 64-bit approximation is too close
+ * to a midpoint to decide the rounding return false leaving a candidate
+ * in *bits for the exact comparison.
+ */
+static bool _approximate(uint64_t w, int e10, bool truncated, uint64_t *bits)
+{
+    diyfp_t x = {w, 0};
+    x = _diyfp_normalize(x);
+
+    int index = (e10 + 348) / 8;
+    int r = (e10 + 348) % 8;
+    x = _diyfp_mul(x, _cached_powers[index]);
+    if (r)
+    {
+        diyfp_t p = {_pow10[r], 0};
+        x = _diyfp_mul(x, _diyfp_normalize(p));
+    }
+    x = _diyfp_normalize(x);
+
+    // Error bound of the product in units of the last bit.
+    uint64_t error = truncated ? 32 : 8;
+
+    // Bring the precision down for subnormal numbers.
+    int precision = DP_SIGNIFICAND_SIZE + 1;
+    int e = x.e + 63;
+    if (e < 1 - DP_EXPONENT_BIAS + DP_SIGNIFICAND_SIZE)
+    {
+        precision -= (1 - DP_EXPONENT_BIAS + DP_SIGNIFICAND_SIZE) - e;
+    }
+    if (precision <= 0)
+    {
+        *bits = 0;
+        return false;
+    }
+
+    int shift = 64 - precision;
+    uint64_t half = UINT64_C(1) << (shift - 1);
+    uint64_t rest = x.f & ((half << 1) - 1);
+    uint64_t m = x.f >> shift;
+    bool exact = ((rest > half) ? rest - half : half - rest) > error;
+
+    // Carry out of a subnormal lands into the exponent bits by itself.
+    if (rest > half)
+    {
+        m++;
+        if ((m >> precision) && (precision == DP_SIGNIFICAND_SIZE + 1))
+        {
+            m >>= 1;
+            shift++;
+        }
+    }
+
+    e = x.e + shift + DP_EXPONENT_BIAS;
+    if (m & DP_HIDDEN_BIT)
+    {
+        if (e >= 0x7ff)
+        {
+            *bits = DP_EXPONENT_MASK; // inf
+            return exact;
+        }
+        *bits = ((uint64_t)e << DP_SIGNIFICAND_SIZE) | (m & DP_SIGNIFICAND_MASK);
+    }
+    else
+    {
+        *bits = m; // subnormal
+    }
+
+    return exact;
+}
+
+static ugeneric_t _make_real(bool negative, uint64_t bits)
+{
+    double d;
+    if (negative)
+    {
+        bits |= DP_SIGN_MASK;
+    }
+    memcpy(&d, &bits, sizeof(d));
+
+    return G_REAL(d);
+}
+
+static ugeneric_t _parse_real(bool negative, const decimal_t *dec)
+{
+    uint64_t w = 0;
+    size_t nw = 0;
+    bool truncated = false;
+
+    if (dec->nsig == 0)
+    {
+        return _make_real(negative, 0);
+    }
+
+    // Out of double range: magnitude of the value is 10^(e10 + nsig).
+    if (dec->e10 + (long)dec->nsig > 310)
+    {
+        return G_ERROR(ustring_dup("numerical value is out of range"));
+    }
+    if (dec->e10 + (long)dec->nsig < -324)
+    {
+        return _make_real(negative, 0);
+    }
+
+    for (const char *p = dec->digits; p < dec->end; p++)
+    {
+        if (!_is_digit(*p))
+        {
+            continue;
+        }
+        if (nw < MAX_W_DIGITS)
+        {
+            w = w * 10 + (*p - '0');
+            nw++;
+        }
+        else if (*p != '0')
+        {
+            truncated = true;
+            break;
+        }
+    }
+    int e10 = dec->e10 + (int)(dec->nsig - nw);
+
+    // Trailing zeros only make the numbers bigger.
+    while (!truncated && (w % 10 == 0))
+    {
+        w /= 10;
+        e10++;
+    }
+
+    uint64_t bits;
+#if FLT_EVAL_METHOD == 0
+    if (!truncated && (w <= DP_MAX_EXACT_INT) &&
+        (e10 >= -22) && (e10 <= 22))
+    {
+        double d = (double)w;
+        d = (e10 < 0) ? d / _exact_pow10[-e10] : d * _exact_pow10[e10];
+        return G_REAL(negative ? -d : d);
+    }
+#endif
+
+    if (!_approximate(w, e10, truncated, &bits))
+    {
+        bits = _correct_rounding(bits, dec);
+    }
+    if (bits == DP_EXPONENT_MASK)
+    {
+        return G_ERROR(ustring_dup("numerical value is out of range"));
+    }
+
+    return _make_real(negative, bits);
+}
+
+static ugeneric_t _parse_integer(bool negative, const char *digits,
+                                 const char *end)
+{
+    uintmax_t v = 0;
+
+    for (const char *p = digits; p < end; p++)
+    {
+        unsigned int d = *p - '0';
+        if (v > (UINTMAX_MAX - d) / 10)
+        {
+            return G_ERROR(ustring_dup("numerical value is out of range"));
+        }
+        v = v * 10 + d;
+    }
+
+    if (negative)
+    {
+        if (v > (uintmax_t)LONG_MAX + 1)
+        {
+            return G_ERROR(ustring_dup("numerical value is out of range"));
+        }
+        return G_INT((long)(0 - v));
+    }
+
+    // A huge positive integer which doesn't fit to long is G_SIZE.
+    if (v <= LONG_MAX)
+    {
+        return G_INT((long)v);
+    }
+    if (v <= SIZE_MAX)
+    {
+        return G_SIZE((size_t)v);
+    }
+
+    return G_ERROR(ustring_dup("numerical value is out of range"));
+}
+
+/*
+ * Parse a number at *str in JSON-like notation, a number with fractional
+ * part or exponent is G_REAL, otherwise G_INT or G_SIZE when the value
+ * is too big for long. On success *str is moved past the number.
+ */
+ugeneric_t unum_parse(const char **str)
+{
+    UASSERT_INPUT(str);
+    UASSERT_INPUT(*str);
+
+    const char *p = *str;
+    bool negative = false;
+    bool is_real = false;
+    decimal_t dec = {NULL, NULL, 0, 0};
+    ugeneric_t g;
+
+    if (*p == '-')
+    {
+        negative = true;
+        p++;
+    }
+
+    const char *int_digits = p;
+    while (*p == '0')
+    {
+        p++;
+    }
+    dec.digits = p;
+    while (_is_digit(*p))
+    {
+        p++;
+    }
+    const char *int_end = p;
+    size_t ndigits = int_end - int_digits;
+    dec.nsig = int_end - dec.digits;
+
+    if (*p == '.')
+    {
+        const char *frac = ++p;
+        is_real = true;
+        if (dec.nsig == 0)
+        {
+            // Leading zeros of the fractional part are not significant.
+            while (*p == '0')
+            {
+                p++;
+            }
+            dec.digits = p;
+        }
+        while (_is_digit(*p))
+        {
+            p++;
+        }
+        dec.nsig = (dec.digits < frac) ? dec.nsig + (p - frac)
+                                       : (size_t)(p - dec.digits);
+        dec.e10 = -(int)(p - frac);
+        ndigits += p - frac;
+    }
+    dec.end = p;
+
+    if (ndigits == 0)
+    {
+        return G_ERROR(ustring_dup("cannot parse the numerical value"));
+    }
+
+    if ((*p == 'e') || (*p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negative_exp = false;
+        long exp = 0;
+
+        if ((*q == '-') || (*q == '+'))
+        {
+            negative_exp = (*q++ == '-');
+        }
+        if (_is_digit(*q))
+        {
+            while (_is_digit(*q))
+            {
+                if (exp < MAX_EXPONENT)
+                {
+                    exp = exp * 10 + (*q - '0');
+                }
+                q++;
+            }
+            dec.e10 += (int)(negative_exp ? -exp : exp);
+            is_real = true;
+            p = q;
+        }
+    }
+
+    if (is_real)
+    {
+        if (dec.nsig == 0)
+        {
+            g = _make_real(negative, 0);
+        }
+        else
+        {
+            g = _parse_real(negative, &dec);
+        }
+    }
+    else
+    {
+        g = _parse_integer(negative, int_digits, int_end);
+    }
+
+    if (!G_IS_ERROR(g))
+    {
+        *str = p;
+    }
+
+    return g;
+}
@@ -8,6 +8,7 @@
 struct uqueue_opaq {
     uvoid_handlers_t void_handlers;
     bool is_data_owner;
+    const uallocator_t *allocator;
     ugeneric_t *data;
     size_t h; // head
     size_t t; // tail
@@ -17,7 +18,15 @@ struct uqueue_opaq {
 
 uqueue_t *uqueue_create(void)
 {
-    uqueue_t *q = umalloc(sizeof(*q));
+    return uqueue_create_ext(NULL);
+}
+
+uqueue_t *uqueue_create_ext(const uallocator_t *allocator)
+{
+    allocator = allocator ? allocator : uallocator_get_default();
+    uqueue_t *q = uallocator_alloc(allocator, sizeof(*q));
+    q->allocator = allocator;
+    q->is_data_owner = true;
     q->data = NULL;
     q->h = 0;
     q->t = 0;
@@ -32,8 +41,9 @@ void uqueue_destroy(uqueue_t *q)
 {
     if (q)
     {
-        ufree(q->data);
-        ufree(q);
+        uallocator_free(q->allocator, q->data,
+                        q->capacity * sizeof(q->data[0]));
+        uallocator_free(q->allocator, q, sizeof(*q));
     }
 }
 
@@ -116,12 +126,14 @@ void uqueue_reserve_capacity(uqueue_t *q, size_t new_capacity)
          */
         if (q->size)
         {
-            ugeneric_t *p = umalloc(new_capacity * sizeof(*p));
+            ugeneric_t *p = uallocator_alloc(q->allocator,
+                                             new_capacity * sizeof(*p));
             for (size_t i = 0; i < q->size; i++)
             {
                 p[i] = q->data[(q->h + i) % q->capacity];
             }
-            ufree(q->data);
+            uallocator_free(q->allocator, q->data,
+                            q->capacity * sizeof(q->data[0]));
             q->data = p;
             q->h = 0;
             q->t = q->size - 1;
@@ -129,7 +141,12 @@ void uqueue_reserve_capacity(uqueue_t *q, size_t new_capacity)
         }
         else
         {
-            q->data = umalloc(new_capacity * sizeof(q->data[0]));
+            // Nothing to move, the old room is just replaced.
+            q->data = uallocator_realloc(q->allocator, q->data,
+                                         q->capacity * sizeof(q->data[0]),
+                                         new_capacity * sizeof(q->data[0]));
+            q->h = 0;
+            q->t = 0;
             q->capacity = new_capacity;
         }
     }
@@ -168,11 +185,7 @@ int uqueue_fprint(const uqueue_t *q, FILE *out)
     UASSERT_INPUT(q);
     UASSERT_INPUT(out);
 
-    char *str = uqueue_as_str(q);
-    int ret = fprintf(out, "%s\n", str);
-    ufree(str);
-
-    return ret;
+    return ubuffer_fprint_serialized((ubuffer_s8r_t)uqueue_serialize, q, out);
 }
 
 ugeneric_base_t *uqueue_get_base(uqueue_t *q)
@@ -180,3 +193,21 @@ ugeneric_base_t *uqueue_get_base(uqueue_t *q)
     UASSERT_INPUT(q);
     return (ugeneric_base_t *)q;
 }
+
+umem_usage_t uqueue_get_memory_usage(const uqueue_t *q)
+{
+    UASSERT_INPUT(q);
+
+    umem_usage_t u = {0};
+    u.header = sizeof(*q);
+    u.buckets = q->capacity * sizeof(q->data[0]);
+    if (q->is_data_owner)
+    {
+        for (size_t i = 0; i < q->size; i++)
+        {
+            u.payload += ugeneric_get_memory_usage(q->data[(q->h + i) % q->capacity]);
+        }
+    }
+
+    return u;
+}
@@ -0,0 +1,202 @@
+#include "rope.h"
+
+#include "asserts.h"
+#include "mem.h"
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} _segment_t;
+
+struct urope_opaq {
+    _segment_t *segments;
+    size_t count;
+    size_t capacity;
+    size_t segment_size;
+    size_t size;
+    ubuffer_t *buf; // attached buffer if any
+};
+
+urope_t *urope_create(void)
+{
+    return urope_create_with_segment_size(ROPE_DEFAULT_SEGMENT_SIZE);
+}
+
+urope_t *urope_create_with_segment_size(size_t segment_size)
+{
+    UASSERT_INPUT(segment_size);
+
+    urope_t *r = umalloc(sizeof(*r));
+    r->segments = NULL;
+    r->count = 0;
+    r->capacity = 0;
+    r->segment_size = segment_size;
+    r->size = 0;
+    r->buf = NULL;
+
+    return r;
+}
+
+void urope_clear(urope_t *r)
+{
+    UASSERT_INPUT(r);
+    UASSERT_INPUT(!r->buf);
+
+    for (size_t i = 0; i < r->count; i++)
+    {
+        ufree(r->segments[i].data);
+    }
+    r->count = 0;
+    r->size = 0;
+}
+
+void urope_destroy(urope_t *r)
+{
+    if (r)
+    {
+        urope_clear(r);
+        ufree(r->segments);
+        ufree(r);
+    }
+}
+
+// Takes over a block of memory as the new last segment.
+static void _push_segment(urope_t *r, char *data, size_t size, size_t capacity)
+{
+    if (r->count == r->capacity)
+    {
+        r->capacity = MAX(r->capacity * SCALE_FACTOR, 16);
+        r->segments = urealloc(r->segments, r->capacity * sizeof(r->segments[0]));
+    }
+
+    r->segments[r->count].data = data;
+    r->segments[r->count].size = size;
+    r->segments[r->count].capacity = capacity;
+    r->count++;
+    r->size += size;
+}
+
+void urope_append_data(urope_t *r, const void *data, size_t size)
+{
+    UASSERT_INPUT(r);
+    UASSERT_INPUT(data || !size);
+    UASSERT_INPUT(!r->buf);
+
+    const char *p = data;
+    while (size)
+    {
+        _segment_t *s = r->count ? &r->segments[r->count - 1] : NULL;
+        if (!s || (s->size == s->capacity))
+        {
+            _push_segment(r, umalloc(r->segment_size), 0, r->segment_size);
+            s = &r->segments[r->count - 1];
+        }
+
+        size_t n = MIN(size, s->capacity - s->size);
+        memcpy(s->data + s->size, p, n);
+        s->size += n;
+        r->size += n;
+        p += n;
+        size -= n;
+    }
+}
+
+void urope_append_string(urope_t *r, const char *str)
+{
+    UASSERT_INPUT(str);
+    urope_append_data(r, str, strlen(str));
+}
+
+size_t urope_get_size(const urope_t *r)
+{
+    UASSERT_INPUT(r);
+    return r->size;
+}
+
+size_t urope_get_segment_count(const urope_t *r)
+{
+    UASSERT_INPUT(r);
+    return r->count;
+}
+
+umemchunk_t urope_get_segment(const urope_t *r, size_t i)
+{
+    UASSERT_INPUT(r);
+    UASSERT_INPUT(i < r->count);
+
+    umemchunk_t m = {.data = r->segments[i].data, .size = r->segments[i].size};
+    return m;
+}
+
+char *urope_as_str(const urope_t *r)
+{
+    UASSERT_INPUT(r);
+
+    char *str = umalloc(r->size + 1);
+    char *p = str;
+    for (size_t i = 0; i < r->count; i++)
+    {
+        memcpy(p, r->segments[i].data, r->segments[i].size);
+        p += r->segments[i].size;
+    }
+    *p = 0;
+
+    return str;
+}
+
+// The buffer is full: its block becomes a segment as is, no copying.
+static bool _rope_sink(const void *data, size_t size, void *ctx)
+{
+    urope_t *r = ctx;
+    UASSERT_INTERNAL(data == r->buf->data);
+
+    _push_segment(r, r->buf->data, size, r->buf->capacity);
+    r->buf->data = umalloc(r->segment_size);
+    r->buf->capacity = r->segment_size;
+
+    return true;
+}
+
+void urope_attach_buffer(urope_t *r, ubuffer_t *buf)
+{
+    UASSERT_INPUT(r);
+    UASSERT_INPUT(buf);
+    UASSERT_INPUT(!r->buf);
+    UASSERT_INPUT(!buf->sink);
+    UASSERT_INPUT(!buf->data_size);
+
+    ufree(buf->data);
+    buf->data = umalloc(r->segment_size);
+    buf->capacity = r->segment_size;
+    buf->sink = _rope_sink;
+    buf->sink_ctx = r;
+    r->buf = buf;
+}
+
+void urope_detach_buffer(urope_t *r, ubuffer_t *buf)
+{
+    UASSERT_INPUT(r);
+    UASSERT_INPUT(buf);
+    UASSERT_INPUT(r->buf == buf);
+
+    if (buf->data_size)
+    {
+        _push_segment(r, buf->data, buf->data_size, buf->capacity);
+    }
+    else
+    {
+        ufree(buf->data);
+    }
+    memset(buf, 0, sizeof(*buf));
+    r->buf = NULL;
+}
+
+void urope_serialize_v(urope_t *r, ugeneric_t g, void_s8r_t void_serializer)
+{
+    ubuffer_t buf = {0};
+
+    urope_attach_buffer(r, &buf);
+    ugeneric_serialize_v(g, &buf, void_serializer);
+    urope_detach_buffer(r, &buf);
+}
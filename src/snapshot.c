@@ -0,0 +1,505 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "snapshot.h"
+
+#include "asserts.h"
+#include "dict.h"
+#include "file_utils.h"
+#include "mem.h"
+#include "string_utils.h"
+#include "vector.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "USNAPv01"
+#define SNAPSHOT_BYTE_ORDER 0x0102030405060708ULL
+#define SNAPSHOT_ALIGNMENT 8
+#define SNAPSHOT_FLUSH_THRESHOLD (1 << 20)
+
+#define IO_ERROR_MSG "I/O error at %s:%u:%s(): %s"
+#define G_ERROR_IO G_ERROR(ustring_fmt(IO_ERROR_MSG, __FILE__, __LINE__, __func__, strerror(errno)))
+
+_Static_assert(sizeof(size_t) <= sizeof(uint64_t), "size_t doesn't fit a snapshot cell");
+_Static_assert(sizeof(long) <= sizeof(uint64_t), "long doesn't fit a snapshot cell");
+_Static_assert(sizeof(double) == sizeof(uint64_t), "double doesn't fit a snapshot cell");
+
+/*
+ * Layout of the image:
+ *
+ *   [header][string, memchunk, vector and dict sections ...]
+ *
+ * A node is a ugeneric_t where pointers are replaced by offsets, its t field
+ * keeps the type (or size of the memchunk) exactly as ugeneric_t does.
+ * Vector section is a section header followed by the nodes of its cells.
+ * Dict section is a section header, number of buckets (power of 2), buckets
+ * holding 1-based pair indices (0 marks empty bucket) and then key and value
+ * nodes of every pair. Children are always written before their parents.
+ */
+typedef struct {
+    uint64_t t;
+    uint64_t v;
+} _node_t;
+
+typedef struct {
+    uint64_t type;
+    uint64_t size;
+} _section_t;
+
+typedef struct {
+    char magic[8];
+    uint64_t byte_order;
+    uint64_t size;
+    _node_t root;
+} _header_t;
+
+struct usnapshot_opaq {
+    const char *base;
+    size_t size;
+};
+
+typedef struct {
+    ufile_writer_t *fw;
+    ubuffer_t buf;
+    uint64_t offset;
+    ugeneric_t error;
+} _writer_t;
+
+static void _flush(_writer_t *w)
+{
+    if (!G_IS_ERROR(w->error) && w->buf.data_size)
+    {
+        umemchunk_t m = {w->buf.data, w->buf.data_size};
+        w->error = ufile_writer_write(w->fw, m);
+    }
+    w->offset += w->buf.data_size;
+    ubuffer_reset(&w->buf);
+}
+
+// Append data padded up to the alignment and return its offset in the file.
+static uint64_t _emit(_writer_t *w, const void *data, size_t size)
+{
+    static const char zeroes[SNAPSHOT_ALIGNMENT] = {0};
+    uint64_t offset = w->offset + w->buf.data_size;
+
+    if (size)
+    {
+        ubuffer_append_data(&w->buf, data, size);
+    }
+    if (size % SNAPSHOT_ALIGNMENT)
+    {
+        ubuffer_append_data(&w->buf, zeroes,
+                            SNAPSHOT_ALIGNMENT - size % SNAPSHOT_ALIGNMENT);
+    }
+    if (w->buf.data_size >= SNAPSHOT_FLUSH_THRESHOLD)
+    {
+        _flush(w);
+    }
+
+    return offset;
+}
+
+static _node_t _write_item(_writer_t *w, ugeneric_t g);
+
+static uint64_t _write_vector(_writer_t *w, const uvector_t *v)
+{
+    _section_t sec = {G_VECTOR_T, uvector_get_size(v)};
+    _node_t *nodes = sec.size ? umalloc(sec.size * sizeof(nodes[0])) : NULL;
+    ugeneric_t *cells = uvector_get_cells(v);
+
+    for (size_t i = 0; i < sec.size; i++)
+    {
+        nodes[i] = _write_item(w, cells[i]);
+    }
+
+    uint64_t offset = _emit(w, &sec, sizeof(sec));
+    _emit(w, nodes, sec.size * sizeof(nodes[0]));
+    ufree(nodes);
+
+    return offset;
+}
+
+static uint64_t _write_dict(_writer_t *w, const udict_t *d)
+{
+    _section_t sec = {G_DICT_T, udict_get_size(d)};
+    uint64_t nbuckets = SNAPSHOT_ALIGNMENT;
+    while (nbuckets < 2 * sec.size)
+    {
+        nbuckets *= 2;
+    }
+
+    _node_t *nodes = sec.size ? umalloc(2 * sec.size * sizeof(nodes[0])) : NULL;
+    uint64_t *buckets = ucalloc(nbuckets, sizeof(buckets[0]));
+    udict_iterator_t *di = udict_iterator_create(d);
+
+    for (size_t i = 0; udict_iterator_has_next(di); i++)
+    {
+        ugeneric_kv_t kv = udict_iterator_get_next(di);
+        size_t b = ugeneric_hash(kv.k, NULL) & (nbuckets - 1);
+        while (buckets[b])
+        {
+            b = (b + 1) & (nbuckets - 1);
+        }
+        buckets[b] = i + 1;
+        nodes[2 * i] = _write_item(w, kv.k);
+        nodes[2 * i + 1] = _write_item(w, kv.v);
+    }
+    udict_iterator_destroy(di);
+
+    uint64_t offset = _emit(w, &sec, sizeof(sec));
+    _emit(w, &nbuckets, sizeof(nbuckets));
+    _emit(w, buckets, nbuckets * sizeof(buckets[0]));
+    _emit(w, nodes, 2 * sec.size * sizeof(nodes[0]));
+    ufree(buckets);
+    ufree(nodes);
+
+    return offset;
+}
+
+static _node_t _write_item(_writer_t *w, ugeneric_t g)
+{
+    // Scalar constructors set the type only, not the whole word.
+    _node_t n = {G_IS_MEMCHUNK(g) ? g.t.memchunk_size : ugeneric_get_type(g), 0};
+
+    switch (ugeneric_get_type(g))
+    {
+        case G_NULL_T:
+            break;
+
+        case G_BOOL_T:
+            n.v = G_AS_BOOL(g);
+            break;
+
+        case G_INT_T:
+            n.v = G_AS_INT(g);
+            break;
+
+        case G_SIZE_T:
+            n.v = G_AS_SIZE(g);
+            break;
+
+        case G_REAL_T:
+            memcpy(&n.v, &G_AS_REAL(g), sizeof(n.v));
+            break;
+
+        case G_STR_T:
+        case G_CSTR_T:
+            n.t = G_CSTR_T;
+            n.v = _emit(w, G_AS_STR(g), strlen(G_AS_STR(g)) + 1);
+            break;
+
+        case G_MEMCHUNK_T:
+            n.v = _emit(w, G_AS_MEMCHUNK_DATA(g), G_AS_MEMCHUNK_SIZE(g));
+            break;
+
+        case G_VECTOR_T:
+            n.v = _write_vector(w, G_AS_PTR(g));
+            break;
+
+        case G_DICT_T:
+            n.v = _write_dict(w, G_AS_PTR(g));
+            break;
+
+        case G_PTR_T:
+        case G_CPTR_T:
+            UABORT("attempt to write void data to snapshot");
+            break;
+
+        case G_ERROR_T:
+            UABORT("attempt to write G_ERROR object to snapshot");
+            break;
+
+        default:
+            UASSERT_INTERNAL("unknown type");
+    }
+
+    return n;
+}
+
+ugeneric_t usnapshot_write(const char *path, ugeneric_t g)
+{
+    UASSERT_INPUT(path);
+
+    _writer_t w = {0};
+    _header_t h = {SNAPSHOT_MAGIC, SNAPSHOT_BYTE_ORDER, 0, {0}};
+
+    ugeneric_t r = ufile_writer_create(path);
+    if (G_IS_ERROR(r))
+    {
+        return r;
+    }
+    w.fw = G_AS_PTR(r);
+    w.error = G_NULL();
+
+    // Header goes first as a placeholder and gets rewritten at the end.
+    _emit(&w, &h, sizeof(h));
+    h.root = _write_item(&w, g);
+    _flush(&w);
+    ubuffer_destroy(&w.buf);
+    h.size = w.offset;
+
+    if (!G_IS_ERROR(w.error))
+    {
+        umemchunk_t m = {&h, sizeof(h)};
+        w.error = ufile_writer_set_position(w.fw, 0);
+        if (!G_IS_ERROR(w.error))
+        {
+            w.error = ufile_writer_write(w.fw, m);
+        }
+    }
+
+    r = ufile_writer_destroy(w.fw);
+    if (G_IS_ERROR(w.error))
+    {
+        if (G_IS_ERROR(r))
+        {
+            ugeneric_error_destroy(r);
+        }
+        return w.error;
+    }
+
+    return r;
+}
+
+ugeneric_t usnapshot_open(const char *path)
+{
+    UASSERT_INPUT(path);
+
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return G_ERROR_IO;
+    }
+
+    if (fstat(fd, &st) == -1)
+    {
+        ugeneric_t e = G_ERROR_IO;
+        close(fd);
+        return e;
+    }
+
+    if ((size_t)st.st_size < sizeof(_header_t))
+    {
+        close(fd);
+        return G_ERROR(ustring_fmt("%s is not a snapshot", path));
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        ugeneric_t e = G_ERROR_IO;
+        close(fd);
+        return e;
+    }
+    close(fd);
+
+    const _header_t *h = base;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) ||
+        (h->byte_order != SNAPSHOT_BYTE_ORDER) ||
+        (h->size != (uint64_t)st.st_size))
+    {
+        munmap(base, st.st_size);
+        return G_ERROR(ustring_fmt("%s is not a snapshot or is corrupted", path));
+    }
+
+    usnapshot_t *s = umalloc(sizeof(*s));
+    s->base = base;
+    s->size = st.st_size;
+
+    return G_PTR(s);
+}
+
+ugeneric_t usnapshot_close(usnapshot_t *s)
+{
+    ugeneric_t g = G_NULL();
+    if (s)
+    {
+        if (munmap((void *)s->base, s->size) == -1)
+        {
+            g = G_ERROR_IO;
+        }
+        ufree(s);
+    }
+
+    return g;
+}
+
+static const void *_at(const usnapshot_t *s, uint64_t offset, uint64_t size)
+{
+    UASSERT_MSG((offset <= s->size) && (size <= s->size - offset),
+                "corrupted snapshot");
+    return s->base + offset;
+}
+
+// String has to end before the end of the mapping.
+static const char *_str_at(const usnapshot_t *s, uint64_t offset)
+{
+    const char *str = _at(s, offset, 1);
+    UASSERT_MSG(memchr(str, '\0', s->size - offset), "corrupted snapshot");
+    return str;
+}
+
+static ugeneric_t _to_generic(const usnapshot_t *s, _node_t n)
+{
+    ugeneric_t g;
+    g.t.memchunk_size = n.t;
+
+    switch (ugeneric_get_type(g))
+    {
+        case G_NULL_T:
+            return G_NULL();
+
+        case G_BOOL_T:
+            return G_BOOL(n.v);
+
+        case G_INT_T:
+            return G_INT((long)n.v);
+
+        case G_SIZE_T:
+            return G_SIZE(n.v);
+
+        case G_REAL_T:
+            memcpy(&G_AS_REAL(g), &n.v, sizeof(n.v));
+            return g;
+
+        case G_CSTR_T:
+            return G_CSTR(_str_at(s, n.v));
+
+        case G_MEMCHUNK_T:
+            return G_MEMCHUNK((void *)_at(s, n.v, G_AS_MEMCHUNK_SIZE(g)),
+                              G_AS_MEMCHUNK_SIZE(g));
+
+        case G_VECTOR_T:
+        case G_DICT_T:
+            return G_CPTR(_at(s, n.v, sizeof(_section_t)));
+
+        default:
+            UABORT("corrupted snapshot");
+    }
+
+    return G_NULL();
+}
+
+static const _section_t *_get_section(const usnapshot_t *s, ugeneric_t c,
+                                      ugeneric_type_e type)
+{
+    UASSERT_INPUT(s);
+    UASSERT_INPUT(usnapshot_get_type(s, c) == type);
+    return G_AS_CPTR(c);
+}
+
+ugeneric_t usnapshot_get_root(const usnapshot_t *s)
+{
+    UASSERT_INPUT(s);
+    return _to_generic(s, ((const _header_t *)s->base)->root);
+}
+
+ugeneric_type_e usnapshot_get_type(const usnapshot_t *s, ugeneric_t item)
+{
+    UASSERT_INPUT(s);
+
+    const char *p = G_AS_CPTR(item);
+    if (G_IS_CPTR(item) && (p >= s->base) && (p < s->base + s->size))
+    {
+        return ((const _section_t *)p)->type;
+    }
+
+    return ugeneric_get_type(item);
+}
+
+size_t usnapshot_get_size(const usnapshot_t *s, ugeneric_t container)
+{
+    UASSERT_INPUT(s);
+
+    ugeneric_type_e type = usnapshot_get_type(s, container);
+    UASSERT_INPUT(type == G_VECTOR_T || type == G_DICT_T);
+
+    return ((const _section_t *)G_AS_CPTR(container))->size;
+}
+
+ugeneric_t usnapshot_vector_get_at(const usnapshot_t *s, ugeneric_t v, size_t i)
+{
+    const _section_t *sec = _get_section(s, v, G_VECTOR_T);
+    UASSERT_INPUT(i < sec->size);
+
+    const _node_t *nodes = (const _node_t *)(sec + 1);
+    return _to_generic(s, nodes[i]);
+}
+
+static const _node_t *_get_dict_nodes(const _section_t *sec)
+{
+    const uint64_t *nbuckets = (const uint64_t *)(sec + 1);
+    return (const _node_t *)(nbuckets + 1 + *nbuckets);
+}
+
+ugeneric_kv_t usnapshot_dict_get_at(const usnapshot_t *s, ugeneric_t d, size_t i)
+{
+    const _section_t *sec = _get_section(s, d, G_DICT_T);
+    UASSERT_INPUT(i < sec->size);
+
+    const _node_t *nodes = _get_dict_nodes(sec);
+    ugeneric_kv_t kv = {
+        .k = _to_generic(s, nodes[2 * i]),
+        .v = _to_generic(s, nodes[2 * i + 1]),
+    };
+
+    return kv;
+}
+
+ugeneric_t usnapshot_dict_get(const usnapshot_t *s, ugeneric_t d, ugeneric_t k,
+                              ugeneric_t vdef)
+{
+    const _section_t *sec = _get_section(s, d, G_DICT_T);
+    const uint64_t *nbuckets = (const uint64_t *)(sec + 1);
+    const uint64_t *buckets = nbuckets + 1;
+    const _node_t *nodes = _get_dict_nodes(sec);
+
+    uint64_t mask = *nbuckets - 1;
+    for (uint64_t b = ugeneric_hash(k, NULL) & mask; buckets[b];
+         b = (b + 1) & mask)
+    {
+        size_t i = buckets[b] - 1;
+        if (ugeneric_compare(_to_generic(s, nodes[2 * i]), k) == 0)
+        {
+            return _to_generic(s, nodes[2 * i + 1]);
+        }
+    }
+
+    return vdef;
+}
+
+ugeneric_t usnapshot_load(const usnapshot_t *s, ugeneric_t item)
+{
+    size_t size;
+    uvector_t *v;
+    udict_t *d;
+
+    switch (usnapshot_get_type(s, item))
+    {
+        case G_VECTOR_T:
+            size = usnapshot_get_size(s, item);
+            v = uvector_create();
+            uvector_reserve_capacity(v, size);
+            for (size_t i = 0; i < size; i++)
+            {
+                uvector_append(v, usnapshot_load(s, usnapshot_vector_get_at(s, item, i)));
+            }
+            return G_VECTOR(v);
+
+        case G_DICT_T:
+            size = usnapshot_get_size(s, item);
+            d = udict_create();
+            for (size_t i = 0; i < size; i++)
+            {
+                ugeneric_kv_t kv = usnapshot_dict_get_at(s, item, i);
+                udict_put(d, usnapshot_load(s, kv.k), usnapshot_load(s, kv.v));
+            }
+            return G_DICT(d);
+
+        default:
+            return ugeneric_copy(item);
+    }
+}
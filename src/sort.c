@@ -1,7 +1,13 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "sort.h"
 
 #include "asserts.h"
 #include "mem.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
 
 static size_t _insertion_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
 static size_t _merge(ugeneric_t *lbase, size_t lsize, ugeneric_t *rbase,
@@ -224,3 +230,1828 @@ void hybrid_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp)
         _hsort(base, 0, nmemb, cmp);
     }
 }
+
+typedef struct {
+    ugeneric_t *src;
+    ugeneric_t *right;
+    ugeneric_t *dst;
+    size_t lsize;
+    size_t rsize;
+    size_t k;
+    void_cmp_t cmp;
+} _psort_task_t;
+
+static void *_psort_sort_worker(void *arg)
+{
+    _psort_task_t *t = arg;
+    pdq_sort(t->src, t->lsize, t->cmp);
+    return NULL;
+}
+
+static void *_psort_merge_worker(void *arg)
+{
+    _psort_task_t *t = arg;
+    _merge(t->src, t->lsize, t->right, t->rsize, t->dst, t->cmp);
+    return NULL;
+}
+
+// Number of items of the left run among the first i ones of their merge. Ties
+// go to the left run like in _merge(), so merging the parts on both sides of
+// the split gives the same result as merging the whole runs.
+static size_t _psort_corank(const ugeneric_t *lbase, size_t lsize,
+                            const ugeneric_t *rbase, size_t rsize, size_t i,
+                            void_cmp_t cmp)
+{
+    size_t lo = (i > rsize) ? i - rsize : 0;
+    size_t hi = MIN(i, lsize);
+    while (lo < hi)
+    {
+        size_t j = lo + (hi - lo) / 2;
+        if (ugeneric_compare_v(lbase[j], rbase[i - j - 1], cmp) <= 0)
+        {
+            lo = j + 1;
+        }
+        else
+        {
+            hi = j;
+        }
+    }
+
+    return lo;
+}
+
+// Runs every task on its own thread, the first one on the calling thread. If
+// a thread can't be started its task is run inline, so this never fails.
+static void _psort_run(void *(*worker)(void *), _psort_task_t *tasks,
+                       size_t count)
+{
+    pthread_t *threads = umalloc(count * sizeof(threads[0]));
+    bool *started = umalloc(count * sizeof(started[0]));
+
+    for (size_t i = 1; i < count; i++)
+    {
+        started[i] = (pthread_create(&threads[i], NULL, worker, &tasks[i]) == 0);
+        if (!started[i])
+        {
+            worker(&tasks[i]);
+        }
+    }
+    worker(&tasks[0]);
+    for (size_t i = 1; i < count; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    ufree(started);
+    ufree(threads);
+}
+
+void parallel_sort_ext(ugeneric_t *base, size_t nmemb, void_cmp_t cmp,
+                       size_t nthreads)
+{
+    if (nthreads == 0)
+    {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (ncpu > 0) ? (size_t)ncpu : 1;
+    }
+    nthreads = MIN(nthreads, nmemb / USORT_PARALLEL_CUTOFF);
+
+    if (nthreads < 2)
+    {
+        pdq_sort(base, nmemb, cmp);
+        return;
+    }
+
+    /* Every thread sorts its own run, then runs are merged pairwise,
+     * bouncing between the array and a scratch one until a single run is
+     * left. Threads are shared out among the pairs of a round and every
+     * merge is cut into equal parts at co-ranks (split points found by a
+     * binary search over both runs), so every round keeps all threads busy.
+     */
+    UASSERT_INPUT(base);
+    ugeneric_t *aux = umalloc(nmemb * sizeof(*aux));
+    size_t *bounds = umalloc((nthreads + 1) * sizeof(bounds[0]));
+    _psort_task_t *tasks = umalloc(nthreads * sizeof(tasks[0]));
+
+    size_t runs = nthreads;
+    for (size_t i = 0; i <= runs; i++)
+    {
+        bounds[i] = nmemb / runs * i + MIN(i, nmemb % runs);
+    }
+    for (size_t i = 0; i < runs; i++)
+    {
+        tasks[i].src = base + bounds[i];
+        tasks[i].lsize = bounds[i + 1] - bounds[i];
+        tasks[i].cmp = cmp;
+    }
+    _psort_run(_psort_sort_worker, tasks, runs);
+
+    ugeneric_t *src = base;
+    ugeneric_t *dst = aux;
+    while (runs > 1)
+    {
+        size_t pairs = (runs + 1) / 2;
+        size_t count = 0;
+        for (size_t p = 0; p < pairs; p++)
+        {
+            size_t l = bounds[2 * p];
+            size_t m = bounds[2 * p + 1];
+            size_t r = (2 * p + 1 < runs) ? bounds[2 * p + 2] : m;
+            size_t size = r - l;
+            size_t parts = nthreads / pairs + (p < nthreads % pairs);
+            size_t prev_i = 0;
+            size_t prev_j = 0;
+            for (size_t q = 1; q <= parts; q++)
+            {
+                size_t i = size / parts * q + MIN(q, size % parts);
+                size_t j = _psort_corank(src + l, m - l, src + m, r - m, i,
+                                         cmp);
+                tasks[count].src = src + l + prev_j;
+                tasks[count].right = src + m + (prev_i - prev_j);
+                tasks[count].dst = dst + l + prev_i;
+                tasks[count].lsize = j - prev_j;
+                tasks[count].rsize = (i - j) - (prev_i - prev_j);
+                tasks[count].cmp = cmp;
+                count++;
+                prev_i = i;
+                prev_j = j;
+            }
+            bounds[p] = l;
+        }
+        bounds[pairs] = nmemb;
+        _psort_run(_psort_merge_worker, tasks, count);
+
+        runs = pairs;
+        ugeneric_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != base)
+    {
+        memcpy(base, src, nmemb * sizeof(*base));
+    }
+
+    ufree(tasks);
+    ufree(bounds);
+    ufree(aux);
+}
+
+void parallel_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp)
+{
+    parallel_sort_ext(base, nmemb, cmp, 0);
+}
+
+/*
+ * Pattern-defeating quicksort, after Orson Peters' pdqsort. Elements equal to
+ * the pivot of the parent partition are gathered in one linear pass, partitions
+ * found already in order are finished with a bounded insertion sort, bad
+ * partitions get shuffled and after log2(n) of them heapsort takes over.
+ * Partitioning is done in blocks (Edelkamp & Weiss, BlockQuicksort): positions
+ * of misplaced elements are recorded without branching on comparison results
+ * and swapped afterwards. Recursion goes to the smaller side only.
+ */
+#define PDQ_INSERTION_THRESHOLD 24
+#define PDQ_NINTHER_THRESHOLD 128
+#define PDQ_PARTIAL_INSERTION_LIMIT 8
+#define PDQ_BLOCK_SIZE 64
+
+static inline bool _less(ugeneric_t a, ugeneric_t b, void_cmp_t cmp)
+{
+    return ugeneric_compare_v(a, b, cmp) < 0;
+}
+
+static void _sift_down(ugeneric_t *base, size_t i, size_t nmemb, void_cmp_t cmp)
+{
+    ugeneric_t t = base[i];
+    for (size_t child = 2 * i + 1; child < nmemb; child = 2 * i + 1)
+    {
+        if ((child + 1 < nmemb) && _less(base[child], base[child + 1], cmp))
+        {
+            child++;
+        }
+        if (!_less(t, base[child], cmp))
+        {
+            break;
+        }
+        base[i] = base[child];
+        i = child;
+    }
+    base[i] = t;
+}
+
+static void _heap_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp)
+{
+    for (size_t i = nmemb / 2; i-- > 0;)
+    {
+        _sift_down(base, i, nmemb, cmp);
+    }
+    for (size_t i = nmemb - 1; i > 0; i--)
+    {
+        ugeneric_swap(base, base + i);
+        _sift_down(base, 0, i, cmp);
+    }
+}
+
+// Element right before begin must not be greater than any in [begin, end).
+static void _unguarded_insertion_sort(ugeneric_t *begin, ugeneric_t *end,
+                                      void_cmp_t cmp)
+{
+    for (ugeneric_t *cur = begin + 1; cur < end; cur++)
+    {
+        if (_less(*cur, cur[-1], cmp))
+        {
+            ugeneric_t t = *cur;
+            ugeneric_t *sift = cur;
+            do
+            {
+                *sift = sift[-1];
+                sift--;
+            } while (_less(t, sift[-1], cmp));
+            *sift = t;
+        }
+    }
+}
+
+// Gives up as soon as more than a few elements had to be moved.
+static bool _partial_insertion_sort(ugeneric_t *begin, ugeneric_t *end,
+                                    void_cmp_t cmp)
+{
+    size_t moved = 0;
+    for (ugeneric_t *cur = begin + 1; cur < end; cur++)
+    {
+        if (_less(*cur, cur[-1], cmp))
+        {
+            ugeneric_t t = *cur;
+            ugeneric_t *sift = cur;
+            do
+            {
+                *sift = sift[-1];
+                sift--;
+            } while ((sift != begin) && _less(t, sift[-1], cmp));
+            *sift = t;
+            moved += cur - sift;
+        }
+        if (moved > PDQ_PARTIAL_INSERTION_LIMIT)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static inline void _sort2(ugeneric_t *a, ugeneric_t *b, void_cmp_t cmp)
+{
+    if (_less(*b, *a, cmp))
+    {
+        ugeneric_swap(a, b);
+    }
+}
+
+static inline void _sort3(ugeneric_t *a, ugeneric_t *b, ugeneric_t *c,
+                          void_cmp_t cmp)
+{
+    _sort2(a, b, cmp);
+    _sort2(b, c, cmp);
+    _sort2(a, b, cmp);
+}
+
+/* Pivot is *begin, elements equal to it go to the left. Returns the final
+ * position of the pivot.
+ */
+static ugeneric_t *_partition_left(ugeneric_t *begin, ugeneric_t *end,
+                                   void_cmp_t cmp)
+{
+    ugeneric_t pivot = *begin;
+    ugeneric_t *first = begin;
+    ugeneric_t *last = end;
+
+    while (_less(pivot, *--last, cmp));
+    if (last + 1 == end)
+    {
+        while ((first < last) && !_less(pivot, *++first, cmp));
+    }
+    else
+    {
+        while (!_less(pivot, *++first, cmp));
+    }
+
+    while (first < last)
+    {
+        ugeneric_swap(first, last);
+        while (_less(pivot, *--last, cmp));
+        while (!_less(pivot, *++first, cmp));
+    }
+
+    *begin = *last;
+    *last = pivot;
+
+    return last;
+}
+
+static void _swap_offsets(ugeneric_t *first, ugeneric_t *last,
+                          const unsigned char *offsets_l,
+                          const unsigned char *offsets_r, size_t num,
+                          bool use_swaps)
+{
+    if (use_swaps)
+    {
+        // Keeps descending input O(n log n).
+        for (size_t i = 0; i < num; i++)
+        {
+            ugeneric_swap(first + offsets_l[i], last - offsets_r[i]);
+        }
+    }
+    else if (num > 0)
+    {
+        // Cyclic permutation, one move per element instead of three.
+        ugeneric_t *l = first + offsets_l[0];
+        ugeneric_t *r = last - offsets_r[0];
+        ugeneric_t t = *l;
+        *l = *r;
+        for (size_t i = 1; i < num; i++)
+        {
+            l = first + offsets_l[i];
+            *r = *l;
+            r = last - offsets_r[i];
+            *l = *r;
+        }
+        *r = t;
+    }
+}
+
+/* Pivot is *begin, elements equal to it go to the right. Returns the final
+ * position of the pivot, *already_partitioned tells if nothing was swapped.
+ */
+static ugeneric_t *_partition_right(ugeneric_t *begin, ugeneric_t *end,
+                                    void_cmp_t cmp, bool *already_partitioned)
+{
+    ugeneric_t pivot = *begin;
+    ugeneric_t *first = begin;
+    ugeneric_t *last = end;
+
+    // Median of 3 guarantees there is an element not less than the pivot.
+    while (_less(*++first, pivot, cmp));
+    if (first - 1 == begin)
+    {
+        while ((first < last) && !_less(*--last, pivot, cmp));
+    }
+    else
+    {
+        while (!_less(*--last, pivot, cmp));
+    }
+
+    *already_partitioned = (first >= last);
+    if (!*already_partitioned)
+    {
+        ugeneric_swap(first, last);
+        first++;
+
+        unsigned char offsets_l[PDQ_BLOCK_SIZE];
+        unsigned char offsets_r[PDQ_BLOCK_SIZE];
+        ugeneric_t *offsets_l_base = first;
+        ugeneric_t *offsets_r_base = last;
+        size_t num_l = 0;
+        size_t num_r = 0;
+        size_t start_l = 0;
+        size_t start_r = 0;
+
+        while (first < last)
+        {
+            // Fill the blocks with offsets of the elements on the wrong side.
+            size_t num_unknown = last - first;
+            size_t left_split = num_l ? 0 : (num_r ? num_unknown : num_unknown / 2);
+            size_t right_split = num_r ? 0 : (num_unknown - left_split);
+
+            size_t n = MIN(left_split, PDQ_BLOCK_SIZE);
+            for (size_t i = 0; i < n; i++)
+            {
+                offsets_l[num_l] = (unsigned char)i;
+                num_l += !_less(*first++, pivot, cmp);
+            }
+            n = MIN(right_split, PDQ_BLOCK_SIZE);
+            for (size_t i = 1; i <= n; i++)
+            {
+                offsets_r[num_r] = (unsigned char)i;
+                num_r += _less(*--last, pivot, cmp);
+            }
+
+            size_t num = MIN(num_l, num_r);
+            _swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l,
+                          offsets_r + start_r, num, num_l == num_r);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+
+            if (num_l == 0)
+            {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0)
+            {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        // One of the blocks may still have leftovers.
+        if (num_l)
+        {
+            while (num_l--)
+            {
+                ugeneric_swap(offsets_l_base + offsets_l[start_l + num_l], --last);
+            }
+            first = last;
+        }
+        if (num_r)
+        {
+            while (num_r--)
+            {
+                ugeneric_swap(offsets_r_base - offsets_r[start_r + num_r], first++);
+            }
+        }
+    }
+
+    ugeneric_t *pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+
+    return pivot_pos;
+}
+
+static void _break_patterns(ugeneric_t *begin, ugeneric_t *end)
+{
+    size_t size = end - begin;
+    if (size >= PDQ_INSERTION_THRESHOLD)
+    {
+        size_t q = size / 4;
+        ugeneric_swap(begin, begin + q);
+        ugeneric_swap(end - 1, end - q);
+        if (size > PDQ_NINTHER_THRESHOLD)
+        {
+            ugeneric_swap(begin + 1, begin + q + 1);
+            ugeneric_swap(begin + 2, begin + q + 2);
+            ugeneric_swap(end - 2, end - q - 1);
+            ugeneric_swap(end - 3, end - q - 2);
+        }
+    }
+}
+
+static void _pdq_sort(ugeneric_t *begin, ugeneric_t *end, void_cmp_t cmp,
+                      int bad_allowed, bool leftmost)
+{
+    for (;;)
+    {
+        size_t size = end - begin;
+
+        if (size < PDQ_INSERTION_THRESHOLD)
+        {
+            if (leftmost)
+            {
+                _insertion_sort(begin, size, cmp);
+            }
+            else
+            {
+                _unguarded_insertion_sort(begin, end, cmp);
+            }
+            return;
+        }
+
+        // Median of 3 or pseudomedian of 9 goes to *begin.
+        size_t s2 = size / 2;
+        if (size > PDQ_NINTHER_THRESHOLD)
+        {
+            _sort3(begin, begin + s2, end - 1, cmp);
+            _sort3(begin + 1, begin + s2 - 1, end - 2, cmp);
+            _sort3(begin + 2, begin + s2 + 1, end - 3, cmp);
+            _sort3(begin + s2 - 1, begin + s2, begin + s2 + 1, cmp);
+            ugeneric_swap(begin, begin + s2);
+        }
+        else
+        {
+            _sort3(begin + s2, begin, end - 1, cmp);
+        }
+
+        // Pivot equal to the one of the parent partition: everything equal to
+        // it is in place after the left partitioning, only greater ones remain.
+        if (!leftmost && !_less(begin[-1], *begin, cmp))
+        {
+            begin = _partition_left(begin, end, cmp) + 1;
+            continue;
+        }
+
+        bool already_partitioned;
+        ugeneric_t *pivot_pos = _partition_right(begin, end, cmp,
+                                                 &already_partitioned);
+        size_t l_size = pivot_pos - begin;
+        size_t r_size = end - (pivot_pos + 1);
+
+        if ((l_size < size / 8) || (r_size < size / 8))
+        {
+            if (--bad_allowed == 0)
+            {
+                _heap_sort(begin, size, cmp);
+                return;
+            }
+            _break_patterns(begin, pivot_pos);
+            _break_patterns(pivot_pos + 1, end);
+        }
+        else if (already_partitioned &&
+                 _partial_insertion_sort(begin, pivot_pos, cmp) &&
+                 _partial_insertion_sort(pivot_pos + 1, end, cmp))
+        {
+            return;
+        }
+
+        if (l_size < r_size)
+        {
+            _pdq_sort(begin, pivot_pos, cmp, bad_allowed, leftmost);
+            begin = pivot_pos + 1;
+            leftmost = false;
+        }
+        else
+        {
+            _pdq_sort(pivot_pos + 1, end, cmp, bad_allowed, false);
+            end = pivot_pos;
+        }
+    }
+}
+
+void pdq_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp)
+{
+    if (nmemb < 2)
+    {
+        return;
+    }
+    UASSERT_INPUT(base);
+
+    // Ascending and strictly descending input is done in one pass.
+    size_t i = 1;
+    while ((i < nmemb) && !_less(base[i], base[i - 1], cmp))
+    {
+        i++;
+    }
+    if (i == nmemb)
+    {
+        return;
+    }
+    if (i == 1)
+    {
+        while ((i < nmemb) && _less(base[i], base[i - 1], cmp))
+        {
+            i++;
+        }
+        if (i == nmemb)
+        {
+            ugeneric_array_reverse(base, nmemb, 0, nmemb - 1);
+            return;
+        }
+    }
+
+    int bad_allowed = 0;
+    for (size_t n = nmemb; n; n >>= 1)
+    {
+        bad_allowed++;
+    }
+    _pdq_sort(base, base + nmemb, cmp, bad_allowed, true);
+}
+
+/*
+ * TimSort: natural runs (strictly descending ones reversed) are extended to
+ * a minimal length with binary insertion sort and pushed to a stack which is
+ * kept close to balanced, so merges are of about equal sizes. A merge only
+ * copies the shorter run aside, hence scratch space never exceeds n / 2, and
+ * switches to galloping when one run keeps winning. Sorted input is a single
+ * run and costs n - 1 comparisons.
+ */
+#define TIM_MIN_MERGE 32
+#define TIM_MIN_GALLOP 7
+#define TIM_MAX_RUNS 85 // enough for any 64 bit length
+
+typedef struct {
+    ugeneric_t *a;
+    void_cmp_t cmp;
+    ugeneric_t *tmp;
+    size_t tmp_size;
+    ptrdiff_t min_gallop;
+    size_t runs;
+    ptrdiff_t run_base[TIM_MAX_RUNS];
+    ptrdiff_t run_len[TIM_MAX_RUNS];
+} _tim_state_t;
+
+static inline int _tim_cmp(_tim_state_t *ts, ugeneric_t a, ugeneric_t b)
+{
+    return ugeneric_compare_v(a, b, ts->cmp);
+}
+
+static size_t _tim_min_run(size_t n)
+{
+    size_t r = 0;
+    while (n >= TIM_MIN_MERGE)
+    {
+        r |= n & 1;
+        n >>= 1;
+    }
+
+    return n + r;
+}
+
+static size_t _tim_count_run(_tim_state_t *ts, ugeneric_t *a, size_t n)
+{
+    size_t hi = 1;
+    if (hi == n)
+    {
+        return 1;
+    }
+
+    if (_tim_cmp(ts, a[hi++], a[0]) < 0)
+    {
+        while ((hi < n) && (_tim_cmp(ts, a[hi], a[hi - 1]) < 0))
+        {
+            hi++;
+        }
+        ugeneric_array_reverse(a, n, 0, hi - 1);
+    }
+    else
+    {
+        while ((hi < n) && (_tim_cmp(ts, a[hi], a[hi - 1]) >= 0))
+        {
+            hi++;
+        }
+    }
+
+    return hi;
+}
+
+// [0, start) is sorted already.
+static void _tim_binary_sort(_tim_state_t *ts, ugeneric_t *a, size_t n,
+                             size_t start)
+{
+    for (start = MAX(start, 1); start < n; start++)
+    {
+        ugeneric_t pivot = a[start];
+        size_t l = 0;
+        size_t r = start;
+        while (l < r)
+        {
+            size_t m = l + (r - l) / 2;
+            if (_tim_cmp(ts, pivot, a[m]) < 0)
+            {
+                r = m;
+            }
+            else
+            {
+                l = m + 1;
+            }
+        }
+        memmove(a + l + 1, a + l, (start - l) * sizeof(*a));
+        a[l] = pivot;
+    }
+}
+
+/* Leftmost position to insert key into sorted a[0, n), starting the search
+ * from hint: a[k - 1] < key <= a[k].
+ */
+static ptrdiff_t _gallop_left(_tim_state_t *ts, ugeneric_t key,
+                              const ugeneric_t *a, ptrdiff_t n, ptrdiff_t hint)
+{
+    ptrdiff_t last = 0;
+    ptrdiff_t ofs = 1;
+
+    if (_tim_cmp(ts, key, a[hint]) > 0)
+    {
+        ptrdiff_t max = n - hint;
+        while ((ofs < max) && (_tim_cmp(ts, key, a[hint + ofs]) > 0))
+        {
+            last = ofs;
+            ofs = 2 * ofs + 1;
+        }
+        ofs = MIN(ofs, max);
+        last += hint;
+        ofs += hint;
+    }
+    else
+    {
+        ptrdiff_t max = hint + 1;
+        while ((ofs < max) && (_tim_cmp(ts, key, a[hint - ofs]) <= 0))
+        {
+            last = ofs;
+            ofs = 2 * ofs + 1;
+        }
+        ofs = MIN(ofs, max);
+        ptrdiff_t t = last;
+        last = hint - ofs;
+        ofs = hint - t;
+    }
+
+    for (last++; last < ofs;)
+    {
+        ptrdiff_t m = last + (ofs - last) / 2;
+        if (_tim_cmp(ts, key, a[m]) > 0)
+        {
+            last = m + 1;
+        }
+        else
+        {
+            ofs = m;
+        }
+    }
+
+    return ofs;
+}
+
+// Rightmost position instead: a[k - 1] <= key < a[k].
+static ptrdiff_t _gallop_right(_tim_state_t *ts, ugeneric_t key,
+                               const ugeneric_t *a, ptrdiff_t n, ptrdiff_t hint)
+{
+    ptrdiff_t last = 0;
+    ptrdiff_t ofs = 1;
+
+    if (_tim_cmp(ts, key, a[hint]) < 0)
+    {
+        ptrdiff_t max = hint + 1;
+        while ((ofs < max) && (_tim_cmp(ts, key, a[hint - ofs]) < 0))
+        {
+            last = ofs;
+            ofs = 2 * ofs + 1;
+        }
+        ofs = MIN(ofs, max);
+        ptrdiff_t t = last;
+        last = hint - ofs;
+        ofs = hint - t;
+    }
+    else
+    {
+        ptrdiff_t max = n - hint;
+        while ((ofs < max) && (_tim_cmp(ts, key, a[hint + ofs]) >= 0))
+        {
+            last = ofs;
+            ofs = 2 * ofs + 1;
+        }
+        ofs = MIN(ofs, max);
+        last += hint;
+        ofs += hint;
+    }
+
+    for (last++; last < ofs;)
+    {
+        ptrdiff_t m = last + (ofs - last) / 2;
+        if (_tim_cmp(ts, key, a[m]) < 0)
+        {
+            ofs = m;
+        }
+        else
+        {
+            last = m + 1;
+        }
+    }
+
+    return ofs;
+}
+
+static ugeneric_t *_tim_get_tmp(_tim_state_t *ts, size_t size)
+{
+    if (ts->tmp_size < size)
+    {
+        ufree(ts->tmp);
+        ts->tmp = umalloc(size * sizeof(ts->tmp[0]));
+        ts->tmp_size = size;
+    }
+
+    return ts->tmp;
+}
+
+#define TIM_MOVE(dst, src, n) memmove((dst), (src), (n) * sizeof(ugeneric_t))
+
+// Merges adjacent runs of a in place, len1 <= len2, first run is set aside.
+static void _tim_merge_lo(_tim_state_t *ts, ptrdiff_t base1, ptrdiff_t len1,
+                          ptrdiff_t base2, ptrdiff_t len2)
+{
+    ugeneric_t *a = ts->a;
+    ugeneric_t *tmp = _tim_get_tmp(ts, len1);
+    ptrdiff_t c1 = 0;
+    ptrdiff_t c2 = base2;
+    ptrdiff_t dest = base1;
+    ptrdiff_t min_gallop = ts->min_gallop;
+    TIM_MOVE(tmp, a + base1, len1);
+
+    a[dest++] = a[c2++];
+    if (--len2 == 0)
+    {
+        TIM_MOVE(a + dest, tmp + c1, len1);
+        return;
+    }
+    if (len1 == 1)
+    {
+        TIM_MOVE(a + dest, a + c2, len2);
+        a[dest + len2] = tmp[c1];
+        return;
+    }
+
+    for (;;)
+    {
+        ptrdiff_t count1 = 0;
+        ptrdiff_t count2 = 0;
+
+        // One at a time while neither run wins consistently.
+        do
+        {
+            if (_tim_cmp(ts, a[c2], tmp[c1]) < 0)
+            {
+                a[dest++] = a[c2++];
+                count2++;
+                count1 = 0;
+                if (--len2 == 0)
+                {
+                    goto done;
+                }
+            }
+            else
+            {
+                a[dest++] = tmp[c1++];
+                count1++;
+                count2 = 0;
+                if (--len1 == 1)
+                {
+                    goto done;
+                }
+            }
+        } while ((count1 | count2) < min_gallop);
+
+        // Galloping, as long as it pays off.
+        do
+        {
+            count1 = _gallop_right(ts, a[c2], tmp + c1, len1, 0);
+            if (count1)
+            {
+                TIM_MOVE(a + dest, tmp + c1, count1);
+                dest += count1;
+                c1 += count1;
+                len1 -= count1;
+                if (len1 <= 1)
+                {
+                    goto done;
+                }
+            }
+            a[dest++] = a[c2++];
+            if (--len2 == 0)
+            {
+                goto done;
+            }
+
+            count2 = _gallop_left(ts, tmp[c1], a + c2, len2, 0);
+            if (count2)
+            {
+                TIM_MOVE(a + dest, a + c2, count2);
+                dest += count2;
+                c2 += count2;
+                len2 -= count2;
+                if (len2 == 0)
+                {
+                    goto done;
+                }
+            }
+            a[dest++] = tmp[c1++];
+            if (--len1 == 1)
+            {
+                goto done;
+            }
+            min_gallop--;
+        } while ((count1 >= TIM_MIN_GALLOP) || (count2 >= TIM_MIN_GALLOP));
+        min_gallop = MAX(min_gallop, 0) + 2;
+    }
+
+done:
+    ts->min_gallop = MAX(min_gallop, 1);
+    if (len1 == 1)
+    {
+        TIM_MOVE(a + dest, a + c2, len2);
+        a[dest + len2] = tmp[c1];
+    }
+    else
+    {
+        // len1 is 0 only if the comparator is inconsistent, nothing is lost.
+        TIM_MOVE(a + dest, tmp + c1, len1);
+    }
+}
+
+// Mirror of _tim_merge_lo() for len1 > len2, merges from the end.
+static void _tim_merge_hi(_tim_state_t *ts, ptrdiff_t base1, ptrdiff_t len1,
+                          ptrdiff_t base2, ptrdiff_t len2)
+{
+    ugeneric_t *a = ts->a;
+    ugeneric_t *tmp = _tim_get_tmp(ts, len2);
+    ptrdiff_t c1 = base1 + len1 - 1;
+    ptrdiff_t c2 = len2 - 1;
+    ptrdiff_t dest = base2 + len2 - 1;
+    ptrdiff_t min_gallop = ts->min_gallop;
+    TIM_MOVE(tmp, a + base2, len2);
+
+    a[dest--] = a[c1--];
+    if (--len1 == 0)
+    {
+        TIM_MOVE(a + dest - (len2 - 1), tmp, len2);
+        return;
+    }
+    if (len2 == 1)
+    {
+        dest -= len1;
+        c1 -= len1;
+        TIM_MOVE(a + dest + 1, a + c1 + 1, len1);
+        a[dest] = tmp[c2];
+        return;
+    }
+
+    for (;;)
+    {
+        ptrdiff_t count1 = 0;
+        ptrdiff_t count2 = 0;
+
+        do
+        {
+            if (_tim_cmp(ts, tmp[c2], a[c1]) < 0)
+            {
+                a[dest--] = a[c1--];
+                count1++;
+                count2 = 0;
+                if (--len1 == 0)
+                {
+                    goto done;
+                }
+            }
+            else
+            {
+                a[dest--] = tmp[c2--];
+                count2++;
+                count1 = 0;
+                if (--len2 == 1)
+                {
+                    goto done;
+                }
+            }
+        } while ((count1 | count2) < min_gallop);
+
+        do
+        {
+            count1 = len1 - _gallop_right(ts, tmp[c2], a + base1, len1, len1 - 1);
+            if (count1)
+            {
+                dest -= count1;
+                c1 -= count1;
+                len1 -= count1;
+                TIM_MOVE(a + dest + 1, a + c1 + 1, count1);
+                if (len1 == 0)
+                {
+                    goto done;
+                }
+            }
+            a[dest--] = tmp[c2--];
+            if (--len2 == 1)
+            {
+                goto done;
+            }
+
+            count2 = len2 - _gallop_left(ts, a[c1], tmp, len2, len2 - 1);
+            if (count2)
+            {
+                dest -= count2;
+                c2 -= count2;
+                len2 -= count2;
+                TIM_MOVE(a + dest + 1, tmp + c2 + 1, count2);
+                if (len2 <= 1)
+                {
+                    goto done;
+                }
+            }
+            a[dest--] = a[c1--];
+            if (--len1 == 0)
+            {
+                goto done;
+            }
+            min_gallop--;
+        } while ((count1 >= TIM_MIN_GALLOP) || (count2 >= TIM_MIN_GALLOP));
+        min_gallop = MAX(min_gallop, 0) + 2;
+    }
+
+done:
+    ts->min_gallop = MAX(min_gallop, 1);
+    if (len2 == 1)
+    {
+        dest -= len1;
+        c1 -= len1;
+        TIM_MOVE(a + dest + 1, a + c1 + 1, len1);
+        a[dest] = tmp[c2];
+    }
+    else
+    {
+        TIM_MOVE(a + dest - (len2 - 1), tmp, len2);
+    }
+}
+
+static void _tim_merge_at(_tim_state_t *ts, size_t i)
+{
+    ugeneric_t *a = ts->a;
+    ptrdiff_t base1 = ts->run_base[i];
+    ptrdiff_t len1 = ts->run_len[i];
+    ptrdiff_t base2 = ts->run_base[i + 1];
+    ptrdiff_t len2 = ts->run_len[i + 1];
+
+    ts->run_len[i] = len1 + len2;
+    if (i == ts->runs - 3)
+    {
+        ts->run_base[i + 1] = ts->run_base[i + 2];
+        ts->run_len[i + 1] = ts->run_len[i + 2];
+    }
+    ts->runs--;
+
+    // Elements of run 1 before the first of run 2 and elements of run 2
+    // after the last of run 1 are in place already.
+    ptrdiff_t k = _gallop_right(ts, a[base2], a + base1, len1, 0);
+    base1 += k;
+    len1 -= k;
+    if (len1 == 0)
+    {
+        return;
+    }
+    len2 = _gallop_left(ts, a[base1 + len1 - 1], a + base2, len2, len2 - 1);
+    if (len2 == 0)
+    {
+        return;
+    }
+
+    if (len1 <= len2)
+    {
+        _tim_merge_lo(ts, base1, len1, base2, len2);
+    }
+    else
+    {
+        _tim_merge_hi(ts, base1, len1, base2, len2);
+    }
+}
+
+static void _tim_merge_collapse(_tim_state_t *ts)
+{
+    ptrdiff_t *len = ts->run_len;
+    while (ts->runs > 1)
+    {
+        size_t n = ts->runs - 2;
+        if (((n > 0) && (len[n - 1] <= len[n] + len[n + 1])) ||
+            ((n > 1) && (len[n - 2] <= len[n - 1] + len[n])))
+        {
+            if (len[n - 1] < len[n + 1])
+            {
+                n--;
+            }
+        }
+        else if (len[n] > len[n + 1])
+        {
+            break;
+        }
+        _tim_merge_at(ts, n);
+    }
+}
+
+void tim_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp)
+{
+    if (nmemb < 2)
+    {
+        return;
+    }
+    UASSERT_INPUT(base);
+
+    _tim_state_t ts = {.a = base, .cmp = cmp, .min_gallop = TIM_MIN_GALLOP};
+
+    if (nmemb < TIM_MIN_MERGE)
+    {
+        _tim_binary_sort(&ts, base, nmemb, _tim_count_run(&ts, base, nmemb));
+        return;
+    }
+
+    size_t min_run = _tim_min_run(nmemb);
+    size_t lo = 0;
+    while (lo < nmemb)
+    {
+        size_t remaining = nmemb - lo;
+        size_t len = _tim_count_run(&ts, base + lo, remaining);
+        if (len < min_run)
+        {
+            size_t force = MIN(remaining, min_run);
+            _tim_binary_sort(&ts, base + lo, force, len);
+            len = force;
+        }
+
+        UASSERT_INTERNAL(ts.runs < TIM_MAX_RUNS);
+        ts.run_base[ts.runs] = lo;
+        ts.run_len[ts.runs] = len;
+        ts.runs++;
+        _tim_merge_collapse(&ts);
+        lo += len;
+    }
+
+    while (ts.runs > 1)
+    {
+        size_t n = ts.runs - 2;
+        if ((n > 0) && (ts.run_len[n - 1] < ts.run_len[n + 1]))
+        {
+            n--;
+        }
+        _tim_merge_at(&ts, n);
+    }
+
+    ufree(ts.tmp);
+}
+
+/* Radix keys: order of the unsigned key is the order of the value. Signed
+ * integers get their sign bit flipped, for doubles negative ones are inverted
+ * as a whole and positive ones get the sign bit set. -0.0 is equal to 0.0 and
+ * gets its key, so the sort stays stable. Other keys are reversible, so only
+ * the keys are sorted and values are restored from them afterwards: items of
+ * one numeric type are equal only if they are identical, save for zeros whose
+ * signs are put back in their original order.
+ */
+#define RADIX_SIGN_BIT ((uint64_t)1 << 63)
+#define RADIX_ZERO_KEY RADIX_SIGN_BIT // of both 0.0 and -0.0
+
+static inline uint64_t _radix_key(ugeneric_t g)
+{
+    uint64_t k;
+
+    switch (g.t.type)
+    {
+        case G_INT_T:
+            return (uint64_t)G_AS_INT(g) ^ RADIX_SIGN_BIT;
+        case G_REAL_T:
+            memcpy(&k, &G_AS_REAL(g), sizeof(k));
+            if (k == RADIX_SIGN_BIT)
+            {
+                return RADIX_ZERO_KEY;
+            }
+            return (k & RADIX_SIGN_BIT) ? ~k : (k | RADIX_SIGN_BIT);
+        default:
+            return G_AS_SIZE(g);
+    }
+}
+
+static inline ugeneric_t _radix_value(uint64_t k, ugeneric_type_e type)
+{
+    double d;
+
+    switch (type)
+    {
+        case G_INT_T:
+            return G_INT((long)(k ^ RADIX_SIGN_BIT));
+        case G_REAL_T:
+            k = (k & RADIX_SIGN_BIT) ? (k ^ RADIX_SIGN_BIT) : ~k;
+            memcpy(&d, &k, sizeof(d));
+            return G_REAL(d);
+        default:
+            return G_SIZE(k);
+    }
+}
+
+static void _lsd_radix_sort(ugeneric_t *base, size_t nmemb)
+{
+    size_t counts[8][256] = {0};
+    uint64_t *keys = umalloc(2 * nmemb * sizeof(keys[0]));
+    ugeneric_type_e type = base[0].t.type;
+    bool *negative_zeros = NULL;
+    size_t zeros = 0;
+
+    for (size_t i = 0; i < nmemb; i++)
+    {
+        uint64_t k = _radix_key(base[i]);
+        if ((type == G_REAL_T) && (k == RADIX_ZERO_KEY))
+        {
+            if (!negative_zeros)
+            {
+                negative_zeros = umalloc(nmemb * sizeof(negative_zeros[0]));
+            }
+            negative_zeros[zeros++] = signbit(G_AS_REAL(base[i]));
+        }
+        keys[i] = k;
+        for (size_t b = 0; b < 8; b++)
+        {
+            counts[b][(k >> (b * 8)) & 0xff]++;
+        }
+    }
+
+    uint64_t *src = keys;
+    uint64_t *dst = keys + nmemb;
+    for (size_t b = 0; b < 8; b++)
+    {
+        size_t *c = counts[b];
+        if (c[(src[0] >> (b * 8)) & 0xff] == nmemb)
+        {
+            continue; // all keys share this byte
+        }
+
+        size_t offset = 0;
+        for (size_t i = 0; i < 256; i++)
+        {
+            size_t n = c[i];
+            c[i] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < nmemb; i++)
+        {
+            dst[c[(src[i] >> (b * 8)) & 0xff]++] = src[i];
+        }
+
+        uint64_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    for (size_t i = 0, z = 0; i < nmemb; i++)
+    {
+        base[i] = _radix_value(src[i], type);
+        if (negative_zeros && (src[i] == RADIX_ZERO_KEY) && negative_zeros[z++])
+        {
+            base[i] = G_REAL(-0.0);
+        }
+    }
+    ufree(negative_zeros);
+    ufree(keys);
+}
+
+// Stable insertion sort of strings sharing first depth characters.
+static void _str_insertion_sort(ugeneric_t *base, size_t nmemb, size_t depth)
+{
+    for (size_t i = 1; i < nmemb; i++)
+    {
+        size_t j = i;
+        ugeneric_t t = base[i];
+        while (j > 0 && (strcmp(G_AS_STR(base[j - 1]) + depth,
+                                G_AS_STR(t) + depth) > 0))
+        {
+            base[j] = base[j - 1];
+            j--;
+        }
+        base[j] = t;
+    }
+}
+
+/*
+ * Only buckets smaller than the biggest one are sorted recursively, each of
+ * them holds at most half of the items, so there are no more than log2(n)
+ * nested calls. The biggest bucket is sorted by the loop itself, a shared
+ * prefix of any length costs one pass per character and no stack. The level
+ * limit is a safety net only, past it the comparison sort takes over.
+ */
+#define MSD_RADIX_MAX_LEVEL 48
+
+static void _msd_radix_sort(ugeneric_t *base, ugeneric_t *aux, size_t nmemb,
+                            size_t depth, size_t level)
+{
+    if (level > MSD_RADIX_MAX_LEVEL)
+    {
+        pdq_sort(base, nmemb, NULL);
+        return;
+    }
+
+    while (nmemb > USORT_RADIX_THRESHOLD)
+    {
+        size_t c[257] = {0};
+        for (size_t i = 0; i < nmemb; i++)
+        {
+            c[(unsigned char)G_AS_STR(base[i])[depth] + 1]++;
+        }
+
+        size_t big = 0;
+        for (size_t i = 1; i < 256; i++)
+        {
+            big = (c[i + 1] > c[big + 1]) ? i : big;
+        }
+        if (c[big + 1] == nmemb)
+        {
+            if (big == 0)
+            {
+                return; // all the strings have ended, they are equal
+            }
+            depth++;
+            continue;
+        }
+
+        for (size_t i = 1; i < 257; i++)
+        {
+            c[i] += c[i - 1];
+        }
+        size_t start[256];
+        memcpy(start, c, sizeof(start));
+        for (size_t i = 0; i < nmemb; i++)
+        {
+            aux[c[(unsigned char)G_AS_STR(base[i])[depth]]++] = base[i];
+        }
+        memcpy(base, aux, nmemb * sizeof(*base));
+
+        // Bucket 0 holds strings which have ended, they are all equal.
+        for (size_t i = 1; i < 256; i++)
+        {
+            size_t n = c[i] - start[i];
+            if ((i != big) && (n > 1))
+            {
+                _msd_radix_sort(base + start[i], aux, n, depth + 1, level + 1);
+            }
+        }
+        if (big == 0)
+        {
+            return;
+        }
+        base += start[big];
+        nmemb = c[big] - start[big];
+        depth++;
+    }
+
+    _str_insertion_sort(base, nmemb, depth);
+}
+
+void radix_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp)
+{
+    if (nmemb < 2)
+    {
+        return;
+    }
+    UASSERT_INPUT(base);
+
+    // Radix is only worth it for homogeneous numbers or strings.
+    ugeneric_type_e type = ugeneric_get_type(base[0]);
+    bool strings = G_IS_STRING(base[0]);
+    bool numbers = (type == G_INT_T) || (type == G_SIZE_T) || (type == G_REAL_T);
+    for (size_t i = 0; (strings || numbers) && (i < nmemb); i++)
+    {
+        if (strings)
+        {
+            strings = G_IS_STRING(base[i]);
+        }
+        else
+        {
+            numbers = (base[i].t.type == type) &&
+                      !((type == G_REAL_T) &&
+                        (G_AS_REAL(base[i]) != G_AS_REAL(base[i]))); // NaN
+        }
+    }
+
+    if (!strings && !numbers)
+    {
+        pdq_sort(base, nmemb, cmp);
+    }
+    else if (nmemb <= USORT_RADIX_THRESHOLD)
+    {
+        _insertion_sort(base, nmemb, cmp);
+    }
+    else if (numbers)
+    {
+        _lsd_radix_sort(base, nmemb);
+    }
+    else
+    {
+        ugeneric_t *aux = umalloc(nmemb * sizeof(*aux));
+        _msd_radix_sort(base, aux, nmemb, 0, 0);
+        ufree(aux);
+    }
+}
+
+/* Sort record of key_sort(): the first 8 bytes of a string key (big endian,
+ * zero padded) or the whole radix key of a number, the rest of a string key
+ * which is only looked at when prefixes are equal and the original position.
+ */
+typedef struct {
+    uint64_t prefix;
+    const char *rest;
+    size_t index;
+} _keyed_t;
+
+static int _keyed_cmp(const void *p1, const void *p2)
+{
+    const _keyed_t *a = p1;
+    const _keyed_t *b = p2;
+
+    if (a->prefix != b->prefix)
+    {
+        return (a->prefix > b->prefix) ? 1 : -1;
+    }
+    // Equal prefixes without a terminator in them mean both strings go on.
+    if (a->rest)
+    {
+        int diff = strcmp(a->rest, b->rest);
+        if (diff)
+        {
+            return diff;
+        }
+    }
+
+    return (a->index > b->index) - (a->index < b->index);
+}
+
+static void _keyed_radix_sort(_keyed_t *records, size_t nmemb)
+{
+    size_t counts[8][256] = {0};
+    for (size_t i = 0; i < nmemb; i++)
+    {
+        for (size_t b = 0; b < 8; b++)
+        {
+            counts[b][(records[i].prefix >> (b * 8)) & 0xff]++;
+        }
+    }
+
+    _keyed_t *aux = umalloc(nmemb * sizeof(aux[0]));
+    _keyed_t *src = records;
+    _keyed_t *dst = aux;
+    for (size_t b = 0; b < 8; b++)
+    {
+        size_t *c = counts[b];
+        if (c[(src[0].prefix >> (b * 8)) & 0xff] == nmemb)
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t i = 0; i < 256; i++)
+        {
+            size_t n = c[i];
+            c[i] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < nmemb; i++)
+        {
+            dst[c[(src[i].prefix >> (b * 8)) & 0xff]++] = src[i];
+        }
+
+        _keyed_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != records)
+    {
+        memcpy(records, src, nmemb * sizeof(records[0]));
+    }
+    ufree(aux);
+}
+
+static uint64_t _string_prefix(const char *str, const char **rest)
+{
+    uint64_t prefix = 0;
+    size_t i = 0;
+    for (; (i < sizeof(prefix)) && str[i]; i++)
+    {
+        prefix |= (uint64_t)(unsigned char)str[i] << (8 * (sizeof(prefix) - 1 - i));
+    }
+    *rest = (i == sizeof(prefix)) ? str + i : NULL;
+
+    return prefix;
+}
+
+void key_sort(ugeneric_t *base, size_t nmemb, ugeneric_key_fn_t key)
+{
+    if (nmemb < 2)
+    {
+        return;
+    }
+    UASSERT_INPUT(base);
+
+    _keyed_t *records = umalloc(nmemb * sizeof(records[0]));
+    ugeneric_type_e type = G_NULL_T;
+    for (size_t i = 0; i < nmemb; i++)
+    {
+        ugeneric_t k = key ? key(base[i]) : base[i];
+        records[i].index = i;
+        records[i].rest = NULL;
+        if (G_IS_STRING(k))
+        {
+            records[i].prefix = _string_prefix(G_AS_STR(k), &records[i].rest);
+            k.t.type = G_STR_T;
+        }
+        else
+        {
+            UASSERT_INPUT(G_IS_INT(k) || G_IS_SIZE(k) || G_IS_REAL(k));
+            UASSERT_INPUT(!G_IS_REAL(k) || (G_AS_REAL(k) == G_AS_REAL(k)));
+            records[i].prefix = _radix_key(k);
+        }
+        UASSERT_INPUT((i == 0) || (k.t.type == type)); // keys of one kind
+        type = k.t.type;
+    }
+
+    // Records are ordered by prefixes with a stable radix, only runs of equal
+    // prefixes with strings going on need an actual comparison sort.
+    _keyed_radix_sort(records, nmemb);
+    for (size_t i = 0, j; i < nmemb; i = j)
+    {
+        for (j = i + 1; (j < nmemb) && (records[j].prefix == records[i].prefix); j++);
+        if ((j - i > 1) && records[i].rest)
+        {
+            qsort(records + i, j - i, sizeof(records[0]), _keyed_cmp);
+        }
+    }
+
+    ugeneric_t *sorted = umalloc(nmemb * sizeof(*sorted));
+    for (size_t i = 0; i < nmemb; i++)
+    {
+        sorted[i] = base[records[i].index];
+    }
+    memcpy(base, sorted, nmemb * sizeof(*base));
+
+    ufree(sorted);
+    ufree(records);
+}
+
+void prefix_sort(ugeneric_t *base, size_t nmemb, void_cmp_t cmp)
+{
+    for (size_t i = 0; i < nmemb; i++)
+    {
+        if (!G_IS_STRING(base[i]))
+        {
+            pdq_sort(base, nmemb, cmp);
+            return;
+        }
+    }
+    key_sort(base, nmemb, NULL);
+}
+
+/*
+ * Selection (introselect). Ranges above SELECT_SAMPLING_THRESHOLD are first
+ * narrowed by recursively selecting from a sample around the expected position
+ * (Floyd & Rivest, Algorithm 489), so the pivot lands close to the wanted rank
+ * and about n + min(k, n - k) comparisons are made on average. A partition
+ * which doesn't cut a quarter off the range is a bad one, after log2(n) of
+ * them heap selection finishes the job in O(n log n).
+ */
+#define SELECT_SAMPLING_THRESHOLD 600
+#define SELECT_INSERTION_THRESHOLD 16
+
+static size_t _isqrt(size_t x)
+{
+    if (x < 2)
+    {
+        return x;
+    }
+
+    size_t r = x / 2 + 1;
+    for (size_t y = (r + x / r) / 2; y < r; y = (r + x / r) / 2)
+    {
+        r = y;
+    }
+
+    return r;
+}
+
+static size_t _icbrt(size_t x)
+{
+    size_t r = 0;
+    for (int bit = 21; bit >= 0; bit--)
+    {
+        size_t t = r | ((size_t)1 << bit);
+        if (t <= x / t / t)
+        {
+            r = t;
+        }
+    }
+
+    return r;
+}
+
+// Puts the n + 1 smallest elements in front with the greatest one at n.
+static void _heap_select(ugeneric_t *base, size_t nmemb, size_t n,
+                         void_cmp_t cmp)
+{
+    size_t size = n + 1;
+    for (size_t i = size / 2; i-- > 0;)
+    {
+        _sift_down(base, i, size, cmp);
+    }
+    for (size_t i = size; i < nmemb; i++)
+    {
+        if (_less(base[i], base[0], cmp))
+        {
+            ugeneric_swap(base, base + i);
+            _sift_down(base, 0, size, cmp);
+        }
+    }
+    ugeneric_swap(base, base + n);
+}
+
+// [left:right]
+static void _select(ugeneric_t *base, ptrdiff_t left, ptrdiff_t right,
+                    ptrdiff_t k, void_cmp_t cmp, int bad_allowed)
+{
+    while (right > left)
+    {
+        ptrdiff_t size = right - left + 1;
+        if (size < SELECT_INSERTION_THRESHOLD)
+        {
+            _insertion_sort(base + left, size, cmp);
+            return;
+        }
+
+        if (size > SELECT_SAMPLING_THRESHOLD)
+        {
+            // Sample of n^(2/3) / 2 elements, widened by a deviation of
+            // sqrt(ln(n) * s * (n - s) / n) / 2 towards the middle.
+            ptrdiff_t i = k - left + 1;
+            ptrdiff_t z = 0;
+            for (size_t n = size; n; n >>= 1)
+            {
+                z++;
+            }
+            z = z * 7 / 10;
+            ptrdiff_t s = _icbrt(size) * _icbrt(size) / 2;
+            ptrdiff_t sd = _isqrt(z * s * (size - s) / size) / 2;
+            if (i < size / 2)
+            {
+                sd = -sd;
+            }
+            ptrdiff_t l = MAX(left, k - i * s / size + sd);
+            ptrdiff_t r = MIN(right, k + (size - i) * s / size + sd);
+            _select(base, l, r, k, cmp, bad_allowed);
+        }
+
+        ugeneric_t t = base[k];
+        ptrdiff_t i = left;
+        ptrdiff_t j = right;
+        ugeneric_swap(base + left, base + k);
+        // The first exchange below moves the pivot to the other end.
+        bool pivot_at_left = _less(t, base[right], cmp);
+        if (pivot_at_left)
+        {
+            ugeneric_swap(base + right, base + left);
+        }
+        while (i < j)
+        {
+            ugeneric_swap(base + i, base + j);
+            i++;
+            j--;
+            while (_less(base[i], t, cmp))
+            {
+                i++;
+            }
+            while (_less(t, base[j], cmp))
+            {
+                j--;
+            }
+        }
+        if (pivot_at_left)
+        {
+            ugeneric_swap(base + left, base + j);
+        }
+        else
+        {
+            j++;
+            ugeneric_swap(base + j, base + right);
+        }
+
+        // The pivot is at its final place j.
+        if (j <= k)
+        {
+            left = j + 1;
+        }
+        if (k <= j)
+        {
+            right = j - 1;
+        }
+        if ((right - left + 1 > size / 4 * 3) && (--bad_allowed == 0))
+        {
+            _heap_select(base + left, right - left + 1, k - left, cmp);
+            return;
+        }
+    }
+}
+
+void nth_element(ugeneric_t *base, size_t nmemb, size_t n, void_cmp_t cmp)
+{
+    UASSERT_INPUT(n < nmemb);
+    UASSERT_INPUT(base);
+
+    int bad_allowed = 0;
+    for (size_t i = nmemb; i; i >>= 1)
+    {
+        bad_allowed++;
+    }
+    _select(base, 0, nmemb - 1, n, cmp, bad_allowed);
+}
+
+void partial_sort(ugeneric_t *base, size_t nmemb, size_t k, void_cmp_t cmp)
+{
+    UASSERT_INPUT(k <= nmemb);
+
+    if (k == 0)
+    {
+        return;
+    }
+    if (k < nmemb)
+    {
+        nth_element(base, nmemb, k - 1, cmp);
+    }
+    pdq_sort(base, k, cmp);
+}
+
+// Min-heap counterpart of _sift_down().
+static void _sift_down_min(ugeneric_t *base, size_t i, size_t nmemb,
+                           void_cmp_t cmp)
+{
+    ugeneric_t t = base[i];
+    for (size_t child = 2 * i + 1; child < nmemb; child = 2 * i + 1)
+    {
+        if ((child + 1 < nmemb) && _less(base[child + 1], base[child], cmp))
+        {
+            child++;
+        }
+        if (!_less(base[child], t, cmp))
+        {
+            break;
+        }
+        base[i] = base[child];
+        i = child;
+    }
+    base[i] = t;
+}
+
+void top_k(ugeneric_t *base, size_t nmemb, size_t k, void_cmp_t cmp)
+{
+    UASSERT_INPUT(k <= nmemb);
+
+    if (k == 0)
+    {
+        return;
+    }
+    UASSERT_INPUT(base);
+
+    // Min-heap of the k greatest so far, most elements are rejected by a
+    // single comparison with its top.
+    for (size_t i = k / 2; i-- > 0;)
+    {
+        _sift_down_min(base, i, k, cmp);
+    }
+    for (size_t i = k; i < nmemb; i++)
+    {
+        if (_less(base[0], base[i], cmp))
+        {
+            ugeneric_swap(base, base + i);
+            _sift_down_min(base, 0, k, cmp);
+        }
+    }
+    for (size_t i = k - 1; i > 0; i--)
+    {
+        ugeneric_swap(base, base + i);
+        _sift_down_min(base, 0, i, cmp);
+    }
+}
+
+static void *_ptopk_worker(void *arg)
+{
+    _psort_task_t *t = arg;
+    top_k(t->src, t->lsize, t->k, t->cmp);
+    return NULL;
+}
+
+void parallel_top_k(ugeneric_t *base, size_t nmemb, size_t k, void_cmp_t cmp,
+                    size_t nthreads)
+{
+    UASSERT_INPUT(k <= nmemb);
+
+    if (nthreads == 0)
+    {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (ncpu > 0) ? (size_t)ncpu : 1;
+    }
+    // Every part has room for its own k winners and those gathered before.
+    nthreads = MIN(nthreads, nmemb / MAX(USORT_PARALLEL_CUTOFF, 2 * k));
+
+    if (nthreads < 2)
+    {
+        top_k(base, nmemb, k, cmp);
+        return;
+    }
+
+    /* Every thread picks k greatest of its part to the part's front, then
+     * those are gathered in front of the array and the final k are picked
+     * out of nthreads * k candidates.
+     */
+    _psort_task_t *tasks = umalloc(nthreads * sizeof(tasks[0]));
+    for (size_t i = 0; i < nthreads; i++)
+    {
+        size_t l = nmemb / nthreads * i + MIN(i, nmemb % nthreads);
+        size_t r = nmemb / nthreads * (i + 1) + MIN(i + 1, nmemb % nthreads);
+        tasks[i].src = base + l;
+        tasks[i].lsize = r - l;
+        tasks[i].k = k;
+        tasks[i].cmp = cmp;
+    }
+    _psort_run(_ptopk_worker, tasks, nthreads);
+
+    for (size_t i = 1; i < nthreads; i++)
+    {
+        for (size_t j = 0; j < k; j++)
+        {
+            ugeneric_swap(base + i * k + j, tasks[i].src + j);
+        }
+    }
+    top_k(base, nthreads * k, k, cmp);
+
+    ufree(tasks);
+}
@@ -0,0 +1,365 @@
+#include "sorted_index.h"
+
+#include "asserts.h"
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p) ((void)(p))
+#endif
+
+// Descendants four levels below node k start at k << 4. They may be past the
+// end, prefetch doesn't fault, the address is computed without pointer
+// arithmetic out of the array.
+#define PREFETCH_DEPTH 4
+#define PREFETCH_NODE(a, k) \
+    PREFETCH((const void *)((uintptr_t)(a) + ((k) << PREFETCH_DEPTH) * sizeof((a)[0])))
+#define INT_KEY_BIAS ((uint64_t)1 << 63)
+
+/*
+ * Node k has children 2k and 2k + 1, the root is 1. A search goes down to a
+ * leaf taking the right child whenever the node is before the key, the answer
+ * is the last node where it went left: the one reached by dropping the
+ * trailing ones and one more bit of the final k.
+ */
+struct usorted_index_opaq {
+    size_t size;
+    ugeneric_type_e type; // G_INT_T or G_SIZE_T with keys, cells otherwise
+    uint64_t *keys;       // [1:size], order preserving image of numbers
+    ugeneric_t *cells;    // [1:size]
+    size_t *positions;    // [1:size], source position of each node
+    void_cmp_t cmp;
+};
+
+// Only for keys of the type of the index.
+static inline uint64_t _key(const usorted_index_t *si, ugeneric_t e)
+{
+    return (si->type == G_INT_T) ? (uint64_t)G_AS_INT(e) ^ INT_KEY_BIAS
+                                 : (uint64_t)G_AS_SIZE(e);
+}
+
+static inline ugeneric_t _value(const usorted_index_t *si, uint64_t key)
+{
+    return (si->type == G_INT_T) ? G_INT((long)(key ^ INT_KEY_BIAS))
+                                 : G_SIZE(key);
+}
+
+static inline bool _is_key(const usorted_index_t *si, ugeneric_t e)
+{
+    return si->keys && (e.t.type == si->type);
+}
+
+static inline size_t _answer(size_t k)
+{
+#if defined(__GNUC__)
+    return k >> (__builtin_ctzll(~(unsigned long long)k) + 1);
+#else
+    while (k & 1)
+    {
+        k >>= 1;
+    }
+    return k >> 1;
+#endif
+}
+
+static size_t _descend_keys(const usorted_index_t *si, uint64_t x, bool upper)
+{
+    size_t k = 1;
+    while (k <= si->size)
+    {
+        PREFETCH_NODE(si->keys, k);
+        uint64_t key = si->keys[k];
+        k = 2 * k + (upper ? (key <= x) : (key < x));
+    }
+
+    return _answer(k);
+}
+
+// Keys of other types are compared the way ugeneric_compare() does it.
+static size_t _descend_mixed(const usorted_index_t *si, ugeneric_t e,
+                             bool upper)
+{
+    size_t k = 1;
+    while (k <= si->size)
+    {
+        PREFETCH_NODE(si->keys, k);
+        int diff = ugeneric_compare(_value(si, si->keys[k]), e);
+        k = 2 * k + (upper ? (diff <= 0) : (diff < 0));
+    }
+
+    return _answer(k);
+}
+
+static size_t _descend_cells(const usorted_index_t *si, ugeneric_t e,
+                             bool upper)
+{
+    size_t k = 1;
+    while (k <= si->size)
+    {
+        PREFETCH_NODE(si->cells, k);
+        int diff = ugeneric_compare_v(si->cells[k], e, si->cmp);
+        k = 2 * k + (upper ? (diff <= 0) : (diff < 0));
+    }
+
+    return _answer(k);
+}
+
+// Node of the lower (upper) bound of e, 0 if all the items are before it.
+static size_t _descend(const usorted_index_t *si, ugeneric_t e, bool upper)
+{
+    if (_is_key(si, e))
+    {
+        return _descend_keys(si, _key(si, e), upper);
+    }
+
+    return si->keys ? _descend_mixed(si, e, upper)
+                    : _descend_cells(si, e, upper);
+}
+
+static inline size_t _position(const usorted_index_t *si, size_t node)
+{
+    return node ? si->positions[node] : si->size;
+}
+
+// In-order walk of the tree hands out sorted positions.
+static size_t _layout(usorted_index_t *si, size_t k, size_t i)
+{
+    if (k <= si->size)
+    {
+        i = _layout(si, 2 * k, i);
+        si->positions[k] = i++;
+        i = _layout(si, 2 * k + 1, i);
+    }
+
+    return i;
+}
+
+static usorted_index_t *_create(size_t size, ugeneric_type_e type)
+{
+    usorted_index_t *si = uzalloc(sizeof(*si));
+    si->size = size;
+    si->type = type;
+    si->positions = umalloc((size + 1) * sizeof(si->positions[0]));
+    if ((type == G_INT_T) || (type == G_SIZE_T))
+    {
+        si->keys = umalloc((size + 1) * sizeof(si->keys[0]));
+    }
+    else
+    {
+        si->cells = umalloc((size + 1) * sizeof(si->cells[0]));
+    }
+    _layout(si, 1, 0);
+
+    return si;
+}
+
+usorted_index_t *usorted_index_create(const uvector_t *v)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(uvector_is_sorted(v));
+
+    size_t size = uvector_get_size(v);
+    const ugeneric_t *cells = uvector_get_cells(v);
+    ugeneric_type_e type = size ? cells[0].t.type : G_NULL_T;
+    bool numeric = (type == G_INT_T) || (type == G_SIZE_T);
+    for (size_t i = 1; numeric && (i < size); i++)
+    {
+        numeric = (cells[i].t.type == type);
+    }
+
+    usorted_index_t *si = _create(size, numeric ? type : G_NULL_T);
+    si->cmp = uvector_get_void_comparator((uvector_t *)v);
+    for (size_t k = 1; k <= size; k++)
+    {
+        if (numeric)
+        {
+            si->keys[k] = _key(si, cells[si->positions[k]]);
+        }
+        else
+        {
+            si->cells[k] = cells[si->positions[k]];
+        }
+    }
+
+    return si;
+}
+
+usorted_index_t *usorted_index_create_from_i64(const uvector_i64_t *v)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(uvector_i64_is_sorted(v));
+
+    size_t size = uvector_i64_get_size(v);
+    const int64_t *cells = uvector_i64_get_cells(v);
+    usorted_index_t *si = _create(size, G_INT_T);
+    for (size_t k = 1; k <= size; k++)
+    {
+        si->keys[k] = (uint64_t)cells[si->positions[k]] ^ INT_KEY_BIAS;
+    }
+
+    return si;
+}
+
+usorted_index_t *usorted_index_create_from_size(const uvector_size_t *v)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(uvector_size_is_sorted(v));
+
+    size_t size = uvector_size_get_size(v);
+    const size_t *cells = uvector_size_get_cells(v);
+    usorted_index_t *si = _create(size, G_SIZE_T);
+    for (size_t k = 1; k <= size; k++)
+    {
+        si->keys[k] = cells[si->positions[k]];
+    }
+
+    return si;
+}
+
+void usorted_index_destroy(usorted_index_t *si)
+{
+    if (si)
+    {
+        ufree(si->keys);
+        ufree(si->cells);
+        ufree(si->positions);
+        ufree(si);
+    }
+}
+
+size_t usorted_index_get_size(const usorted_index_t *si)
+{
+    UASSERT_INPUT(si);
+    return si->size;
+}
+
+size_t usorted_index_lower_bound(const usorted_index_t *si, ugeneric_t e)
+{
+    UASSERT_INPUT(si);
+    return _position(si, _descend(si, e, false));
+}
+
+size_t usorted_index_upper_bound(const usorted_index_t *si, ugeneric_t e)
+{
+    UASSERT_INPUT(si);
+    return _position(si, _descend(si, e, true));
+}
+
+size_t usorted_index_find(const usorted_index_t *si, ugeneric_t e)
+{
+    UASSERT_INPUT(si);
+
+    size_t k = _descend(si, e, false);
+    if (k)
+    {
+        bool equal;
+        if (_is_key(si, e))
+        {
+            equal = (si->keys[k] == _key(si, e));
+        }
+        else if (si->keys)
+        {
+            equal = !ugeneric_compare(_value(si, si->keys[k]), e);
+        }
+        else
+        {
+            equal = !ugeneric_compare_v(si->cells[k], e, si->cmp);
+        }
+        if (equal)
+        {
+            return si->positions[k];
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+bool usorted_index_contains(const usorted_index_t *si, ugeneric_t e)
+{
+    return usorted_index_find(si, e) != SIZE_MAX;
+}
+
+size_t usorted_index_get_range(const usorted_index_t *si, ugeneric_t lo,
+                               ugeneric_t hi, size_t *first)
+{
+    UASSERT_INPUT(si);
+    UASSERT_INPUT(first);
+
+    *first = usorted_index_lower_bound(si, lo);
+    size_t last = usorted_index_lower_bound(si, hi);
+
+    return (last > *first) ? last - *first : 0;
+}
+
+void usorted_index_lower_bound_batch(const usorted_index_t *si,
+                                     const ugeneric_t *keys, size_t n,
+                                     size_t *positions)
+{
+    UASSERT_INPUT(si);
+    UASSERT_INPUT(!n || (keys && positions));
+
+    if (!si->keys)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            positions[i] = usorted_index_lower_bound(si, keys[i]);
+        }
+        return;
+    }
+
+    // All the searches of a batch take the same number of steps give or
+    // take one, so they go down level by level together.
+    for (size_t i = 0; i < n; i += USORTED_INDEX_BATCH)
+    {
+        size_t count = MIN(n - i, (size_t)USORTED_INDEX_BATCH);
+        uint64_t x[USORTED_INDEX_BATCH];
+        size_t k[USORTED_INDEX_BATCH];
+        for (size_t j = 0; j < count; j++)
+        {
+            // Keys of other types are done on their own, out of the batch.
+            bool own = _is_key(si, keys[i + j]);
+            x[j] = own ? _key(si, keys[i + j]) : 0;
+            k[j] = own ? 1 : si->size + 1;
+            if (!own)
+            {
+                positions[i + j] = usorted_index_lower_bound(si, keys[i + j]);
+            }
+        }
+
+        for (bool active = si->size > 0; active;)
+        {
+            active = false;
+            for (size_t j = 0; j < count; j++)
+            {
+                if (k[j] <= si->size)
+                {
+                    PREFETCH_NODE(si->keys, k[j]);
+                    k[j] = 2 * k[j] + (si->keys[k[j]] < x[j]);
+                    active = true;
+                }
+            }
+        }
+
+        for (size_t j = 0; j < count; j++)
+        {
+            if (_is_key(si, keys[i + j]))
+            {
+                positions[i + j] = _position(si, _answer(k[j]));
+            }
+        }
+    }
+}
+
+umem_usage_t usorted_index_get_memory_usage(const usorted_index_t *si)
+{
+    UASSERT_INPUT(si);
+
+    umem_usage_t u = {0};
+    u.header = sizeof(*si);
+    u.buckets = (si->size + 1) * sizeof(si->positions[0]);
+    u.buckets += (si->size + 1) * (si->keys ? sizeof(si->keys[0])
+                                            : sizeof(si->cells[0]));
+
+    return u;
+}
@@ -11,8 +11,14 @@ struct ustack_opaq {
 
 ustack_t *ustack_create(void)
 {
-    ustack_t *s = umalloc(sizeof(*s));
-    s->data = uvector_create();
+    return ustack_create_ext(NULL);
+}
+
+ustack_t *ustack_create_ext(const uallocator_t *allocator)
+{
+    allocator = allocator ? allocator : uallocator_get_default();
+    ustack_t *s = uallocator_alloc(allocator, sizeof(*s));
+    s->data = uvector_create_ext(allocator);
     uvector_reserve_capacity(s->data, STACK_INITIAL_CAPACITY);
     return s;
 }
@@ -21,8 +27,9 @@ void ustack_destroy(ustack_t *s)
 {
     if (s)
     {
+        const uallocator_t *allocator = uvector_get_allocator(s->data);
         uvector_destroy(s->data);
-        ufree(s);
+        uallocator_free(allocator, s, sizeof(*s));
     }
 }
 
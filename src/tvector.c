@@ -0,0 +1,548 @@
+#include "tvector.h"
+
+#include "asserts.h"
+#include "mem.h"
+
+#define TWO_POW_63 9223372036854775808.0
+#define TWO_POW_64 18446744073709551616.0
+
+// Numbers are converted only when they are kept exactly, NaN never is.
+static bool _to_i64(ugeneric_t g, int64_t *e)
+{
+    switch (g.t.type)
+    {
+        case G_INT_T:
+            *e = G_AS_INT(g);
+            return true;
+        case G_SIZE_T:
+            *e = (int64_t)G_AS_SIZE(g);
+            return G_AS_SIZE(g) <= INT64_MAX;
+        case G_REAL_T:
+            if (!((G_AS_REAL(g) >= -TWO_POW_63) && (G_AS_REAL(g) < TWO_POW_63)))
+            {
+                return false;
+            }
+            *e = (int64_t)G_AS_REAL(g);
+            return (double)*e == G_AS_REAL(g);
+        default:
+            return false;
+    }
+}
+
+static bool _to_f64(ugeneric_t g, double *e)
+{
+    switch (g.t.type)
+    {
+        case G_INT_T:
+            *e = (double)G_AS_INT(g);
+            return (*e < TWO_POW_63) && ((long)*e == G_AS_INT(g));
+        case G_SIZE_T:
+            *e = (double)G_AS_SIZE(g);
+            return (*e < TWO_POW_64) && ((size_t)*e == G_AS_SIZE(g));
+        case G_REAL_T:
+            *e = G_AS_REAL(g);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool _to_size(ugeneric_t g, size_t *e)
+{
+    switch (g.t.type)
+    {
+        case G_INT_T:
+            *e = (size_t)G_AS_INT(g);
+            return G_AS_INT(g) >= 0;
+        case G_SIZE_T:
+            *e = G_AS_SIZE(g);
+            return true;
+        case G_REAL_T:
+            if (!((G_AS_REAL(g) >= 0) && (G_AS_REAL(g) < TWO_POW_64)))
+            {
+                return false;
+            }
+            *e = (size_t)G_AS_REAL(g);
+            return (double)*e == G_AS_REAL(g);
+        default:
+            return false;
+    }
+}
+
+// Reads an element of a raw array laid out as uvector_create_from_array()
+// expects: signed (G_INT_T), unsigned (G_SIZE_T) or floating (G_REAL_T).
+static bool _from_raw(const void *p, size_t size, ugeneric_type_e type,
+                      ugeneric_t *g)
+{
+    union {
+        int8_t i8; int16_t i16; int32_t i32; int64_t i64;
+        uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64;
+        float f; double d;
+    } raw;
+
+    if (!size || (size > sizeof(raw)))
+    {
+        return false;
+    }
+    memcpy(&raw, p, size);
+
+    switch (type)
+    {
+        case G_INT_T:
+            switch (size)
+            {
+                case 1: *g = G_INT(raw.i8); return true;
+                case 2: *g = G_INT(raw.i16); return true;
+                case 4: *g = G_INT(raw.i32); return true;
+                case 8: *g = G_INT(raw.i64); return true;
+            }
+            break;
+        case G_SIZE_T:
+            switch (size)
+            {
+                case 1: *g = G_SIZE(raw.u8); return true;
+                case 2: *g = G_SIZE(raw.u16); return true;
+                case 4: *g = G_SIZE(raw.u32); return true;
+                case 8: *g = G_SIZE(raw.u64); return true;
+            }
+            break;
+        case G_REAL_T:
+            if (size == sizeof(float))
+            {
+                *g = G_REAL(raw.f);
+                return true;
+            }
+            if (size == sizeof(double))
+            {
+                *g = G_REAL(raw.d);
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return false;
+}
+
+#define DEFINE_TYPED_VECTOR(_name_, _type_, _gctor_, _gto_)                    \
+struct _name_##_opaq {                                                         \
+    const uallocator_t *allocator;                                             \
+    _type_ *cells;                                                             \
+    size_t size;                                                               \
+    size_t capacity;                                                           \
+};                                                                             \
+                                                                               \
+static int _name_##_cmp(const void *a, const void *b)                          \
+{                                                                              \
+    _type_ l = *(const _type_ *)a;                                             \
+    _type_ r = *(const _type_ *)b;                                             \
+    return (l > r) - (l < r);                                                  \
+}                                                                              \
+                                                                               \
+_name_##_t *_name_##_create_ext(const uallocator_t *allocator)                 \
+{                                                                              \
+    allocator = allocator ? allocator : uallocator_get_default();              \
+    _name_##_t *v = uallocator_alloc(allocator, sizeof(*v));                   \
+    v->allocator = allocator;                                                  \
+    v->cells = NULL;                                                           \
+    v->size = 0;                                                               \
+    v->capacity = 0;                                                           \
+                                                                               \
+    return v;                                                                  \
+}                                                                              \
+                                                                               \
+_name_##_t *_name_##_create(void)                                              \
+{                                                                              \
+    return _name_##_create_ext(NULL);                                          \
+}                                                                              \
+                                                                               \
+_name_##_t *_name_##_create_with_size(size_t size, _type_ value)               \
+{                                                                              \
+    _name_##_t *v = _name_##_create_ext(NULL);                                 \
+    _name_##_resize(v, size, value);                                           \
+                                                                               \
+    return v;                                                                  \
+}                                                                              \
+                                                                               \
+_name_##_t *_name_##_create_from_array(const _type_ *array, size_t array_len)  \
+{                                                                              \
+    UASSERT_INPUT(array || !array_len);                                        \
+                                                                               \
+    _name_##_t *v = _name_##_create_ext(NULL);                                 \
+    if (array_len)                                                             \
+    {                                                                          \
+        _name_##_reserve_capacity(v, array_len);                               \
+        memcpy(v->cells, array, array_len * sizeof(v->cells[0]));              \
+        v->size = array_len;                                                   \
+    }                                                                          \
+                                                                               \
+    return v;                                                                  \
+}                                                                              \
+                                                                               \
+_name_##_t *_name_##_create_from_raw_array(const void *array, size_t array_len,\
+                                           size_t array_element_size,          \
+                                           ugeneric_type_e array_element_type) \
+{                                                                              \
+    UASSERT_INPUT(array || !array_len);                                        \
+                                                                               \
+    _name_##_t *v = _name_##_create_ext(NULL);                                 \
+    _name_##_reserve_capacity(v, array_len);                                   \
+    const char *p = array;                                                     \
+    for (size_t i = 0; i < array_len; i++, p += array_element_size)            \
+    {                                                                          \
+        ugeneric_t g;                                                          \
+        if (!_from_raw(p, array_element_size, array_element_type, &g) ||       \
+            !_gto_(g, &v->cells[i]))                                           \
+        {                                                                      \
+            _name_##_destroy(v);                                               \
+            return NULL;                                                       \
+        }                                                                      \
+    }                                                                          \
+    v->size = array_len;                                                       \
+                                                                               \
+    return v;                                                                  \
+}                                                                              \
+                                                                               \
+void _name_##_clear(_name_##_t *v)                                             \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    v->size = 0;                                                               \
+}                                                                              \
+                                                                               \
+void _name_##_destroy(_name_##_t *v)                                           \
+{                                                                              \
+    if (v)                                                                     \
+    {                                                                          \
+        uallocator_free(v->allocator, v->cells,                                \
+                        v->capacity * sizeof(v->cells[0]));                    \
+        uallocator_free(v->allocator, v, sizeof(*v));                          \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+_name_##_t *_name_##_copy(const _name_##_t *v)                                 \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    _name_##_t *copy = _name_##_create_ext(v->allocator);                      \
+    if (v->size)                                                               \
+    {                                                                          \
+        _name_##_reserve_capacity(copy, v->size);                              \
+        memcpy(copy->cells, v->cells, v->size * sizeof(v->cells[0]));         \
+        copy->size = v->size;                                                  \
+    }                                                                          \
+                                                                               \
+    return copy;                                                               \
+}                                                                              \
+                                                                               \
+int _name_##_compare(const _name_##_t *v1, const _name_##_t *v2)               \
+{                                                                              \
+    UASSERT_INPUT(v1);                                                         \
+    UASSERT_INPUT(v2);                                                         \
+                                                                               \
+    size_t len = MIN(v1->size, v2->size);                                      \
+    for (size_t i = 0; i < len; i++)                                           \
+    {                                                                          \
+        int diff = _name_##_cmp(&v1->cells[i], &v2->cells[i]);                 \
+        if (diff)                                                              \
+        {                                                                      \
+            return diff;                                                       \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    return (v1->size > v2->size) - (v1->size < v2->size);                      \
+}                                                                              \
+                                                                               \
+void _name_##_reserve_capacity(_name_##_t *v, size_t new_capacity)             \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    if (v->capacity < new_capacity)                                            \
+    {                                                                          \
+        v->cells = uallocator_realloc(v->allocator, v->cells,                  \
+                                      v->capacity * sizeof(v->cells[0]),       \
+                                      new_capacity * sizeof(v->cells[0]));     \
+        v->capacity = new_capacity;                                            \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+void _name_##_shrink_to_size(_name_##_t *v)                                    \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    if (v->size && (v->capacity > v->size))                                    \
+    {                                                                          \
+        v->cells = uallocator_realloc(v->allocator, v->cells,                  \
+                                      v->capacity * sizeof(v->cells[0]),       \
+                                      v->size * sizeof(v->cells[0]));          \
+        v->capacity = v->size;                                                 \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+void _name_##_append(_name_##_t *v, _type_ e)                                  \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    if (v->capacity == v->size)                                                \
+    {                                                                          \
+        _name_##_reserve_capacity(v, MAX(SCALE_FACTOR * v->size,               \
+                                         VECTOR_INITIAL_CAPACITY));            \
+    }                                                                          \
+    v->cells[v->size++] = e;                                                   \
+}                                                                              \
+                                                                               \
+void _name_##_insert_at(_name_##_t *v, size_t i, _type_ e)                     \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(i <= v->size);                                               \
+                                                                               \
+    _name_##_append(v, e);                                                     \
+    memmove(v->cells + i + 1, v->cells + i,                                    \
+            (v->size - i - 1) * sizeof(v->cells[0]));                          \
+    v->cells[i] = e;                                                           \
+}                                                                              \
+                                                                               \
+void _name_##_remove_at(_name_##_t *v, size_t i)                               \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(i < v->size);                                                \
+                                                                               \
+    memmove(v->cells + i, v->cells + i + 1,                                    \
+            (v->size - i - 1) * sizeof(v->cells[0]));                          \
+    v->size--;                                                                 \
+}                                                                              \
+                                                                               \
+_type_ _name_##_pop_back(_name_##_t *v)                                        \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(v->size);                                                    \
+    return v->cells[--v->size];                                                \
+}                                                                              \
+                                                                               \
+_type_ _name_##_get_at(const _name_##_t *v, size_t i)                          \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(i < v->size);                                                \
+    return v->cells[i];                                                        \
+}                                                                              \
+                                                                               \
+_type_ _name_##_get_back(const _name_##_t *v)                                  \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(v->size);                                                    \
+    return v->cells[v->size - 1];                                              \
+}                                                                              \
+                                                                               \
+void _name_##_set_at(_name_##_t *v, size_t i, _type_ e)                        \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(i < v->size);                                                \
+    v->cells[i] = e;                                                           \
+}                                                                              \
+                                                                               \
+_type_ *_name_##_get_cells(const _name_##_t *v)                                \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    return v->cells;                                                           \
+}                                                                              \
+                                                                               \
+_type_ *_name_##_find(_name_##_t *v, _type_ e)                                 \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    for (size_t i = 0; i < v->size; i++)                                       \
+    {                                                                          \
+        if (v->cells[i] == e)                                                  \
+        {                                                                      \
+            return &v->cells[i];                                               \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    return NULL;                                                               \
+}                                                                              \
+                                                                               \
+bool _name_##_contains(const _name_##_t *v, _type_ e)                          \
+{                                                                              \
+    return _name_##_find((_name_##_t *)v, e) != NULL;                          \
+}                                                                              \
+                                                                               \
+bool _name_##_is_empty(const _name_##_t *v)                                    \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    return v->size == 0;                                                       \
+}                                                                              \
+                                                                               \
+size_t _name_##_get_size(const _name_##_t *v)                                  \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    return v->size;                                                            \
+}                                                                              \
+                                                                               \
+void _name_##_resize(_name_##_t *v, size_t new_size, _type_ value)             \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    _name_##_reserve_capacity(v, new_size);                                    \
+    for (size_t i = v->size; i < new_size; i++)                                \
+    {                                                                          \
+        v->cells[i] = value;                                                   \
+    }                                                                          \
+    v->size = new_size;                                                        \
+}                                                                              \
+                                                                               \
+size_t _name_##_get_capacity(const _name_##_t *v)                              \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    return v->capacity;                                                        \
+}                                                                              \
+                                                                               \
+const uallocator_t *_name_##_get_allocator(const _name_##_t *v)                \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    return v->allocator;                                                       \
+}                                                                              \
+                                                                               \
+void _name_##_reverse(_name_##_t *v)                                           \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    for (size_t l = 0, r = v->size; l + 1 < r; l++, r--)                       \
+    {                                                                          \
+        _type_ tmp = v->cells[l];                                              \
+        v->cells[l] = v->cells[r - 1];                                         \
+        v->cells[r - 1] = tmp;                                                 \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+void _name_##_sort(_name_##_t *v)                                              \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    if (v->size)                                                               \
+    {                                                                          \
+        qsort(v->cells, v->size, sizeof(v->cells[0]), _name_##_cmp);           \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+bool _name_##_is_sorted(const _name_##_t *v)                                   \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    for (size_t i = 1; i < v->size; i++)                                       \
+    {                                                                          \
+        if (v->cells[i - 1] > v->cells[i])                                     \
+        {                                                                      \
+            return false;                                                      \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+size_t _name_##_bsearch(const _name_##_t *v, _type_ e)                         \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    size_t l = 0;                                                              \
+    size_t r = v->size;                                                        \
+    while (l < r)                                                              \
+    {                                                                          \
+        size_t m = l + (r - l) / 2;                                            \
+        if (v->cells[m] < e)                                                   \
+        {                                                                      \
+            l = m + 1;                                                         \
+        }                                                                      \
+        else                                                                   \
+        {                                                                      \
+            r = m;                                                             \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    return ((l < v->size) && (v->cells[l] == e)) ? l : SIZE_MAX;               \
+}                                                                              \
+                                                                               \
+uvector_t *_name_##_to_uvector(const _name_##_t *v)                            \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    uvector_t *g = uvector_create_ext(v->allocator);                           \
+    uvector_reserve_capacity(g, v->size);                                      \
+    for (size_t i = 0; i < v->size; i++)                                       \
+    {                                                                          \
+        uvector_append(g, _gctor_(v->cells[i]));                               \
+    }                                                                          \
+                                                                               \
+    return g;                                                                  \
+}                                                                              \
+                                                                               \
+_name_##_t *_name_##_from_uvector(const uvector_t *v)                          \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    size_t size = uvector_get_size(v);                                         \
+    const ugeneric_t *cells = uvector_get_cells(v);                            \
+    _name_##_t *t = _name_##_create_ext(uvector_get_allocator((uvector_t *)v));\
+    _name_##_reserve_capacity(t, size);                                        \
+    for (size_t i = 0; i < size; i++)                                          \
+    {                                                                          \
+        if (!_gto_(cells[i], &t->cells[i]))                                    \
+        {                                                                      \
+            _name_##_destroy(t);                                               \
+            return NULL;                                                       \
+        }                                                                      \
+    }                                                                          \
+    t->size = size;                                                            \
+                                                                               \
+    return t;                                                                  \
+}                                                                              \
+                                                                               \
+void _name_##_serialize(const _name_##_t *v, ubuffer_t *buf)                   \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(buf);                                                        \
+                                                                               \
+    ubuffer_append_byte(buf, '[');                                             \
+    for (size_t i = 0; i < v->size; i++)                                       \
+    {                                                                          \
+        ugeneric_serialize(_gctor_(v->cells[i]), buf);                         \
+        if (i < v->size - 1)                                                   \
+        {                                                                      \
+            ubuffer_append_data(buf, ", ", 2);                                 \
+        }                                                                      \
+    }                                                                          \
+    ubuffer_append_byte(buf, ']');                                             \
+}                                                                              \
+                                                                               \
+char *_name_##_as_str(const _name_##_t *v)                                     \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    ubuffer_t buf = {0};                                                       \
+    _name_##_serialize(v, &buf);                                               \
+    ubuffer_null_terminate(&buf);                                              \
+                                                                               \
+    return buf.data;                                                           \
+}                                                                              \
+                                                                               \
+int _name_##_fprint(const _name_##_t *v, FILE *out)                            \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+    UASSERT_INPUT(out);                                                        \
+                                                                               \
+    return ubuffer_fprint_serialized((ubuffer_s8r_t)_name_##_serialize, v, out);\
+}                                                                              \
+                                                                               \
+umem_usage_t _name_##_get_memory_usage(const _name_##_t *v)                    \
+{                                                                              \
+    UASSERT_INPUT(v);                                                          \
+                                                                               \
+    umem_usage_t u = {0};                                                      \
+    u.header = sizeof(*v);                                                     \
+    u.buckets = v->capacity * sizeof(v->cells[0]);                             \
+                                                                               \
+    return u;                                                                  \
+}
+
+DEFINE_TYPED_VECTOR(uvector_i64, int64_t, G_INT, _to_i64)
+DEFINE_TYPED_VECTOR(uvector_f64, double, G_REAL, _to_f64)
+DEFINE_TYPED_VECTOR(uvector_size, size_t, G_SIZE, _to_size)
@@ -1,45 +1,140 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "vector.h"
 
 #include "asserts.h"
 #include "mem.h"
 #include "sort.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define VECTOR_PARALLEL_COUNT_CUTOFF (256 * 1024) // min cells per thread
+#define UNIQUE_GOLDEN_RATIO ((size_t)0x9E3779B97F4A7C15ULL)
 
 /* [0][1][2][...][size - 1][.][.][...][.][.][capacity - 1] */
 
 struct uvector_opaq {
     uvoid_handlers_t void_handlers;
     bool is_data_owner;
+    const uallocator_t *allocator;
     ugeneric_t *cells;
     size_t size;
     size_t capacity;
     ugeneric_sorter_t sorter;
+    atomic_size_t *refs; // vectors sharing cells, NULL if they aren't shared
 };
 
-static ugeneric_sorter_t _default_vector_sorter = hybrid_sort;
+static ugeneric_sorter_t _default_vector_sorter = radix_sort;
 
-static uvector_t *_allocate_vector(void)
+static uvector_t *_allocate_vector(const uallocator_t *allocator)
 {
-    uvector_t *v = umalloc(sizeof(*v));
+    allocator = allocator ? allocator : uallocator_get_default();
+    uvector_t *v = uallocator_alloc(allocator, sizeof(*v));
     memset(&v->void_handlers, 0, sizeof(v->void_handlers));
+    v->allocator = allocator;
     v->size = 0;
     v->capacity = 0;
     v->cells = NULL;
     v->is_data_owner = true;
     v->sorter = _default_vector_sorter;
+    v->refs = NULL;
 
     return v;
 }
 
+/*
+ * Copy-on-write: copies made by uvector_cow_copy() point to the same cells
+ * and count references to them. Whatever is about to change cells first
+ * gets the vector its own ones, the last vector to let go of shared cells
+ * disposes of them.
+ */
+static bool _release_cells(uvector_t *v)
+{
+    bool last = true;
+    if (v->refs)
+    {
+        last = (atomic_fetch_sub(v->refs, 1) == 1);
+        if (last)
+        {
+            uallocator_free(v->allocator, v->refs, sizeof(*v->refs));
+        }
+        v->refs = NULL;
+    }
+
+    return last;
+}
+
+static void _drop_cells(uvector_t *v)
+{
+    if (_release_cells(v))
+    {
+        if (v->is_data_owner)
+        {
+            for (size_t i = 0; i < v->size; i++)
+            {
+                ugeneric_destroy_v(v->cells[i], v->void_handlers.dtr);
+            }
+        }
+        uallocator_free(v->allocator, v->cells,
+                        v->capacity * sizeof(v->cells[0]));
+    }
+    v->cells = NULL;
+    v->size = 0;
+    v->capacity = 0;
+}
+
+static void _unshare(uvector_t *v)
+{
+    if (!v->refs)
+    {
+        return;
+    }
+    if (atomic_load(v->refs) == 1)
+    {
+        _release_cells(v);
+        return;
+    }
+
+    // Items of an owner are shared as well, so they get copied too.
+    ugeneric_t *cells = NULL;
+    if (v->capacity)
+    {
+        cells = uallocator_alloc(v->allocator, v->capacity * sizeof(cells[0]));
+    }
+    for (size_t i = 0; i < v->size; i++)
+    {
+        cells[i] = v->is_data_owner
+                 ? ugeneric_copy_v(v->cells[i], v->void_handlers.cpy)
+                 : v->cells[i];
+    }
+
+    size_t size = v->size;
+    size_t capacity = v->capacity;
+    _drop_cells(v);
+    v->cells = cells;
+    v->size = size;
+    v->capacity = capacity;
+}
+
 static uvector_t *_vcpy(const uvector_t *v, bool deep)
 {
     UASSERT_INPUT(v);
 
-    uvector_t *copy = _allocate_vector();
+    const uallocator_t *allocator = uallocator_get_copy_allocator(v->allocator);
+    uvector_t *copy = _allocate_vector(allocator);
     *copy = *v;
+    copy->allocator = allocator;
+    copy->cells = NULL;
+    copy->capacity = v->size;
+    copy->refs = NULL;
 
     if (v->size)
     {
-        copy->cells = umalloc(v->size * sizeof(copy->cells[0]));
+        copy->cells = uallocator_alloc(allocator,
+                                       v->size * sizeof(copy->cells[0]));
     }
 
     copy->is_data_owner = deep;
@@ -87,7 +182,7 @@ int uvector_compare(const uvector_t *v1, const uvector_t *v2)
 
 uvector_t *uvector_create_with_size(size_t size, ugeneric_t value)
 {
-    uvector_t *v = _allocate_vector();
+    uvector_t *v = _allocate_vector(NULL);
     if (size)
     {
         uvector_reserve_capacity(v, size);
@@ -103,7 +198,17 @@ uvector_t *uvector_create_with_size(size_t size, ugeneric_t value)
 
 uvector_t *uvector_create(void)
 {
-    return _allocate_vector();
+    return _allocate_vector(NULL);
+}
+
+uvector_t *uvector_create_ext(const uallocator_t *allocator)
+{
+    return _allocate_vector(allocator);
+}
+
+uvector_t *uvector_create_with_arena(uarena_t *arena)
+{
+    return _allocate_vector(arena ? uarena_get_allocator(arena) : NULL);
 }
 
 uvector_t *uvector_create_from_array(void *array, size_t array_len,
@@ -113,7 +218,7 @@ uvector_t *uvector_create_from_array(void *array, size_t array_len,
     UASSERT_INPUT(array);
 
     size_t i = 0;
-    uvector_t *v = _allocate_vector();
+    uvector_t *v = _allocate_vector(NULL);
     uvector_reserve_capacity(v, array_len);
     char *p = array;
 
@@ -135,6 +240,12 @@ void uvector_clear(uvector_t *v)
 {
     UASSERT_INPUT(v);
 
+    if (v->refs)
+    {
+        _drop_cells(v);
+        return;
+    }
+
     if (v->is_data_owner)
     {
         for (size_t i = 0; i < v->size; i++)
@@ -150,8 +261,9 @@ void uvector_destroy(uvector_t *v)
     if (v)
     {
         uvector_clear(v);
-        ufree(v->cells);
-        ufree(v);
+        uallocator_free(v->allocator, v->cells,
+                        v->capacity * sizeof(v->cells[0]));
+        uallocator_free(v->allocator, v, sizeof(*v));
     }
 }
 
@@ -172,6 +284,7 @@ void uvector_set_at(uvector_t *v, size_t i, ugeneric_t e)
 {
     UASSERT_INPUT(v);
     UASSERT_INPUT(i < v->size);
+    _unshare(v);
 
     if (v->is_data_owner)
     {
@@ -191,6 +304,7 @@ void uvector_swap(uvector_t *v, size_t l, size_t r)
     UASSERT_INPUT(v);
     UASSERT_INPUT(l < v->size);
     UASSERT_INPUT(r < v->size);
+    _unshare(v);
 
     ugeneric_swap(&v->cells[l], &v->cells[r]);
 }
@@ -199,6 +313,7 @@ void uvector_resize(uvector_t *v, size_t new_size, ugeneric_t value)
 {
     UASSERT_INPUT(v);
 
+    _unshare(v);
     uvector_reserve_capacity(v, new_size);
     for (size_t i = v->size; i < new_size; i++)
     {
@@ -217,10 +332,13 @@ void uvector_resize(uvector_t *v, size_t new_size, ugeneric_t value)
 void uvector_shrink_to_size(uvector_t *v)
 {
     UASSERT_INPUT(v);
+    _unshare(v);
 
     if (v->capacity && v->size && (v->capacity > v->size))
     {
-        void *p = urealloc(v->cells, v->size * sizeof(v->cells[0]));
+        void *p = uallocator_realloc(v->allocator, v->cells,
+                                     v->capacity * sizeof(v->cells[0]),
+                                     v->size * sizeof(v->cells[0]));
         v->cells = p;
         v->capacity = v->size;
     }
@@ -229,10 +347,13 @@ void uvector_shrink_to_size(uvector_t *v)
 void uvector_reserve_capacity(uvector_t *v, size_t new_capacity)
 {
     UASSERT_INPUT(v);
+    _unshare(v);
 
     if (v->capacity < new_capacity)
     {
-        void *p = urealloc(v->cells, new_capacity * sizeof(v->cells[0]));
+        void *p = uallocator_realloc(v->allocator, v->cells,
+                                     v->capacity * sizeof(v->cells[0]),
+                                     new_capacity * sizeof(v->cells[0]));
         v->cells = p;
         v->capacity = new_capacity;
     }
@@ -261,6 +382,7 @@ void uvector_insert_at(uvector_t *v, size_t i, ugeneric_t e)
     UASSERT_INPUT(v);
     UASSERT_INPUT(i < v->size);
 
+    _unshare(v);
     uvector_reserve_capacity(v, v->size + 1);
     memmove(v->cells + i + 1, v->cells + i, (v->size - i) * sizeof(v->cells[0]));
     v->cells[i] = e;
@@ -271,6 +393,7 @@ void uvector_remove_at(uvector_t *v, size_t i)
 {
     UASSERT_INPUT(v);
     UASSERT_INPUT(i < v->size);
+    _unshare(v);
 
     if (v->is_data_owner)
     {
@@ -288,6 +411,7 @@ void uvector_remove_back(uvector_t *v)
 void uvector_append(uvector_t *v, ugeneric_t e)
 {
     UASSERT_INPUT(v);
+    _unshare(v);
 
     if (v->capacity == v->size)
     {
@@ -314,6 +438,7 @@ ugeneric_t uvector_pop_at(uvector_t *v, size_t i)
 {
     UASSERT_INPUT(v);
     UASSERT_INPUT(i < v->size);
+    _unshare(v);
 
     ugeneric_t e = v->cells[i];
     memmove(v->cells + i, v->cells - i + 1, (v->size - i - 1) * sizeof(v->cells[0]));
@@ -326,25 +451,83 @@ ugeneric_t uvector_pop_back(uvector_t *v)
 {
     UASSERT_INPUT(v);
     UASSERT_INPUT(v->size);
+    _unshare(v);
     return v->cells[--v->size];
 }
 
 void uvector_reverse(uvector_t *v)
 {
+    _unshare(v);
     ugeneric_array_reverse(v->cells, v->size, 0, v->size ? v->size - 1 : 0);
 }
 
 void uvector_reverse_range(uvector_t *v, size_t l, size_t r)
 {
+    _unshare(v);
     ugeneric_array_reverse(v->cells, v->size, l, r);
 }
 
 void uvector_sort(uvector_t *v)
 {
     UASSERT_INPUT(v);
+    _unshare(v);
     v->sorter(v->cells, v->size, v->void_handlers.cmp);
 }
 
+void uvector_sort_parallel(uvector_t *v, size_t nthreads)
+{
+    UASSERT_INPUT(v);
+    _unshare(v);
+    parallel_sort_ext(v->cells, v->size, v->void_handlers.cmp, nthreads);
+}
+
+void uvector_sort_by_key(uvector_t *v, ugeneric_key_fn_t key)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(key);
+    _unshare(v);
+    key_sort(v->cells, v->size, key);
+}
+
+void uvector_set_sorter(uvector_t *v, ugeneric_sorter_t sorter)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(sorter);
+    v->sorter = sorter;
+}
+
+void uvector_nth_element(uvector_t *v, size_t n)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(n < v->size);
+    _unshare(v);
+    nth_element(v->cells, v->size, n, v->void_handlers.cmp);
+}
+
+void uvector_partial_sort(uvector_t *v, size_t k)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(k <= v->size);
+    _unshare(v);
+    partial_sort(v->cells, v->size, k, v->void_handlers.cmp);
+}
+
+void uvector_top_k(uvector_t *v, size_t k)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(k <= v->size);
+    _unshare(v);
+    top_k(v->cells, v->size, k, v->void_handlers.cmp);
+}
+
+void uvector_top_k_parallel(uvector_t *v, size_t k, size_t nthreads)
+{
+    UASSERT_INPUT(v);
+    UASSERT_INPUT(k <= v->size);
+    _unshare(v);
+    parallel_top_k(v->cells, v->size, k, v->void_handlers.cmp, nthreads);
+}
+
 bool uvector_is_sorted(const uvector_t *v)
 {
     return ugeneric_array_is_sorted(v->cells, v->size, v->void_handlers.cmp);
@@ -360,6 +543,31 @@ uvector_t *uvector_deep_copy(const uvector_t *v)
     return _vcpy(v, true);
 }
 
+uvector_t *uvector_cow_copy(const uvector_t *v)
+{
+    UASSERT_INPUT(v);
+
+    // Cells on an arena can't be shared with a heap copy.
+    if (uallocator_get_copy_allocator(v->allocator) != v->allocator)
+    {
+        return _vcpy(v, v->is_data_owner);
+    }
+
+    // Sharing is bookkeeping, the contents of v stay the same.
+    uvector_t *shared = (uvector_t *)v;
+    if (!shared->refs)
+    {
+        shared->refs = uallocator_alloc(v->allocator, sizeof(*v->refs));
+        atomic_init(shared->refs, 1);
+    }
+    atomic_fetch_add(shared->refs, 1);
+
+    uvector_t *copy = uallocator_alloc(v->allocator, sizeof(*copy));
+    *copy = *v;
+
+    return copy;
+}
+
 void uvector_serialize(const uvector_t *v, ubuffer_t *buf)
 {
     UASSERT_INPUT(v);
@@ -393,11 +601,7 @@ int uvector_fprint(const uvector_t *v, FILE *out)
     UASSERT_INPUT(v);
     UASSERT_INPUT(out);
 
-    char *str = uvector_as_str(v);
-    int ret = fprintf(out, "%s\n", str);
-    ufree(str);
-
-    return ret;
+    return ubuffer_fprint_serialized((ubuffer_s8r_t)uvector_serialize, v, out);
 }
 
 size_t uvector_bsearch(const uvector_t *v, ugeneric_t e)
@@ -409,62 +613,460 @@ size_t uvector_bsearch(const uvector_t *v, ugeneric_t e)
 bool uvector_next_permutation(uvector_t *v)
 {
     UASSERT_INPUT(v);
+    _unshare(v);
     return ugeneric_array_next_permutation(v->cells, v->size, v->void_handlers.cmp);
 }
 
+/*
+ * Open addressing index of kept items: a slot holds position + 1 of an item
+ * already moved to its final place, 0 if the slot is free. Slots are at least
+ * twice as many as items and only as wide as positions need.
+ */
+static size_t _unique_hash(ugeneric_t g)
+{
+    // Reals equal to an integer compare equal to it, so they hash the same.
+    if (ugeneric_get_type(g) == G_REAL_T)
+    {
+        double d = G_AS_REAL(g);
+        if ((d >= 0) && (d < 18446744073709551616.0) &&
+            ((double)(unsigned long long)d == d))
+        {
+            return (size_t)(unsigned long long)d;
+        }
+        if ((d < 0) && (d >= -9223372036854775808.0) &&
+            ((double)(long long)d == d))
+        {
+            return (size_t)(long long)d;
+        }
+    }
+
+    return ugeneric_hash(g, NULL);
+}
+
+#define DEFINE_UNIQUE(_suffix_, _slot_t_)                                      \
+static size_t _unique_##_suffix_(uvector_t *v, size_t bits)                    \
+{                                                                              \
+    size_t mask = ((size_t)1 << bits) - 1;                                     \
+    size_t shift = sizeof(size_t) * CHAR_BIT - bits;                           \
+    _slot_t_ *slots = ucalloc(mask + 1, sizeof(slots[0]));                     \
+    size_t size = 0;                                                           \
+                                                                               \
+    for (size_t i = 0; i < v->size; i++)                                       \
+    {                                                                          \
+        ugeneric_t e = v->cells[i];                                            \
+        size_t h = (_unique_hash(e) * UNIQUE_GOLDEN_RATIO) >> shift;           \
+        bool seen = false;                                                     \
+        for (; slots[h] && !seen; h = (h + 1) & mask)                          \
+        {                                                                      \
+            seen = !ugeneric_compare_v(v->cells[slots[h] - 1], e,              \
+                                       v->void_handlers.cmp);                  \
+        }                                                                      \
+        if (seen)                                                              \
+        {                                                                      \
+            if (v->is_data_owner)                                              \
+            {                                                                  \
+                ugeneric_destroy_v(e, v->void_handlers.dtr);                   \
+            }                                                                  \
+        }                                                                      \
+        else                                                                   \
+        {                                                                      \
+            slots[h] = (_slot_t_)(size + 1);                                   \
+            v->cells[size++] = e;                                              \
+        }                                                                      \
+    }                                                                          \
+    ufree(slots);                                                              \
+                                                                               \
+    return size;                                                               \
+}
+
+DEFINE_UNIQUE(u32, uint32_t)
+DEFINE_UNIQUE(size, size_t)
+
+void uvector_unique(uvector_t *v)
+{
+    UASSERT_INPUT(v);
+
+    if (v->size < 2)
+    {
+        return;
+    }
+    _unshare(v);
+
+    size_t bits = 1;
+    while (((size_t)1 << bits) < 2 * v->size)
+    {
+        bits++;
+    }
+    v->size = (v->size < UINT32_MAX) ? _unique_u32(v, bits)
+                                     : _unique_size(v, bits);
+}
+
+void uvector_unique_sorted(uvector_t *v)
+{
+    UASSERT_INPUT(v);
+
+    if (v->size < 2)
+    {
+        return;
+    }
+    _unshare(v);
+
+    if (!uvector_is_sorted(v))
+    {
+        uvector_sort(v);
+    }
+
+    size_t size = 1;
+    for (size_t i = 1; i < v->size; i++)
+    {
+        if (ugeneric_compare_v(v->cells[size - 1], v->cells[i],
+                               v->void_handlers.cmp))
+        {
+            v->cells[size++] = v->cells[i];
+        }
+        else if (v->is_data_owner)
+        {
+            ugeneric_destroy_v(v->cells[i], v->void_handlers.dtr);
+        }
+    }
+    v->size = size;
+}
+
 ugeneric_base_t *uvector_get_base(uvector_t *v)
 {
     UASSERT_INPUT(v);
     return (ugeneric_base_t *)v;
 }
 
+umem_usage_t uvector_get_memory_usage(const uvector_t *v)
+{
+    UASSERT_INPUT(v);
+
+    umem_usage_t u = {0};
+    u.header = sizeof(*v);
+    u.buckets = v->capacity * sizeof(v->cells[0]);
+    if (v->is_data_owner)
+    {
+        for (size_t i = 0; i < v->size; i++)
+        {
+            u.payload += ugeneric_get_memory_usage(v->cells[i]);
+        }
+    }
+
+    return u;
+}
+
 uvector_t *uvector_get_slice(const uvector_t *v, size_t begin, size_t end,
                              size_t stride)
 {
-    UASSERT_INPUT(v);
+    uvector_view_t w = uvector_get_view(v, begin, end, stride);
+    return uvector_view_to_vector(&w);
+}
+
+static uvector_view_t _view(const uvector_view_t *w, size_t begin, size_t end,
+                            size_t stride)
+{
     UASSERT_INPUT(begin <= end);
-    UASSERT_INPUT(end <= v->size);
+    UASSERT_INPUT(end <= w->size);
     UASSERT_INPUT(stride != 0);
 
-    uvector_t *slice = umalloc(sizeof(*v));
-    memcpy(&slice->void_handlers, &v->void_handlers, sizeof(v->void_handlers));
-    slice->size = (end - begin) / stride + (bool)((end - begin) % stride);
-    slice->capacity = slice->size;
-    slice->is_data_owner = false;
-    slice->sorter = _default_vector_sorter;
-    slice->cells = NULL;
-    if (slice->size)
-    {
-        slice->cells = umalloc(sizeof(slice->cells[0]) * slice->size);
-        for (size_t i = 0; i < slice->size; i++)
+    uvector_view_t view = *w;
+    view.cells = w->cells ? w->cells + begin * w->stride : NULL;
+    view.size = (end - begin) / stride + (bool)((end - begin) % stride);
+    view.stride = w->stride * stride;
+
+    return view;
+}
+
+uvector_view_t uvector_get_view(const uvector_t *v, size_t begin, size_t end,
+                                size_t stride)
+{
+    UASSERT_INPUT(v);
+
+    uvector_view_t w = {
+        .cells = v->cells,
+        .size = v->size,
+        .stride = 1,
+        .void_handlers = v->void_handlers,
+        .allocator = v->allocator,
+    };
+
+    return _view(&w, begin, end, stride);
+}
+
+uvector_view_t uvector_view_get_view(const uvector_view_t *w, size_t begin,
+                                     size_t end, size_t stride)
+{
+    UASSERT_INPUT(w);
+    return _view(w, begin, end, stride);
+}
+
+size_t uvector_view_get_size(const uvector_view_t *w)
+{
+    UASSERT_INPUT(w);
+    return w->size;
+}
+
+bool uvector_view_is_empty(const uvector_view_t *w)
+{
+    UASSERT_INPUT(w);
+    return w->size == 0;
+}
+
+ugeneric_t uvector_view_get_at(const uvector_view_t *w, size_t i)
+{
+    UASSERT_INPUT(w);
+    UASSERT_INPUT(i < w->size);
+
+    return w->cells[i * w->stride];
+}
+
+size_t uvector_view_find(const uvector_view_t *w, ugeneric_t e)
+{
+    UASSERT_INPUT(w);
+
+    if (w->stride == 1)
+    {
+        return ugeneric_array_find(w->cells, w->size, 0, e,
+                                   w->void_handlers.cmp);
+    }
+
+    for (size_t i = 0; i < w->size; i++)
+    {
+        if (ugeneric_compare_v(w->cells[i * w->stride], e,
+                               w->void_handlers.cmp) == 0)
         {
-            slice->cells[i] = v->cells[begin + i * stride];
+            return i;
         }
     }
 
-    return slice;
+    return SIZE_MAX;
 }
 
-ugeneric_t *uvector_find(uvector_t *v, ugeneric_t e)
+bool uvector_view_contains(const uvector_view_t *w, ugeneric_t e)
 {
-    UASSERT_INPUT(v);
+    return uvector_view_find(w, e) != SIZE_MAX;
+}
 
-    ugeneric_t *ret = NULL;
-    for (size_t i = 0; i < v->size; i++)
+size_t uvector_view_bsearch(const uvector_view_t *w, ugeneric_t e)
+{
+    UASSERT_INPUT(w);
+
+    size_t l = 0;
+    size_t r = w->size;
+    while (l < r)
+    {
+        size_t m = l + (r - l) / 2;
+        if (ugeneric_compare_v(w->cells[m * w->stride], e,
+                               w->void_handlers.cmp) < 0)
+        {
+            l = m + 1;
+        }
+        else
+        {
+            r = m;
+        }
+    }
+
+    bool found = (l < w->size) &&
+        !ugeneric_compare_v(w->cells[l * w->stride], e, w->void_handlers.cmp);
+
+    return found ? l : SIZE_MAX;
+}
+
+void uvector_view_sort_into(const uvector_view_t *w, uvector_t *out)
+{
+    UASSERT_INPUT(w);
+    UASSERT_INPUT(out);
+
+    if (!w->size)
+    {
+        return;
+    }
+
+    _unshare(out);
+    // Growing out would free the cells the view reads.
+    uintptr_t begin = (uintptr_t)out->cells;
+    uintptr_t end = begin + out->capacity * sizeof(out->cells[0]);
+    UASSERT_INPUT(((uintptr_t)w->cells < begin) ||
+                  ((uintptr_t)w->cells >= end));
+    size_t size = out->size;
+    if (out->capacity < size + w->size)
+    {
+        uvector_reserve_capacity(out, MAX(size + w->size,
+                                          (size_t)(SCALE_FACTOR * size)));
+    }
+    for (size_t i = 0; i < w->size; i++)
+    {
+        out->cells[size + i] = w->cells[i * w->stride];
+    }
+    out->size += w->size;
+    out->sorter(out->cells + size, w->size, w->void_handlers.cmp);
+}
+
+uvector_t *uvector_view_to_vector(const uvector_view_t *w)
+{
+    UASSERT_INPUT(w);
+
+    uvector_t *v = _allocate_vector(uallocator_get_copy_allocator(w->allocator));
+    v->void_handlers = w->void_handlers;
+    v->is_data_owner = false;
+    if (w->size)
+    {
+        v->cells = uallocator_alloc(v->allocator,
+                                    sizeof(v->cells[0]) * w->size);
+        for (size_t i = 0; i < w->size; i++)
+        {
+            v->cells[i] = w->cells[i * w->stride];
+        }
+        v->size = w->size;
+        v->capacity = w->size;
+    }
+
+    return v;
+}
+
+void uvector_view_serialize(const uvector_view_t *w, ubuffer_t *buf)
+{
+    UASSERT_INPUT(w);
+    UASSERT_INPUT(buf);
+
+    ubuffer_append_byte(buf, '[');
+    for (size_t i = 0; i < w->size; i++)
     {
-        if (ugeneric_compare_v(v->cells[i], e, v->void_handlers.cmp) == 0)
+        ugeneric_serialize_v(w->cells[i * w->stride], buf, w->void_handlers.s8r);
+        if (i < w->size - 1)
         {
-            ret = &v->cells[i];
-            break;
+            ubuffer_append_data(buf, ", ", 2);
         }
     }
+    ubuffer_append_byte(buf, ']');
+}
+
+char *uvector_view_as_str(const uvector_view_t *w)
+{
+    UASSERT_INPUT(w);
+
+    ubuffer_t buf = {0};
+    uvector_view_serialize(w, &buf);
+    ubuffer_null_terminate(&buf);
+
+    return buf.data;
+}
+
+ugeneric_t *uvector_find(uvector_t *v, ugeneric_t e)
+{
+    UASSERT_INPUT(v);
+
+    size_t i = ugeneric_array_find(v->cells, v->size, 0, e,
+                                   v->void_handlers.cmp);
+    if (i == SIZE_MAX)
+    {
+        return NULL;
+    }
 
-    return ret;
+    // The item may be changed through the result.
+    _unshare(v);
+    return &v->cells[i];
 }
 
 bool uvector_contains(const uvector_t *v, ugeneric_t e)
 {
-    return uvector_find((uvector_t *)v, e) != NULL;
+    UASSERT_INPUT(v);
+    return ugeneric_array_find(v->cells, v->size, 0, e,
+                               v->void_handlers.cmp) != SIZE_MAX;
+}
+
+size_t uvector_count(const uvector_t *v, ugeneric_t e)
+{
+    UASSERT_INPUT(v);
+    return ugeneric_array_count(v->cells, v->size, e, v->void_handlers.cmp);
+}
+
+uvector_t *uvector_find_all(const uvector_t *v, ugeneric_t e)
+{
+    UASSERT_INPUT(v);
+
+    uvector_t *positions = uvector_create();
+    for (size_t i = ugeneric_array_find(v->cells, v->size, 0, e,
+                                        v->void_handlers.cmp);
+         i != SIZE_MAX;
+         i = ugeneric_array_find(v->cells, v->size, i + 1, e,
+                                 v->void_handlers.cmp))
+    {
+        uvector_append(positions, G_SIZE(i));
+    }
+
+    return positions;
+}
+
+typedef struct {
+    const ugeneric_t *base;
+    size_t nmemb;
+    ugeneric_t e;
+    void_cmp_t cmp;
+    size_t count;
+} _count_task_t;
+
+static void *_count_worker(void *arg)
+{
+    _count_task_t *t = arg;
+    t->count = ugeneric_array_count(t->base, t->nmemb, t->e, t->cmp);
+    return NULL;
+}
+
+size_t uvector_count_parallel(const uvector_t *v, ugeneric_t e, size_t nthreads)
+{
+    UASSERT_INPUT(v);
+
+    if (nthreads == 0)
+    {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (ncpu > 0) ? (size_t)ncpu : 1;
+    }
+    nthreads = MIN(nthreads, v->size / VECTOR_PARALLEL_COUNT_CUTOFF);
+
+    if (nthreads < 2)
+    {
+        return uvector_count(v, e);
+    }
+
+    // Parts are counted on their own threads, the first one on the calling
+    // thread. A part whose thread can't be started is counted inline.
+    _count_task_t *tasks = umalloc(nthreads * sizeof(tasks[0]));
+    pthread_t *threads = umalloc(nthreads * sizeof(threads[0]));
+    bool *started = umalloc(nthreads * sizeof(started[0]));
+    for (size_t i = 0; i < nthreads; i++)
+    {
+        size_t l = v->size / nthreads * i + MIN(i, v->size % nthreads);
+        size_t r = v->size / nthreads * (i + 1) + MIN(i + 1, v->size % nthreads);
+        tasks[i] = (_count_task_t){v->cells + l, r - l, e, v->void_handlers.cmp, 0};
+    }
+    for (size_t i = 1; i < nthreads; i++)
+    {
+        started[i] = (pthread_create(&threads[i], NULL, _count_worker, &tasks[i]) == 0);
+        if (!started[i])
+        {
+            _count_worker(&tasks[i]);
+        }
+    }
+    _count_worker(&tasks[0]);
+
+    size_t count = tasks[0].count;
+    for (size_t i = 1; i < nthreads; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+        count += tasks[i].count;
+    }
+
+    ufree(started);
+    ufree(threads);
+    ufree(tasks);
+
+    return count;
 }
 
 void uvector_dump_to_gnuplot(const uvector_t *v, gnuplot_attrs_t *attrs, FILE *out)
@@ -7,11 +7,11 @@
 #include "vector.h"
 
 const char *inorder_keys = "[-311, 0, 1, 2, 15, 42, 100, 123, 140, 143, 144, 145, 146, 150, 1000, 2000, 3000, 4000]";
-const char *inorder_values = "[-3113, 0, -1, -2, -15, \"-42\", -100, [1, 11, 111, 1111], -140, -143, -144, -145, -146, -150, -1000, -2000, -3.14286, -4004]";
+const char *inorder_values = "[-3113, 0, -1, -2, -15, \"-42\", -100, [1, 11, 111, 1111], -140, -143, -144, -145, -146, -150, -1000, -2000, -3.142857142857143, -4004]";
 const char *preorder_keys = "[-311, 0, 42, 15, 123, 140, 143, 144, 150, 146, 145, 4000, 3000, 2000, 1000, 100, 2, 1]";
-const char *preorder_values = "[-3113, 0, \"-42\", -15, [1, 11, 111, 1111], -140, -143, -144, -150, -146, -145, -4004, -3.14286, -2000, -1000, -100, -2, -1]";
+const char *preorder_values = "[-3113, 0, \"-42\", -15, [1, 11, 111, 1111], -140, -143, -144, -150, -146, -145, -4004, -3.142857142857143, -2000, -1000, -100, -2, -1]";
 const char *postorder_keys = "[1, 0, -311, 2, 100, 15, 42, 1000, 145, 144, 143, 140, 123, 146, 150, 2000, 3000, 4000]";
-const char *postorder_values = "[-1, 0, -3113, -2, -100, -15, \"-42\", -1000, -145, -144, -143, -140, [1, 11, 111, 1111], -146, -150, -2000, -3.14286, -4004]";
+const char *postorder_values = "[-1, 0, -3113, -2, -100, -15, \"-42\", -1000, -145, -144, -143, -140, [1, 11, 111, 1111], -146, -150, -2000, -3.142857142857143, -4004]";
 
 bool cb(ugeneric_t k, ugeneric_t v, void *data)
 {
@@ -96,7 +96,7 @@ static ubst_t *_create_test_tree3(void)
 
 static ubst_t *_create_test_tree4(void)
 {
-    ubst_t *b = ubst_create_ext(UBST_NO_BALANCING);
+    ubst_t *b = ubst_create_ext(UBST_NO_BALANCING, NULL);
     ubst_put(b, G_INT(1), G_STR(ustring_dup("one")));
     ubst_put(b, G_INT(2), G_STR(ustring_dup("two")));
     ubst_put(b, G_INT(3), G_STR(ustring_dup("three")));
@@ -299,7 +299,7 @@ void test_traverse(void)
 
 void test_large_bst(void)
 {
-    ubst_t *b = ubst_create_ext(UBST_RB_BALANCING);
+    ubst_t *b = ubst_create_ext(UBST_RB_BALANCING, NULL);
     const char *path = "utdata/dict_data.txt";
     ugeneric_t g = ufile_read_lines(path, "\n");
     UASSERT_NO_ERROR(g);
@@ -320,7 +320,7 @@ void test_large_bst(void)
     ubst_destroy(b);
 
     size_t N = 100;
-    b = ubst_create_ext(UBST_NO_BALANCING);
+    b = ubst_create_ext(UBST_NO_BALANCING, NULL);
     for (size_t i = N; i > 1; i--)
     {
        ubst_put(b, G_INT(i), G_INT(i));
@@ -328,7 +328,7 @@ void test_large_bst(void)
     //ubst_dump_to_dot(b, "large_bst", false, stdout);
     ubst_destroy(b);
 
-    b = ubst_create_ext(UBST_RB_BALANCING);
+    b = ubst_create_ext(UBST_RB_BALANCING, NULL);
     for (size_t i = 0; i < N; i++)
     {
         ubst_put(b, G_INT(i), G_INT(i));
@@ -337,7 +337,7 @@ void test_large_bst(void)
 
     ubst_destroy(b);
 
-    b = ubst_create_ext(UBST_RB_BALANCING);
+    b = ubst_create_ext(UBST_RB_BALANCING, NULL);
     for (size_t i = 0; i < N; i++)
     {
         ubst_put(b, G_INT(N - i), G_INT(N - i));
@@ -353,6 +353,49 @@ void test_udict_cmp(udict_backend_t backend)
     }
 }
 
+void test_udict_cow_copy(udict_backend_t backend)
+{
+    udict_t *d = udict_create_with_backend(backend);
+    for (int i = 0; i < 100; i++)
+    {
+        udict_put(d, G_STR(ustring_fmt("k%d", i)), G_INT(i));
+    }
+
+    udict_t *c1 = udict_cow_copy(d);
+    udict_t *c2 = udict_cow_copy(c1);
+    UASSERT(c1->vobj == d->vobj);
+    UASSERT(c2->vobj == d->vobj);
+    UASSERT_INT_EQ(udict_compare(d, c2), 0);
+
+    // Only the modified one gets storage (and items) of its own.
+    udict_put(c1, G_STR(ustring_dup("new")), G_INT(-1));
+    UASSERT(c1->vobj != d->vobj);
+    UASSERT(c2->vobj == d->vobj);
+    UASSERT_SIZE_EQ(udict_get_size(c1), 101);
+    UASSERT_SIZE_EQ(udict_get_size(d), 100);
+    UASSERT(!udict_has_key(d, G_CSTR("new")));
+
+    UASSERT(udict_remove(d, G_CSTR("k0")));
+    UASSERT(c2->vobj != d->vobj);
+    UASSERT(udict_has_key(c2, G_CSTR("k0")));
+
+    // The last one left doesn't copy anything.
+    void *vobj = c2->vobj;
+    udict_destroy(udict_cow_copy(c2));
+    udict_put(c2, G_STR(ustring_dup("k0")), G_INT(0));
+    UASSERT(c2->vobj == vobj);
+
+    udict_t *c3 = udict_cow_copy(c2);
+    udict_clear(c3);
+    UASSERT(udict_is_empty(c3));
+    UASSERT_SIZE_EQ(udict_get_size(c2), 100);
+
+    udict_destroy(d);
+    udict_destroy(c1);
+    udict_destroy(c2);
+    udict_destroy(c3);
+}
+
 void test_2sum(void)
 {
     const char *path = "utdata/2sum.txt";
@@ -425,6 +468,7 @@ int main(int argc, char **argv)
         test_single(i);
         test_udict_put(i);
         test_udict_cmp(i);
+        test_udict_cow_copy(i);
     }
 
     test_2sum();
@@ -0,0 +1,244 @@
+#include "extsort.h"
+
+#include "file_utils.h"
+#include "mem.h"
+#include "string_utils.h"
+#include "ut_utils.h"
+#include "vector.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INPUT_PATH "ttt_extsort_in"
+#define OUTPUT_PATH "ttt_extsort_out"
+#define TMP_DIR "ttt_extsort_tmp"
+
+static void write_records(const char *path, const uvector_t *v)
+{
+    ugeneric_t g = ufile_writer_create(path);
+    UASSERT_NO_ERROR(g);
+    ufile_writer_t *fw = G_AS_PTR(g);
+    for (size_t i = 0; i < uvector_get_size(v); i++)
+    {
+        UASSERT_NO_ERROR(ufile_writer_write_generic(fw, uvector_get_at(v, i)));
+    }
+    UASSERT_NO_ERROR(ufile_writer_destroy(fw));
+}
+
+static uvector_t *read_records(const char *path)
+{
+    ugeneric_t g = ufile_reader_create(path, 4096);
+    UASSERT_NO_ERROR(g);
+    ufile_reader_t *fr = G_AS_PTR(g);
+    uvector_t *v = uvector_create();
+    while (ufile_reader_has_next(fr))
+    {
+        g = ufile_reader_read_generic(fr);
+        UASSERT_NO_ERROR(g);
+        uvector_append(v, g);
+    }
+    UASSERT_NO_ERROR(ufile_reader_destroy(fr));
+
+    return v;
+}
+
+static uvector_t *extsort(const char *path, size_t memory_budget)
+{
+    ugeneric_t g = uextsort_iterator_create(path, memory_budget, NULL);
+    UASSERT_NO_ERROR(g);
+    uextsort_iterator_t *it = G_AS_PTR(g);
+    uvector_t *v = uvector_create();
+    while (uextsort_iterator_has_next(it))
+    {
+        g = uextsort_iterator_get_next(it);
+        UASSERT_NO_ERROR(g);
+        uvector_append(v, g);
+    }
+    uextsort_iterator_destroy(it);
+
+    return v;
+}
+
+void test_generic_records(void)
+{
+    uvector_t *v = uvector_create();
+    uvector_append(v, G_NULL());
+    uvector_append(v, G_TRUE());
+    uvector_append(v, G_FALSE());
+    uvector_append(v, G_INT(-42));
+    uvector_append(v, G_SIZE(SIZE_MAX));
+    uvector_append(v, G_REAL(0.5));
+    uvector_append(v, G_STR(ustring_dup("")));
+    uvector_append(v, G_STR(ustring_dup("hello")));
+    ugeneric_t c = ugeneric_parse("[1, \"two\", {\"k\": [null, 3.5]}, []]");
+    UASSERT_NO_ERROR(c);
+    uvector_append(v, c);
+    c = ugeneric_parse("{\"a\": \"b\", \"c\": {}}");
+    UASSERT_NO_ERROR(c);
+    uvector_append(v, c);
+    uvector_append(v, G_MEMCHUNK(umemdup("a\0b", 3), 3));
+    write_records(INPUT_PATH, v);
+
+    uvector_t *r = read_records(INPUT_PATH);
+    UASSERT_INT_EQ(uvector_compare(v, r), 0);
+    uvector_destroy(r);
+
+    // Containers are sorted like any other item.
+    r = extsort(INPUT_PATH, 1);
+    uvector_sort(v);
+    UASSERT_INT_EQ(uvector_compare(v, r), 0);
+    uvector_destroy(r);
+
+    // Cut in the middle of the last record.
+    ugeneric_t g = ufile_read_to_memchunk(INPUT_PATH);
+    UASSERT_NO_ERROR(g);
+    umemchunk_t m = G_AS_MEMCHUNK(g);
+    m.size--;
+    UASSERT_NO_ERROR(ufile_create_from_memchunk(INPUT_PATH, m));
+    ufree(m.data);
+
+    g = ufile_reader_create(INPUT_PATH, 16);
+    UASSERT_NO_ERROR(g);
+    ufile_reader_t *fr = G_AS_PTR(g);
+    for (size_t i = 0; i < uvector_get_size(v) - 1; i++)
+    {
+        g = ufile_reader_read_generic(fr);
+        UASSERT_NO_ERROR(g);
+        ugeneric_destroy(g);
+    }
+    g = ufile_reader_read_generic(fr);
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+    UASSERT_NO_ERROR(ufile_reader_destroy(fr));
+
+    g = uextsort_iterator_create(INPUT_PATH, EXTSORT_DEFAULT_MEMORY_BUDGET, NULL);
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+
+    // Length far beyond the end of the file isn't allocated.
+    char huge[12] = {0};
+    uint64_t size = (uint64_t)1 << 46;
+    memcpy(huge, &size, sizeof(size));
+    UASSERT_NO_ERROR(ufile_create_from_memchunk(INPUT_PATH,
+                                                (umemchunk_t){huge, sizeof(huge)}));
+    g = ufile_reader_create(INPUT_PATH, 16);
+    UASSERT_NO_ERROR(g);
+    fr = G_AS_PTR(g);
+    g = ufile_reader_read_generic(fr);
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+    UASSERT_NO_ERROR(ufile_reader_destroy(fr));
+
+    remove(INPUT_PATH);
+    uvector_destroy(v);
+}
+
+void test_extsort_in_memory(void)
+{
+    uvector_t *v = uvector_create();
+    write_records(INPUT_PATH, v);
+    uvector_t *r = extsort(INPUT_PATH, EXTSORT_DEFAULT_MEMORY_BUDGET);
+    UASSERT(uvector_is_empty(r));
+    uvector_destroy(r);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        uvector_append(v, G_INT(rand() % 100));
+    }
+    write_records(INPUT_PATH, v);
+    r = extsort(INPUT_PATH, EXTSORT_DEFAULT_MEMORY_BUDGET);
+    uvector_sort(v);
+    UASSERT_INT_EQ(uvector_compare(v, r), 0);
+
+    // Items not taken are freed with the iterator.
+    ugeneric_t g = uextsort_iterator_create(INPUT_PATH, EXTSORT_DEFAULT_MEMORY_BUDGET, NULL);
+    UASSERT_NO_ERROR(g);
+    uextsort_iterator_destroy(G_AS_PTR(g));
+
+    remove(INPUT_PATH);
+    uvector_destroy(r);
+    uvector_destroy(v);
+}
+
+void test_extsort_spilled(void)
+{
+    // Several merge passes: hundreds of runs of a few dozen items each.
+    uvector_t *v = uvector_create();
+    for (int i = 0; i < 20000; i++)
+    {
+        if (i % 3)
+        {
+            uvector_append(v, G_INT(rand() % 5000 - 2500));
+        }
+        else
+        {
+            uvector_append(v, G_STR(ustring_fmt("str%d", rand() % 5000)));
+        }
+    }
+    write_records(INPUT_PATH, v);
+    uvector_sort(v);
+
+    uvector_t *r = extsort(INPUT_PATH, 1024);
+    UASSERT_INT_EQ(uvector_compare(v, r), 0);
+    uvector_destroy(r);
+
+    UASSERT_NO_ERROR(uextsort_file(INPUT_PATH, OUTPUT_PATH, 64 * 1024, NULL));
+    r = read_records(OUTPUT_PATH);
+    UASSERT_INT_EQ(uvector_compare(v, r), 0);
+    uvector_destroy(r);
+
+    // Leftovers of an abandoned merge are cleaned up.
+    UASSERT_INT_EQ(mkdir(TMP_DIR, 0700), 0);
+    ugeneric_t g = uextsort_iterator_create(INPUT_PATH, 1024, TMP_DIR);
+    UASSERT_NO_ERROR(g);
+    uextsort_iterator_t *it = G_AS_PTR(g);
+    g = uextsort_iterator_get_next(it);
+    UASSERT_NO_ERROR(g);
+    ugeneric_destroy(g);
+    uextsort_iterator_destroy(it);
+    UASSERT_INT_EQ(rmdir(TMP_DIR), 0);
+
+    remove(INPUT_PATH);
+    remove(OUTPUT_PATH);
+    uvector_destroy(v);
+
+    // Item bigger than the whole budget is a run of its own.
+    v = uvector_create();
+    for (int i = 0; i < 500; i++)
+    {
+        uvector_append(v, G_INT(rand() % 100));
+    }
+    write_records(INPUT_PATH, v);
+    uvector_sort(v);
+    r = extsort(INPUT_PATH, 1);
+    UASSERT_INT_EQ(uvector_compare(v, r), 0);
+    uvector_destroy(r);
+    remove(INPUT_PATH);
+    uvector_destroy(v);
+}
+
+void test_extsort_errors(void)
+{
+    ugeneric_t g = uextsort_iterator_create("ttt_no_such_file", 1024, NULL);
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+
+    uvector_t *v = uvector_create();
+    uvector_append(v, G_INT(1));
+    write_records(INPUT_PATH, v);
+    g = uextsort_iterator_create(INPUT_PATH, 1, "ttt_no_such_dir");
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+
+    remove(INPUT_PATH);
+    uvector_destroy(v);
+}
+
+int main(void)
+{
+    test_generic_records();
+    test_extsort_in_memory();
+    test_extsort_spilled();
+    test_extsort_errors();
+
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,9 @@
 #include "file_utils.h"
 
 #include "mem.h"
+#include "string_utils.h"
 #include "ut_utils.h"
+#include "vector.h"
 
 size_t execute_read(const char *path, size_t buffer_size)
 {
@@ -163,6 +165,47 @@ void test_open_dir(void)
     ugeneric_error_destroy(g);
 }
 
+void test_ufile_writer_serialize(void)
+{
+    // Big enough to go through several sink blocks.
+    uvector_t *v = uvector_create();
+    for (size_t i = 0; i < 50000; i++)
+    {
+        uvector_append(v, G_STR(ustring_fmt("item %zu", i)));
+        uvector_append(v, G_REAL(i / 7.0));
+    }
+    uvector_append(v, G_MEMCHUNK(ucalloc(BUFFER_SINK_BLOCK_SIZE, 1),
+                                 BUFFER_SINK_BLOCK_SIZE));
+    char *expected = ugeneric_as_str(G_VECTOR(v));
+
+    ugeneric_t g = ufile_writer_create("ttt3");
+    UASSERT_NO_ERROR(g);
+    ufile_writer_t *fw = G_AS_PTR(g);
+    UASSERT_NO_ERROR(ufile_writer_serialize(fw, G_VECTOR(v)));
+    UASSERT_NO_ERROR(ufile_writer_destroy(fw));
+
+    g = ufile_read_to_string("ttt3");
+    UASSERT_NO_ERROR(g);
+    UASSERT_STR_EQ(G_AS_STR(g), expected);
+    ufree(G_AS_STR(g));
+
+    g = ufile_open("ttt3", "wb");
+    UASSERT_NO_ERROR(g);
+    FILE *f = G_AS_PTR(g);
+    UASSERT_INT_EQ(uvector_fprint(v, f), strlen(expected) + 1);
+    UASSERT_NO_ERROR(ufile_close(f));
+
+    g = ufile_read_to_string("ttt3");
+    UASSERT_NO_ERROR(g);
+    UASSERT_INT_EQ(strncmp(G_AS_STR(g), expected, strlen(expected)), 0);
+    UASSERT_STR_EQ(G_AS_STR(g) + strlen(expected), "\n");
+    ufree(G_AS_STR(g));
+
+    remove("ttt3");
+    ufree(expected);
+    uvector_destroy(v);
+}
+
 int main(int argc, char **argv)
 {
     (void)argc;
@@ -172,6 +215,7 @@ int main(int argc, char **argv)
     test_ufile_reader();
     //test_ufile_writer(atoi(argv[1]));
     test_open_dir();
+    test_ufile_writer_serialize();
 
     return 0;
 }
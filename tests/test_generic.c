@@ -208,7 +208,13 @@ void test_parse(void)
         {"\"t\\\"tt\"", "\"t\\\"tt\"", NULL},
         {"\"str'ing\"", "\"str'ing\"", NULL},
         {"\"\\\"\\\"\\\"\"", "\"\\\"\\\"\\\"\"", NULL},
-        {"\"\\\\\\\\\"", "\"\\\\\"", NULL},
+        {"\"\\\\\\\\\"", "\"\\\\\\\\\"", NULL},
+        {"\"a\\/b\\'c\"", "\"a/b'c\"", NULL},
+        {"\"\\b\\f\\n\\r\\t\\u0001\\u001F\"", "\"\\b\\f\\n\\r\\t\\u0001\\u001f\"", NULL},
+        {"\"\\u00e9\\u20AC\\ud83d\\ude00\"", "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"", NULL},
+        {"\"\\u12\"", NULL, "Parsing failed at offset 1"},
+        {"\"\\u0000\"", NULL, "Parsing failed at offset 1"},
+        {"\"\\ud83d\"", NULL, "Parsing failed at offset 1"},
         {"[ ]", "[]", NULL},
         {"{ }", "{}", NULL},
         {"null", "null", NULL},
@@ -249,10 +255,10 @@ void test_parse(void)
         {"[-]", NULL, "Parsing failed at offset 1"},
         {"[-3-]", NULL, "Parsing failed at offset 3"},
         {"--3", NULL, "Parsing failed at offset 0"},
-        {"0.0", "0", NULL},
-        {"-0.0", "-0", NULL},
-        {"1.0", "1", NULL},
-        {"-1.0", "-1", NULL},
+        {"0.0", "0.0", NULL},
+        {"-0.0", "-0.0", NULL},
+        {"1.0", "1.0", NULL},
+        {"-1.0", "-1.0", NULL},
         {"1.5", "1.5", NULL},
         {"-1.5", "-1.5", NULL},
         {"3.1416", "3.1416", NULL},
@@ -260,16 +266,16 @@ void test_parse(void)
         {"2e20", "2e+20", NULL},
         {"2E+20", "2e+20", NULL},
         {"2E-20", "2e-20", NULL},
-        {"-1E10", "-1e+10", NULL},
-        {"-1e10", "-1e+10", NULL},
-        {"-1E+10", "-1e+10", NULL},
+        {"-1E10", "-10000000000.0", NULL},
+        {"-1e10", "-10000000000.0", NULL},
+        {"-1E+10", "-10000000000.0", NULL},
         {"-1E-10", "-1e-10", NULL},
-        {"1.234E+10", "1.234e+10", NULL},
+        {"1.234E+10", "12340000000.0", NULL},
         {"1.234E-10", "1.234e-10", NULL},
-        {"0.9868011474609375", "0.986801", NULL},
-        {"45913141877270640000.0", "4.59131e+19", NULL},
-        {"0.017976931348623157e+310", "1.79769e+308", NULL},
-        {"5708990770823839207320493820740630171355185152001e-3", "5.70899e+45", NULL},
+        {"0.9868011474609375", "0.9868011474609375", NULL},
+        {"45913141877270640000.0", "4.591314187727064e+19", NULL},
+        {"0.017976931348623157e+310", "1.7976931348623157e+308", NULL},
+        {"5708990770823839207320493820740630171355185152001e-3", "5.70899077082384e+45", NULL},
         {"mem:000011ccFFaa", "mem:000011ccffaa", NULL},
         {"mem:", "mem:", NULL},
         {0}
@@ -357,6 +363,35 @@ void test_serialize(void)
     udict_destroy(d);
 }
 
+void test_string_escaping(void)
+{
+    char str[64];
+
+    for (size_t i = 0; i < 10000; i++)
+    {
+        size_t len = ugeneric_random_from_range(0, sizeof(str) - 1);
+        for (size_t j = 0; j < len; j++)
+        {
+            // Mostly clean text with occasional characters to be escaped.
+            int c = ugeneric_random_from_range(0, 9) ? ugeneric_random_from_range(' ', '~')
+                                                     : ugeneric_random_from_range(1, 255);
+            str[j] = c;
+        }
+        str[len] = 0;
+
+        char *out = ugeneric_as_str(G_CSTR(str));
+        for (char *p = out; *p; p++)
+        {
+            UASSERT((unsigned char)*p >= 0x20);
+        }
+        ugeneric_t g = ugeneric_parse(out);
+        UASSERT_NO_ERROR(g);
+        UASSERT_STR_EQ(G_AS_STR(g), str);
+        ugeneric_destroy(g);
+        ufree(out);
+    }
+}
+
 void test_parse_size(void)
 {
     char *integer = ustring_fmt("%ld", LONG_MAX);
@@ -388,6 +423,108 @@ void test_parse_size(void)
     ufree(over_size2);
 }
 
+void test_binary(void)
+{
+    ubuffer_t buf = {0};
+    ugeneric_t g = ugeneric_parse("{\"key\": [null, -1, 2, 3.4, 188881, false, true, [], {}, mem:ffaabb], "
+                                  "\"\": -9223372036854775808, \"x\": 18446744073709551615, "
+                                  "\"y\": [-0.0, 1e-300, \"str\", {\"a\": {\"b\": []}}]}");
+    UASSERT_NO_ERROR(g);
+
+    ugeneric_encode_binary(g, &buf);
+    ugeneric_t d = ugeneric_decode_binary(buf.data, buf.data_size);
+    UASSERT_NO_ERROR(d);
+    UASSERT(ugeneric_compare(g, d) == 0);
+
+    char *s1 = ugeneric_as_str(g);
+    char *s2 = ugeneric_as_str(d);
+    UASSERT_STR_EQ(s1, s2);
+    ufree(s1);
+    ufree(s2);
+    ugeneric_destroy(d);
+
+    // Every truncation or trailing garbage is reported, not crashed on.
+    for (size_t i = 0; i < buf.data_size; i++)
+    {
+        d = ugeneric_decode_binary(buf.data, i);
+        UASSERT(G_IS_ERROR(d));
+        ugeneric_error_destroy(d);
+    }
+    ubuffer_append_byte(&buf, G_NULL_T);
+    d = ugeneric_decode_binary(buf.data, buf.data_size);
+    UASSERT(G_IS_ERROR(d));
+    ugeneric_error_destroy(d);
+    ugeneric_destroy(g);
+
+    // Memchunks are stored raw: tag, size and the bytes themselves.
+    ubuffer_reset(&buf);
+    ugeneric_encode_binary(G_MEMCHUNK("\xff\x00\xbb", 3), &buf);
+    UASSERT_SIZE_EQ(buf.data_size, 5);
+    UASSERT(memcmp(buf.data, "\x0c\x03\xff\x00\xbb", 5) == 0);
+
+    // Strings reference the encoded data.
+    ubuffer_reset(&buf);
+    ugeneric_encode_binary(G_CSTR("hello"), &buf);
+    d = ugeneric_decode_binary(buf.data, buf.data_size);
+    UASSERT(G_IS_CSTR(d));
+    UASSERT_STR_EQ(G_AS_STR(d), "hello");
+    UASSERT(G_AS_STR(d) == (char *)buf.data + 2);
+
+    // Nested one-item vectors, as deep as allowed and deeper.
+    size_t depths[] = {UGENERIC_BINARY_MAX_DEPTH, UGENERIC_BINARY_MAX_DEPTH + 1,
+                       4 * 1024 * 1024};
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++)
+    {
+        ubuffer_reset(&buf);
+        for (size_t j = 0; j < depths[i]; j++)
+        {
+            ubuffer_append_byte(&buf, G_VECTOR_T);
+            ubuffer_append_byte(&buf, 1);
+        }
+        ubuffer_append_byte(&buf, G_NULL_T);
+        d = ugeneric_decode_binary(buf.data, buf.data_size);
+        if (depths[i] > UGENERIC_BINARY_MAX_DEPTH)
+        {
+            UASSERT(G_IS_ERROR(d));
+            ugeneric_error_destroy(d);
+        }
+        else
+        {
+            UASSERT_NO_ERROR(d);
+            ugeneric_destroy(d);
+        }
+    }
+
+    ubuffer_destroy(&buf);
+}
+
+void test_parse_with_arena(void)
+{
+    const char *in = "{\"a\": [1, 2.5, \"x\\ny\", mem:00ff, null], "
+                     "\"b\": {\"c\": true}, \"a\": [3]}";
+    uarena_t *a = uarena_create();
+
+    ugeneric_t g = ugeneric_parse_with_arena(in, a);
+    UASSERT(!G_IS_ERROR(g));
+    ugeneric_t h = ugeneric_parse(in);
+    UASSERT(ugeneric_compare(g, h) == 0);
+    ugeneric_destroy(h);
+
+    char *str = ugeneric_as_str(g);
+    UASSERT_STR_EQ(str, "{\"a\": [3], \"b\": {\"c\": true}}");
+    ufree(str);
+
+    // Partially parsed items stay on the arena.
+    g = ugeneric_parse_with_arena("[\"x\", {\"k\": [1, 2}]", a);
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+
+    g = ugeneric_parse_with_arena("\"just a string\"", a);
+    UASSERT_STR_EQ(G_AS_STR(g), "just a string");
+
+    uarena_destroy(a);
+}
+
 int main(int argc, char **argv)
 {
 
@@ -419,6 +556,9 @@ int main(int argc, char **argv)
     test_parse();
     test_large_parse();
     test_serialize();
+    test_string_escaping();
     test_parse_size();
     test_generic_cmp();
+    test_binary();
+    test_parse_with_arena();
 }
@@ -100,7 +100,7 @@ void test_uheap_api(void)
     uheap_destroy(h);
 
     // Max heap
-    h = uheap_create_ext(1, UHEAP_TYPE_MAX);
+    h = uheap_create_ext(1, UHEAP_TYPE_MAX, NULL);
     uheap_push(h, G_INT(100));
     UASSERT_INT_EQ(G_AS_INT(uheap_peek(h)), 100);
     uheap_push(h, G_INT(-1));
@@ -143,8 +143,8 @@ void test_running_median(void)
     UASSERT_NO_ERROR(tmp);
     uvector_t *v = G_AS_PTR(tmp);
 
-    uheap_t *lheap = uheap_create_ext(5005, UHEAP_TYPE_MAX);
-    uheap_t *rheap = uheap_create_ext(5005, UHEAP_TYPE_MIN);
+    uheap_t *lheap = uheap_create_ext(5005, UHEAP_TYPE_MAX, NULL);
+    uheap_t *rheap = uheap_create_ext(5005, UHEAP_TYPE_MIN, NULL);
 
     long sum = 0;
     size_t vlen = uvector_get_size(v);
@@ -1,9 +1,17 @@
 #include "mem.h"
 
+#include "dict.h"
+#include "graph.h"
+#include "heap.h"
+#include "htbl.h"
+#include "list.h"
+#include "queue.h"
+#include "stack.h"
 #include "string_utils.h"
 #include "ut_utils.h"
 #include "vector.h"
 #include <limits.h>
+#include <pthread.h>
 
 /* to disable linux overcommit "sysctl vm.overcommit_memory=2" */
 
@@ -68,10 +76,483 @@ void test_memchunk(void)
     uvector_destroy(v);
 }
 
+void test_arena(void)
+{
+    uarena_t *a = uarena_create_with_block_size(1024);
+
+    char *p1 = uarena_alloc(a, 1);
+    char *p2 = uarena_alloc(a, 3);
+    UASSERT((uintptr_t)p1 % _Alignof(max_align_t) == 0);
+    UASSERT((uintptr_t)p2 % _Alignof(max_align_t) == 0);
+    UASSERT(p1 != p2);
+
+    // The last allocation grows in place, others get moved.
+    memcpy(p2, "ab", 3);
+    UASSERT(uarena_realloc(a, p2, 3, 100) == p2);
+    char *p3 = uarena_realloc(a, p1, 1, 10);
+    UASSERT(p3 != p1);
+    UASSERT_STR_EQ(p2, "ab");
+
+    // Too big for a regular block, allocation goes to its own one.
+    char *big = uarena_alloc(a, 4096);
+    memset(big, 1, 4096);
+    char *p4 = uarena_alloc(a, 8);
+    UASSERT(p4 == p3 + _Alignof(max_align_t) * ((10 + _Alignof(max_align_t) - 1) / _Alignof(max_align_t)));
+
+    char *s = uarena_strdup(a, "string");
+    UASSERT_STR_EQ(s, "string");
+    UASSERT(uarena_get_allocated_size(a) >= 4096 + 100 + 10 + 8 + 7);
+
+    uarena_reset(a);
+    UASSERT_SIZE_EQ(uarena_get_allocated_size(a), 0);
+    UASSERT(uarena_alloc(a, 1) == p1);
+
+    uarena_destroy(a);
+}
+
+void test_containers_on_arena(void)
+{
+    uarena_t *a = uarena_create();
+
+    uvector_t *v = uvector_create_with_arena(a);
+    for (int i = 0; i < 10000; i++)
+    {
+        uvector_append(v, G_INT(i));
+    }
+    UASSERT_SIZE_EQ(uvector_get_size(v), 10000);
+    UASSERT_INT_EQ(G_AS_INT(uvector_get_at(v, 9999)), 9999);
+
+    for (int b = UDICT_BACKEND_DEFAULT; b < UDICT_BACKEND_MAX; b++)
+    {
+        udict_t *d = udict_create_with_arena(b, a);
+        for (int i = 0; i < 1000; i++)
+        {
+            udict_put(d, G_INT(i), G_INT(i * 2));
+        }
+        UASSERT_SIZE_EQ(udict_get_size(d), 1000);
+        UASSERT_INT_EQ(G_AS_INT(udict_get(d, G_INT(500), G_NULL())), 1000);
+        UASSERT(G_IS_NULL(udict_get(d, G_INT(1000), G_NULL())));
+    }
+
+    ulist_t *l = ulist_create_with_arena(a);
+    ulist_append(l, G_STR(uarena_strdup(a, "a")));
+    ulist_prepend(l, G_STR(uarena_strdup(a, "b")));
+    ulist_drop_data_ownership(l);
+    char *str = ulist_as_str(l);
+    UASSERT_STR_EQ(str, "[\"b\", \"a\"]");
+    ufree(str);
+
+    // Nothing is destroyed individually.
+    uarena_destroy(a);
+}
+
+void test_copies_of_arena_containers(void)
+{
+    uarena_t *a = uarena_create();
+    ugeneric_t g = ugeneric_parse_with_arena("[\"a\", {\"b\": [1, \"c\"]}]", a);
+    UASSERT_NO_ERROR(g);
+    char *expected = ugeneric_as_str(g);
+
+    // Copies of anything on the arena are heap objects and outlive it.
+    ugeneric_t copy = ugeneric_copy(g);
+    uvector_t *cow = uvector_cow_copy(G_AS_PTR(g));
+    ugeneric_t d = uvector_get_at(G_AS_PTR(g), 1);
+    udict_t *dcow = udict_cow_copy(G_AS_PTR(d));
+    UASSERT(uvector_get_allocator(G_AS_PTR(copy)) == uallocator_get_default());
+    UASSERT(uvector_get_allocator(cow) == uallocator_get_default());
+
+    ulist_t *l = ulist_create_with_arena(a);
+    ulist_append(l, G_INT(1));
+    ulist_t *lcopy = ulist_copy(l);
+    uvector_t *slice = uvector_get_slice(G_AS_PTR(g), 0, 1, 1);
+    uarena_reset(a);
+
+    char *str = ugeneric_as_str(copy);
+    UASSERT_STR_EQ(str, expected);
+    ufree(str);
+    str = uvector_as_str(cow);
+    UASSERT_STR_EQ(str, expected);
+    ufree(str);
+    str = udict_as_str(dcow);
+    UASSERT_STR_EQ(str, "{\"b\": [1, \"c\"]}");
+    ufree(str);
+    UASSERT_SIZE_EQ(ulist_get_size(lcopy), 1);
+    UASSERT_SIZE_EQ(uvector_get_size(slice), 1);
+
+    ufree(expected);
+    ugeneric_destroy(copy);
+    uvector_destroy(cow);
+    udict_destroy(dcow);
+    ulist_destroy(lcopy);
+    uvector_destroy(slice);
+    uarena_destroy(a);
+}
+
+void test_pool(void)
+{
+    typedef struct {
+        ugeneric_t g;
+        char c;
+    } object_t;
+
+    void *objects[1000];
+    upool_t *p = upool_create(sizeof(object_t), NULL);
+
+    for (size_t i = 0; i < ARRAY_LEN(objects); i++)
+    {
+        object_t *o = objects[i] = upool_alloc(p);
+        UASSERT((uintptr_t)o % _Alignof(object_t) == 0);
+        o->g = G_SIZE(i);
+        o->c = i;
+    }
+    for (size_t i = 0; i < ARRAY_LEN(objects); i++)
+    {
+        object_t *o = objects[i];
+        UASSERT_SIZE_EQ(G_AS_SIZE(o->g), i);
+        UASSERT_INT_EQ(o->c, (char)i);
+    }
+
+    // Freed objects are reused before anything else.
+    upool_free(p, objects[10]);
+    upool_free(p, objects[20]);
+    UASSERT(upool_alloc(p) == objects[20]);
+    UASSERT(upool_alloc(p) == objects[10]);
+
+    upool_reset(p);
+    UASSERT(upool_alloc(p) != NULL);
+    upool_destroy(p);
+
+    // Smaller than a pointer still works.
+    p = upool_create(1, NULL);
+    char *c1 = upool_alloc(p);
+    char *c2 = upool_alloc(p);
+    UASSERT(c2 - c1 == sizeof(void *));
+    upool_destroy(p);
+}
+
+typedef struct {
+    size_t allocs;
+    size_t frees;
+    size_t in_use;
+} counting_ctx_t;
+
+static void *_counting_alloc(void *ctx, size_t size)
+{
+    counting_ctx_t *c = ctx;
+    c->allocs++;
+    c->in_use += size;
+    return umalloc(size);
+}
+
+static void *_counting_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+    counting_ctx_t *c = ctx;
+    c->allocs += !ptr;
+    c->in_use += size - old_size;
+    return urealloc(ptr, size);
+}
+
+static void _counting_free(void *ctx, void *ptr, size_t size)
+{
+    counting_ctx_t *c = ctx;
+    c->frees++;
+    c->in_use -= size;
+    ufree(ptr);
+}
+
+void test_custom_allocator(void)
+{
+    counting_ctx_t c = {0};
+    uallocator_t a = {
+        .alloc = _counting_alloc,
+        .realloc = _counting_realloc,
+        .free = _counting_free,
+        .ctx = &c,
+    };
+
+    uvector_t *v = uvector_create_ext(&a);
+    for (int i = 0; i < 100; i++)
+    {
+        uvector_append(v, G_INT(i));
+    }
+    uvector_t *slice = uvector_get_slice(v, 10, 90, 3);
+    uvector_t *vcopy = uvector_copy(v);
+    UASSERT(uvector_get_allocator(vcopy) == &a);
+
+    ulist_t *l = ulist_create_ext(&a);
+    ulist_append(l, G_INT(1));
+    ulist_append(l, G_INT(2));
+    ulist_iterator_t *li = ulist_iterator_create(l);
+    UASSERT_INT_EQ(G_AS_INT(ulist_iterator_get_next(li)), 1);
+    ulist_iterator_destroy(li);
+    ulist_t *lcopy = ulist_copy(l);
+
+    for (int b = UDICT_BACKEND_DEFAULT; b < UDICT_BACKEND_MAX; b++)
+    {
+        udict_t *d = udict_create_ext(b, &a);
+        for (int i = 0; i < 100; i++)
+        {
+            udict_put(d, G_INT(i), G_INT(i));
+        }
+        udict_t *dcopy = udict_copy(d);
+        UASSERT(udict_compare(d, dcopy) == 0);
+        udict_iterator_t *di = udict_iterator_create(d);
+        size_t n = 0;
+        while (udict_iterator_has_next(di))
+        {
+            udict_iterator_get_next(di);
+            n++;
+        }
+        UASSERT_SIZE_EQ(n, 100);
+        udict_iterator_destroy(di);
+        udict_destroy(dcopy);
+        udict_destroy(d);
+    }
+
+    uheap_t *h = uheap_create_ext(4, UHEAP_TYPE_MIN, &a);
+    uqueue_t *q = uqueue_create_ext(&a);
+    ustack_t *s = ustack_create_ext(&a);
+    for (int i = 0; i < 100; i++)
+    {
+        uheap_push(h, G_INT(100 - i));
+        uqueue_enq(q, G_INT(i));
+        ustack_push(s, G_INT(i));
+    }
+    UASSERT_INT_EQ(G_AS_INT(uheap_pop(h)), 1);
+    UASSERT_INT_EQ(G_AS_INT(uqueue_deq(q)), 0);
+    UASSERT_INT_EQ(G_AS_INT(ustack_pop(s)), 99);
+
+    size_t allocs = c.allocs;
+    UASSERT(allocs > 0);
+    UASSERT(c.in_use > 0);
+
+    uvector_destroy(v);
+    uvector_destroy(slice);
+    uvector_destroy(vcopy);
+    ulist_destroy(l);
+    ulist_destroy(lcopy);
+    uheap_destroy(h);
+    uqueue_destroy(q);
+    ustack_destroy(s);
+
+    // Everything came from and went back to the allocator.
+    UASSERT_SIZE_EQ(c.allocs, allocs);
+    UASSERT_SIZE_EQ(c.allocs, c.frees);
+    UASSERT_SIZE_EQ(c.in_use, 0);
+}
+
+static void *_alloc_worker(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < 1000; i++)
+    {
+        uvector_t *v = uvector_create();
+        uvector_append(v, G_INT(i));
+        uvector_destroy(v);
+    }
+
+    return NULL;
+}
+
+void test_mem_stats(void)
+{
+    umem_stats_t before, after;
+
+    libugeneric_reset_mem_stats();
+    libugeneric_enable_mem_stats(true);
+    libugeneric_get_mem_stats(&before);
+    UASSERT_SIZE_EQ(before.allocs, 0);
+
+    uvector_t *v = uvector_create();
+    for (int i = 0; i < 1000; i++)
+    {
+        uvector_append(v, G_INT(i));
+    }
+    libugeneric_get_mem_stats(&after);
+    UASSERT(after.allocs > 1);
+    UASSERT(after.bytes_live >= uvector_get_capacity(v) * sizeof(ugeneric_t));
+    UASSERT(after.bytes_peak >= after.bytes_live);
+
+    size_t n = 0;
+    for (size_t i = 0; i < UMEM_SIZE_CLASSES; i++)
+    {
+        n += after.histogram[i];
+    }
+    UASSERT_SIZE_EQ(n, after.allocs);
+
+    uvector_destroy(v);
+    libugeneric_enable_mem_stats(false);
+    libugeneric_get_mem_stats(&after);
+    UASSERT_SIZE_EQ(after.bytes_live, 0);
+    UASSERT_SIZE_EQ(after.allocs, after.frees);
+
+    // Allocating threads, and a block older than the counting.
+    uvector_t *old = uvector_create_with_size(100, G_NULL());
+    libugeneric_reset_mem_stats();
+    libugeneric_enable_mem_stats(true);
+    pthread_t threads[4];
+    for (size_t i = 0; i < ARRAY_LEN(threads); i++)
+    {
+        UASSERT_INT_EQ(pthread_create(&threads[i], NULL, _alloc_worker, NULL), 0);
+    }
+    for (size_t i = 0; i < ARRAY_LEN(threads); i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    uvector_destroy(old);
+    libugeneric_enable_mem_stats(false);
+    libugeneric_get_mem_stats(&after);
+    UASSERT_SIZE_EQ(after.allocs, ARRAY_LEN(threads) * 2000);
+    UASSERT_SIZE_EQ(after.frees, after.allocs + 2);
+    UASSERT_SIZE_EQ(after.bytes_live, 0);
+
+    // A tracker sees only what is created with it.
+    umem_tracker_t t;
+    umem_tracker_init(&t, NULL);
+    udict_t *d = udict_create_ext(UDICT_BACKEND_HTBL_WITH_CHAINING, &t.allocator);
+    uvector_t *other = uvector_create();
+    for (int i = 0; i < 1000; i++)
+    {
+        udict_put(d, G_INT(i), G_INT(i));
+        uvector_append(other, G_INT(i));
+    }
+    UASSERT_SIZE_EQ(t.stats.bytes_live,
+                    umem_usage_get_total(udict_get_memory_usage(d)));
+    udict_destroy(d);
+    uvector_destroy(other);
+    UASSERT_SIZE_EQ(t.stats.bytes_live, 0);
+    UASSERT(t.stats.bytes_peak > 1000 * sizeof(ugeneric_kv_t));
+    UASSERT_SIZE_EQ(t.stats.allocs, t.stats.frees);
+}
+
+void test_memory_usage(void)
+{
+    uvector_t *v = uvector_create();
+    uvector_reserve_capacity(v, 10);
+    uvector_append(v, G_STR(ustring_dup("abc")));
+    uvector_append(v, G_MEMCHUNK(umemdup("12345", 5), 5));
+    uvector_append(v, G_INT(1));
+
+    umem_usage_t u = uvector_get_memory_usage(v);
+    UASSERT(u.header > 0);
+    UASSERT_SIZE_EQ(u.nodes, 0);
+    UASSERT_SIZE_EQ(u.buckets, 10 * sizeof(ugeneric_t));
+    UASSERT_SIZE_EQ(u.payload, 4 + 5);
+
+    // Nested containers are payload of the outer one.
+    uvector_t *outer = uvector_create();
+    uvector_append(outer, G_VECTOR(v));
+    u = uvector_get_memory_usage(outer);
+    UASSERT_SIZE_EQ(u.payload, umem_usage_get_total(uvector_get_memory_usage(v)));
+    UASSERT_SIZE_EQ(u.payload, ugeneric_get_memory_usage(G_VECTOR(v)));
+
+    // Borrowed items are not counted.
+    uvector_drop_data_ownership(outer);
+    UASSERT_SIZE_EQ(uvector_get_memory_usage(outer).payload, 0);
+    uvector_take_data_ownership(outer);
+    uvector_destroy(outer);
+
+    for (int b = UDICT_BACKEND_DEFAULT + 1; b < UDICT_BACKEND_MAX; b++)
+    {
+        udict_t *d = udict_create_with_backend(b);
+        umem_usage_t empty = udict_get_memory_usage(d);
+        for (int i = 0; i < 100; i++)
+        {
+            udict_put(d, G_STR(ustring_fmt("%03d", i)), G_INT(i));
+        }
+        u = udict_get_memory_usage(d);
+        UASSERT_SIZE_EQ(u.header, empty.header);
+        UASSERT_SIZE_EQ(u.payload, 100 * 4);
+        UASSERT(u.nodes + u.buckets >= 100 * sizeof(ugeneric_kv_t));
+        udict_destroy(d);
+    }
+
+    ulist_t *l = ulist_create();
+    uqueue_t *q = uqueue_create();
+    uheap_t *h = uheap_create();
+    for (int i = 0; i < 100; i++)
+    {
+        ulist_append(l, G_INT(i));
+        uqueue_enq(q, G_INT(i));
+        uheap_push(h, G_INT(i));
+    }
+    UASSERT(ulist_get_memory_usage(l).nodes >= 100 * 2 * sizeof(void *));
+    UASSERT_SIZE_EQ(uqueue_get_memory_usage(q).buckets,
+                    uqueue_get_capacity(q) * sizeof(ugeneric_t));
+    UASSERT_SIZE_EQ(uheap_get_memory_usage(h).buckets,
+                    uheap_get_capacity(h) * sizeof(ugeneric_t));
+    ulist_destroy(l);
+    uqueue_destroy(q);
+    uheap_destroy(h);
+
+    ugraph_t *g = ugraph_create(10, UGRAPH_DIRECTED);
+    ugraph_add_edge(g, 0, 1, 1);
+    ugraph_add_edge(g, 1, 2, 1);
+    u = ugraph_get_memory_usage(g);
+    UASSERT_SIZE_EQ(u.payload, 2 * sizeof(ugraph_edge_t));
+    UASSERT(u.nodes > 0);
+    ugraph_destroy(g);
+}
+
+void test_hugepage_allocator(void)
+{
+    uhugepage_allocator_t hp;
+    uhugepage_allocator_init(&hp, NULL, 64 * 1024, UNUMA_NODE_ANY);
+
+    uvector_t *v = uvector_create_ext(&hp.allocator);
+    for (int i = 0; i < 100000; i++)
+    {
+        uvector_append(v, G_INT(i));
+    }
+    UASSERT(hp.bytes_mapped >= 100000 * sizeof(ugeneric_t));
+    UASSERT_SIZE_EQ(hp.bytes_mapped % HUGEPAGE_SIZE, 0);
+    UASSERT_INT_EQ(G_AS_INT(uvector_get_at(v, 99999)), 99999);
+
+    // Shrinking below the threshold moves cells back to the upstream.
+    uvector_t *vcopy = uvector_copy(v);
+    uvector_shrink_to_size(v);
+    uvector_resize(v, 10, G_NULL());
+    uvector_shrink_to_size(v);
+    UASSERT_INT_EQ(G_AS_INT(uvector_get_at(v, 9)), 9);
+    uvector_destroy(v);
+    for (int i = 0; i < 100000; i++)
+    {
+        UASSERT_INT_EQ(G_AS_INT(uvector_get_at(vcopy, i)), i);
+    }
+    uvector_destroy(vcopy);
+    UASSERT_SIZE_EQ(hp.bytes_mapped, 0);
+
+    uhugepage_allocator_init(&hp, NULL, 64 * 1024, 0);
+    uhtbl_t *h = uhtbl_create_ext(UHTBL_TYPE_OPEN_ADDRESSING, &hp.allocator);
+    uheap_t *heap = uheap_create_ext(0, UHEAP_TYPE_MIN, &hp.allocator);
+    for (int i = 0; i < 10000; i++)
+    {
+        uhtbl_put(h, G_INT(i), G_INT(-i));
+        uheap_push(heap, G_INT(10000 - i));
+    }
+    UASSERT(hp.bytes_mapped > 0);
+    for (int i = 0; i < 10000; i++)
+    {
+        UASSERT_INT_EQ(G_AS_INT(uhtbl_get(h, G_INT(i), G_NULL())), -i);
+    }
+    UASSERT_INT_EQ(G_AS_INT(uheap_peek(heap)), 1);
+    uhtbl_destroy(h);
+    uheap_destroy(heap);
+    UASSERT_SIZE_EQ(hp.bytes_mapped, 0);
+}
+
 int main(void)
 {
     test_umemdup();
     test_memchunk();
+    test_arena();
+    test_pool();
+    test_containers_on_arena();
+    test_copies_of_arena_containers();
+    test_custom_allocator();
+    test_mem_stats();
+    test_memory_usage();
+    test_hugepage_allocator();
 
     //test_oom();
 }
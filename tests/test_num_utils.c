@@ -0,0 +1,184 @@
+#include "num_utils.h"
+
+#include "string_utils.h"
+#include "ut_utils.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+
+#define _check(f, v, expected) do {                                         \
+    char __buf[UNUM_MAX_FORMATTED_LEN + 1];                                 \
+    __buf[f(v, __buf)] = '\0';                                              \
+    UASSERT_STR_EQ(__buf, expected);                                        \
+} while (0)
+
+void test_format_integers(void)
+{
+    _check(unum_format_long, 0, "0");
+    _check(unum_format_long, 7, "7");
+    _check(unum_format_long, -7, "-7");
+    _check(unum_format_long, 10, "10");
+    _check(unum_format_long, 99, "99");
+    _check(unum_format_long, 100, "100");
+    _check(unum_format_long, -12345, "-12345");
+    _check(unum_format_long, 1000000007, "1000000007");
+
+    char *s = ustring_fmt("%ld", LONG_MAX);
+    _check(unum_format_long, LONG_MAX, s);
+    ufree(s);
+    s = ustring_fmt("%ld", LONG_MIN);
+    _check(unum_format_long, LONG_MIN, s);
+    ufree(s);
+
+    _check(unum_format_size, 0, "0");
+    _check(unum_format_size, 188881, "188881");
+    s = ustring_fmt("%zu", SIZE_MAX);
+    _check(unum_format_size, SIZE_MAX, s);
+    ufree(s);
+}
+
+void test_format_real(void)
+{
+    _check(unum_format_real, 0.0, "0.0");
+    _check(unum_format_real, -0.0, "-0.0");
+    _check(unum_format_real, 1.0, "1.0");
+    _check(unum_format_real, 3.4, "3.4");
+    _check(unum_format_real, -0.7, "-0.7");
+    _check(unum_format_real, 0.1, "0.1");
+    _check(unum_format_real, 0.1 + 0.2, "0.30000000000000004");
+    _check(unum_format_real, 1.0 / 3, "0.3333333333333333");
+    _check(unum_format_real, -22.0 / 7, "-3.142857142857143");
+    _check(unum_format_real, 0.0001, "0.0001");
+    _check(unum_format_real, 0.00001, "1e-05");
+    _check(unum_format_real, 1e15, "1000000000000000.0");
+    _check(unum_format_real, 1e16, "1e+16");
+    _check(unum_format_real, 1.2e34, "1.2e+34");
+    _check(unum_format_real, 9007199254740993.0, "9007199254740992.0");
+    _check(unum_format_real, DBL_MAX, "1.7976931348623157e+308");
+    _check(unum_format_real, DBL_MIN, "2.2250738585072014e-308");
+    _check(unum_format_real, 5e-324, "5e-324");
+    _check(unum_format_real, INFINITY, "inf");
+    _check(unum_format_real, -INFINITY, "-inf");
+    _check(unum_format_real, NAN, "nan");
+}
+
+void test_real_round_trip(void)
+{
+    char buf[UNUM_MAX_FORMATTED_LEN + 1];
+
+    for (size_t i = 0; i < 100000; i++)
+    {
+        double d = ugeneric_random_from_range(-1000000, 1000000) /
+                   (double)ugeneric_random_from_range(1, 1000000);
+        buf[unum_format_real(d, buf)] = '\0';
+        UASSERT(strtod(buf, NULL) == d);
+    }
+}
+
+#define _check_real(str, expected, tail) do {                               \
+    const char *__s = str;                                                  \
+    ugeneric_t __g = unum_parse(&__s);                                      \
+    UASSERT(G_IS_REAL(__g));                                                \
+    UASSERT(G_AS_REAL(__g) == (expected));                                  \
+    UASSERT(signbit(G_AS_REAL(__g)) == signbit(expected));                  \
+    UASSERT_STR_EQ(__s, tail);                                              \
+} while (0)
+
+#define _check_error(str) do {                                              \
+    const char *__s = str;                                                  \
+    ugeneric_t __g = unum_parse(&__s);                                      \
+    UASSERT(G_IS_ERROR(__g));                                               \
+    UASSERT(__s == (str));                                                  \
+    ugeneric_error_destroy(__g);                                            \
+} while (0)
+
+void test_parse_integers(void)
+{
+    const char *s = "42,";
+    ugeneric_t g = unum_parse(&s);
+    UASSERT(G_IS_INT(g));
+    UASSERT(G_AS_INT(g) == 42);
+    UASSERT_STR_EQ(s, ",");
+
+    s = "-0";
+    g = unum_parse(&s);
+    UASSERT(G_IS_INT(g));
+    UASSERT(G_AS_INT(g) == 0);
+
+    char *t = ustring_fmt("%ld", LONG_MIN);
+    s = t;
+    g = unum_parse(&s);
+    UASSERT(G_IS_INT(g));
+    UASSERT(G_AS_INT(g) == LONG_MIN);
+    ufree(t);
+
+    t = ustring_fmt("%zu", SIZE_MAX);
+    s = t;
+    g = unum_parse(&s);
+    UASSERT(G_IS_SIZE(g));
+    UASSERT(G_AS_SIZE(g) == SIZE_MAX);
+    ufree(t);
+
+    _check_error("184467440737095516150");
+    _check_error("-9223372036854775809");
+    _check_error("-");
+    _check_error("--3");
+    _check_error(".");
+    _check_error("e5");
+}
+
+void test_parse_real(void)
+{
+    _check_real("0.0", 0.0, "");
+    _check_real("-0.0", -0.0, "");
+    _check_real("1.", 1.0, "");
+    _check_real("-.5]", -0.5, "]");
+    _check_real("3.4e", 3.4, "e");
+    _check_real("3.0e+x", 3.0, "e+x");
+    _check_real("0.1", 0.1, "");
+    _check_real("1e23", 1e23, "");
+    _check_real("1E-7", 1e-7, "");
+    _check_real("9007199254740993.0", 9007199254740992.0, "");
+    _check_real("9007199254740995.0", 9007199254740996.0, "");
+    _check_real("2.2250738585072011e-308", 2.2250738585072009e-308, "");
+    _check_real("2.2250738585072014e-308", DBL_MIN, "");
+    _check_real("1.7976931348623157e308", DBL_MAX, "");
+    _check_real("4.9406564584124654e-324", 5e-324, "");
+    _check_real("2.4703282292062328e-324", 5e-324, "");
+    _check_real("2.4703282292062327e-324", 0.0, "");
+    _check_real("1e-400", 0.0, "");
+    _check_real("0.000000000000000000000000000000000000000000001e45", 1.0, "");
+    _check_real("7.2057594037927933e16", 72057594037927936.0, "");
+    _check_error("1e309");
+    _check_error("-1.8e308");
+}
+
+void test_parse_round_trip(void)
+{
+    char buf[UNUM_MAX_FORMATTED_LEN + 1];
+
+    for (size_t i = 0; i < 100000; i++)
+    {
+        double d = ugeneric_random_from_range(-1000000, 1000000) /
+                   (double)ugeneric_random_from_range(1, 1000000);
+        d = ldexp(d, (int)ugeneric_random_from_range(-1060, 1000));
+        buf[unum_format_real(d, buf)] = '\0';
+        const char *s = buf;
+        ugeneric_t g = unum_parse(&s);
+        UASSERT(G_IS_REAL(g));
+        UASSERT(G_AS_REAL(g) == d);
+        UASSERT(*s == '\0');
+    }
+}
+
+int main(void)
+{
+    test_format_integers();
+    test_format_real();
+    test_real_round_trip();
+    test_parse_integers();
+    test_parse_real();
+    test_parse_round_trip();
+
+    return EXIT_SUCCESS;
+}
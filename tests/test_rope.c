@@ -0,0 +1,120 @@
+#include "rope.h"
+
+#include "file_utils.h"
+#include "string_utils.h"
+#include "ut_utils.h"
+#include "vector.h"
+
+#define ROPE_PATH "ttt_rope"
+
+void test_rope_append(void)
+{
+    urope_t *r = urope_create_with_segment_size(4);
+    UASSERT_SIZE_EQ(urope_get_size(r), 0);
+    UASSERT_SIZE_EQ(urope_get_segment_count(r), 0);
+
+    urope_append_string(r, "ab");
+    urope_append_string(r, "cdefghij");
+    urope_append_data(r, "", 0);
+    urope_append_string(r, "k");
+    UASSERT_SIZE_EQ(urope_get_size(r), 11);
+    UASSERT_SIZE_EQ(urope_get_segment_count(r), 3);
+
+    umemchunk_t m = urope_get_segment(r, 1);
+    UASSERT_SIZE_EQ(m.size, 4);
+    UASSERT(memcmp(m.data, "efgh", 4) == 0);
+
+    char *str = urope_as_str(r);
+    UASSERT_STR_EQ(str, "abcdefghijk");
+    ufree(str);
+
+    urope_clear(r);
+    UASSERT_SIZE_EQ(urope_get_size(r), 0);
+    str = urope_as_str(r);
+    UASSERT_STR_EQ(str, "");
+    ufree(str);
+
+    urope_destroy(r);
+}
+
+void test_rope_serialize(void)
+{
+    uvector_t *v = uvector_create();
+    for (int i = 0; i < 10000; i++)
+    {
+        uvector_append(v, G_STR(ustring_fmt("item #%d", i)));
+    }
+
+    urope_t *r = urope_create_with_segment_size(1024);
+    urope_serialize(r, G_VECTOR(v));
+
+    // Serializer output lands in segments directly, no copy of a whole.
+    char *expected = uvector_as_str(v);
+    char *str = urope_as_str(r);
+    UASSERT_STR_EQ(str, expected);
+    UASSERT(urope_get_segment_count(r) > 100);
+    ufree(str);
+
+    // Segments taken from the buffer can still be appended to.
+    urope_append_string(r, "!");
+    str = urope_as_str(r);
+    UASSERT_SIZE_EQ(strlen(str), strlen(expected) + 1);
+    UASSERT(str[strlen(expected)] == '!');
+    ufree(str);
+
+    // Attached buffer works as a plain one for the serializers.
+    ubuffer_t buf = {0};
+    urope_clear(r);
+    urope_attach_buffer(r, &buf);
+    for (int i = 0; i < 1000; i++)
+    {
+        ubuffer_append_string(&buf, "0123456789");
+    }
+    urope_detach_buffer(r, &buf);
+    UASSERT(buf.data == NULL);
+    UASSERT_SIZE_EQ(urope_get_size(r), 10000);
+
+    ufree(expected);
+    urope_destroy(r);
+    uvector_destroy(v);
+}
+
+void test_rope_writev(void)
+{
+    urope_t *r = urope_create_with_segment_size(100);
+    for (int i = 0; i < 10000; i++)
+    {
+        urope_append_string(r, "abcdefg");
+    }
+
+    ugeneric_t g = ufile_writer_create(ROPE_PATH);
+    UASSERT_NO_ERROR(g);
+    ufile_writer_t *fw = G_AS_PTR(g);
+    UASSERT_NO_ERROR(ufile_writer_write(fw, (umemchunk_t){"head:", 5}));
+    UASSERT_NO_ERROR(ufile_writer_write_rope(fw, r));
+    UASSERT_NO_ERROR(ufile_writer_write(fw, (umemchunk_t){":tail", 5}));
+    UASSERT_NO_ERROR(ufile_writer_destroy(fw));
+
+    g = ufile_read_to_string(ROPE_PATH);
+    UASSERT_NO_ERROR(g);
+    char *str = G_AS_STR(g);
+    char *body = urope_as_str(r);
+    UASSERT_SIZE_EQ(strlen(str), 5 + urope_get_size(r) + 5);
+    UASSERT(strncmp(str, "head:", 5) == 0);
+    UASSERT(strncmp(str + 5, body, urope_get_size(r)) == 0);
+    UASSERT_STR_EQ(str + 5 + urope_get_size(r), ":tail");
+    ufree(body);
+    ugeneric_destroy(g);
+
+    urope_destroy(r);
+    remove(ROPE_PATH);
+}
+
+int main(void)
+{
+    test_rope_append();
+    test_rope_serialize();
+    test_rope_writev();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#include "snapshot.h"
+
+#include "dict.h"
+#include "file_utils.h"
+#include "string_utils.h"
+#include "ut_utils.h"
+#include "vector.h"
+
+#define SNAPSHOT_PATH "ttt_snapshot"
+
+void test_snapshot_round_trip(void)
+{
+    ugeneric_t g = ugeneric_parse("{\"key\": [null, -1, 2, 3.4, 188881, false, true, [], {}, mem:ffaabb, mem:], "
+                                  "\"\": -9223372036854775808, \"x\": 18446744073709551615, "
+                                  "\"y\": [-0.0, 1e-300, \"str\", {\"a\": {\"b\": []}}]}");
+    UASSERT_NO_ERROR(g);
+    UASSERT_NO_ERROR(usnapshot_write(SNAPSHOT_PATH, g));
+
+    ugeneric_t r = usnapshot_open(SNAPSHOT_PATH);
+    UASSERT_NO_ERROR(r);
+    usnapshot_t *s = G_AS_PTR(r);
+
+    ugeneric_t root = usnapshot_get_root(s);
+    UASSERT(usnapshot_get_type(s, root) == G_DICT_T);
+    UASSERT_SIZE_EQ(usnapshot_get_size(s, root), 4);
+
+    ugeneric_t v = usnapshot_dict_get(s, root, G_CSTR("key"), G_NULL());
+    UASSERT(usnapshot_get_type(s, v) == G_VECTOR_T);
+    UASSERT_SIZE_EQ(usnapshot_get_size(s, v), 11);
+    UASSERT_INT_EQ(G_AS_INT(usnapshot_vector_get_at(s, v, 1)), -1);
+    UASSERT(usnapshot_get_type(s, usnapshot_vector_get_at(s, v, 7)) == G_VECTOR_T);
+    UASSERT_SIZE_EQ(usnapshot_get_size(s, usnapshot_vector_get_at(s, v, 8)), 0);
+
+    ugeneric_t m = usnapshot_vector_get_at(s, v, 9);
+    UASSERT(G_IS_MEMCHUNK(m));
+    UASSERT_SIZE_EQ(G_AS_MEMCHUNK_SIZE(m), 3);
+    UASSERT(memcmp(G_AS_MEMCHUNK_DATA(m), "\xff\xaa\xbb", 3) == 0);
+
+    ugeneric_t x = usnapshot_dict_get(s, root, G_SIZE(0), G_CSTR("default"));
+    UASSERT_STR_EQ(G_AS_STR(x), "default");
+    x = usnapshot_dict_get(s, root, G_CSTR("x"), G_NULL());
+    UASSERT(G_IS_SIZE(x));
+    UASSERT_SIZE_EQ(G_AS_SIZE(x), SIZE_MAX);
+
+    ugeneric_t y = usnapshot_dict_get(s, root, G_CSTR("y"), G_NULL());
+    ugeneric_t str = usnapshot_vector_get_at(s, y, 2);
+    UASSERT(G_IS_CSTR(str));
+    UASSERT_STR_EQ(G_AS_STR(str), "str");
+
+    ugeneric_t loaded = usnapshot_load(s, root);
+    UASSERT(G_IS_DICT(loaded));
+    UASSERT(ugeneric_compare(g, loaded) == 0);
+
+    char *s1 = ugeneric_as_str(g);
+    char *s2 = ugeneric_as_str(loaded);
+    UASSERT_STR_EQ(s1, s2);
+    ufree(s1);
+    ufree(s2);
+
+    UASSERT_NO_ERROR(usnapshot_close(s));
+    ugeneric_destroy(loaded);
+    ugeneric_destroy(g);
+    remove(SNAPSHOT_PATH);
+}
+
+void test_snapshot_large_dict(void)
+{
+    udict_t *d = udict_create();
+    for (long i = 0; i < 100000; i++)
+    {
+        udict_put(d, G_INT(i), G_STR(ustring_fmt("%ld", i)));
+    }
+    UASSERT_NO_ERROR(usnapshot_write(SNAPSHOT_PATH, G_DICT(d)));
+
+    ugeneric_t r = usnapshot_open(SNAPSHOT_PATH);
+    UASSERT_NO_ERROR(r);
+    usnapshot_t *s = G_AS_PTR(r);
+    ugeneric_t root = usnapshot_get_root(s);
+
+    for (long i = 0; i < 100000; i++)
+    {
+        ugeneric_t v = usnapshot_dict_get(s, root, G_INT(i), G_NULL());
+        UASSERT(ugeneric_compare(v, udict_get(d, G_INT(i), G_NULL())) == 0);
+    }
+    UASSERT(G_IS_NULL(usnapshot_dict_get(s, root, G_INT(-1), G_NULL())));
+
+    UASSERT_NO_ERROR(usnapshot_close(s));
+    udict_destroy(d);
+    remove(SNAPSHOT_PATH);
+}
+
+static umemchunk_t snapshot_of(ugeneric_t g)
+{
+    UASSERT_NO_ERROR(usnapshot_write(SNAPSHOT_PATH, g));
+    ugeneric_t m = ufile_read_to_memchunk(SNAPSHOT_PATH);
+    UASSERT_NO_ERROR(m);
+    remove(SNAPSHOT_PATH);
+    return G_AS_MEMCHUNK(m);
+}
+
+void test_snapshot_reproducible(void)
+{
+    // Constructors of scalars leave the rest of the type word as it was.
+    ugeneric_t dirty;
+    memset(&dirty, 0xff, sizeof(dirty));
+    dirty.t.type = G_INT_T;
+    dirty.v.integer = 6;
+
+    uvector_t *v = uvector_create();
+    uvector_append(v, dirty);
+    umemchunk_t m1 = snapshot_of(G_VECTOR(v));
+    uvector_set_at(v, 0, G_INT(6));
+    umemchunk_t m2 = snapshot_of(G_VECTOR(v));
+    UASSERT_SIZE_EQ(m1.size, m2.size);
+    UASSERT(memcmp(m1.data, m2.data, m1.size) == 0);
+
+    ufree(m1.data);
+    ufree(m2.data);
+    uvector_destroy(v);
+}
+
+void test_snapshot_errors(void)
+{
+    ugeneric_t g = usnapshot_open("utdata/non_existent");
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+
+    g = usnapshot_open("utdata/json.json");
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+
+    g = usnapshot_open("utdata/empty");
+    UASSERT(G_IS_ERROR(g));
+    ugeneric_error_destroy(g);
+}
+
+int main(void)
+{
+    test_snapshot_round_trip();
+    test_snapshot_large_dict();
+    test_snapshot_reproducible();
+    test_snapshot_errors();
+
+    return EXIT_SUCCESS;
+}
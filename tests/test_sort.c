@@ -3,8 +3,11 @@
 #include "file_utils.h"
 #include "generic.h"
 #include "sort.h"
+#include "string_utils.h"
 #include "ut_utils.h"
 #include "vector.h"
+#include <limits.h>
+#include <math.h>
 
 void print_array(ugeneric_t *base, size_t nmemb);
 typedef void (*sort_func)(ugeneric_t *base, size_t nmemb, void_cmp_t cmp);
@@ -229,6 +232,496 @@ void test_count_iversions(void)
     UASSERT_LLINT_EQ(2407905288, count_inversions(f, ARRAY_LEN(f), NULL));
 }
 
+static void _check_radix_sort(uvector_t *v)
+{
+    uvector_t *expected = uvector_copy(v);
+    hybrid_sort(uvector_get_cells(expected), uvector_get_size(expected), NULL);
+    radix_sort(uvector_get_cells(v), uvector_get_size(v), NULL);
+    UASSERT(uvector_compare(expected, v) == 0);
+    uvector_destroy(expected);
+}
+
+void test_radix_sort(void)
+{
+    size_t n = 10000;
+    uvector_t *vi = uvector_create();
+    uvector_t *vs = uvector_create();
+    uvector_t *vr = uvector_create();
+    uvector_t *vstr = uvector_create();
+    for (size_t i = 0; i < n; i++)
+    {
+        long r = ugeneric_random_from_range(-100000, 100000);
+        uvector_append(vi, G_INT(r * ((i % 3) ? 1 : 100000000)));
+        uvector_append(vs, G_SIZE((size_t)r * 7919));
+        uvector_append(vr, G_REAL((i % 100) ? r / 7.0 : -0.0));
+        uvector_append(vstr, G_STR(ustring_fmt("%s%ld", (i % 2) ? "x" : "", r % 1000)));
+    }
+    uvector_append(vi, G_INT(LONG_MIN));
+    uvector_append(vi, G_INT(LONG_MAX));
+    uvector_append(vstr, G_CSTR(""));
+
+    _check_radix_sort(vi);
+    _check_radix_sort(vs);
+    _check_radix_sort(vr);
+    _check_radix_sort(vstr);
+    uvector_destroy(vi);
+    uvector_destroy(vs);
+    uvector_destroy(vr);
+
+    // -0.0 equals 0.0, zeros keep the order of their signs.
+    vr = uvector_create();
+    for (size_t i = 0; i < n; i++)
+    {
+        uvector_append(vr, G_REAL((i % 2) ? (i % 3) - 1.0 : ((i % 7) ? 0.0 : -0.0)));
+    }
+    radix_sort(uvector_get_cells(vr), uvector_get_size(vr), NULL);
+    UASSERT(uvector_is_sorted(vr));
+    for (size_t i = 0, j = 0; i < n; i++)
+    {
+        double d = G_AS_REAL(uvector_get_at(vr, i));
+        if (d == 0.0)
+        {
+            while (((j % 2) ? (j % 3) - 1.0 : 0.0) != 0.0)
+            {
+                j++;
+            }
+            UASSERT((bool)signbit(d) == ((j % 2 == 0) && (j % 7 == 0)));
+            j++;
+        }
+    }
+    uvector_destroy(vr);
+
+    // Equal strings keep their order, here it's the order of addresses.
+    char *buf = umalloc(n * 8);
+    uvector_t *v = uvector_create();
+    uvector_drop_data_ownership(v);
+    for (size_t i = 0; i < n; i++)
+    {
+        sprintf(buf + i * 8, "%d", ugeneric_random_from_range(0, 500));
+        uvector_append(v, G_STR(buf + i * 8));
+    }
+    uvector_sort(v);
+    UASSERT(uvector_is_sorted(v));
+    for (size_t i = 1; i < n; i++)
+    {
+        const char *prev = G_AS_STR(uvector_get_at(v, i - 1));
+        const char *cur = G_AS_STR(uvector_get_at(v, i));
+        UASSERT((strcmp(prev, cur) < 0) || (prev < cur));
+    }
+    uvector_destroy(v);
+    uvector_destroy(vstr);
+    ufree(buf);
+
+    // Long shared prefixes don't take stack, identical strings neither.
+    size_t len = 100000;
+    char *prefix = umalloc(len + 1);
+    memset(prefix, 'p', len);
+    prefix[len] = '\0';
+    vstr = uvector_create();
+    for (size_t i = 0; i < 300; i++)
+    {
+        if (i % 3)
+        {
+            uvector_append(vstr, G_STR(ustring_fmt("%s%zu", prefix, i % 37)));
+        }
+        else
+        {
+            uvector_append(vstr, G_STR(ustring_dup(prefix)));
+        }
+    }
+    _check_radix_sort(vstr);
+    uvector_sort(vstr);
+    UASSERT(uvector_is_sorted(vstr));
+    uvector_destroy(vstr);
+    ufree(prefix);
+
+    // Mixed types fall back to the comparison sort.
+    v = uvector_create();
+    uvector_append(v, G_REAL(2.5));
+    for (long i = 100; i > 0; i--)
+    {
+        uvector_append(v, G_INT(i));
+    }
+    radix_sort(uvector_get_cells(v), uvector_get_size(v), NULL);
+    UASSERT(uvector_is_sorted(v));
+    uvector_destroy(v);
+}
+
+static size_t _comparisons;
+
+static int _cmp_counting(const void *p1, const void *p2)
+{
+    long a = *(const long *)p1;
+    long b = *(const long *)p2;
+    _comparisons++;
+    return (a > b) - (a < b);
+}
+
+void test_pdq_sort(void)
+{
+    const size_t n = 50000;
+    long *data = umalloc(n * sizeof(data[0]));
+
+    for (int pattern = 0; pattern < 8; pattern++)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            switch (pattern)
+            {
+                case 0: data[i] = i; break;                       // sorted
+                case 1: data[i] = n - i; break;                   // reversed
+                case 2: data[i] = 7; break;                       // all equal
+                case 3: data[i] = (i < n / 2) ? i : n - i; break; // organ pipe
+                case 4: data[i] = i % 100; break;                 // sawtooth
+                case 5: data[i] = ugeneric_random_from_range(0, 3); break;
+                case 6: data[i] = (i % 2) ? i : n - i; break;     // interleaved
+                default: data[i] = ugeneric_random_from_range(0, n); break;
+            }
+        }
+
+        uvector_t *v = uvector_create();
+        uvector_drop_data_ownership(v);
+        uvector_set_void_comparator(v, _cmp_counting);
+        for (size_t i = 0; i < n; i++)
+        {
+            uvector_append(v, G_PTR(&data[i]));
+        }
+        uvector_t *expected = uvector_copy(v);
+        merge_sort(uvector_get_cells(expected), n, _cmp_counting);
+
+        _comparisons = 0;
+        pdq_sort(uvector_get_cells(v), n, _cmp_counting);
+        UASSERT(_comparisons < 3 * n * 16); // n log n, not n^2
+        if (pattern < 3)
+        {
+            UASSERT(_comparisons < 2 * n); // runs are detected
+        }
+        UASSERT(uvector_is_sorted(v));
+        UASSERT(uvector_compare(v, expected) == 0);
+        uvector_destroy(expected);
+        uvector_destroy(v);
+    }
+    ufree(data);
+}
+
+typedef struct {
+    long key;
+    size_t seq;
+} keyed_t;
+
+static int _cmp_keyed(const void *p1, const void *p2)
+{
+    long a = ((const keyed_t *)p1)->key;
+    long b = ((const keyed_t *)p2)->key;
+    _comparisons++;
+    return (a > b) - (a < b);
+}
+
+void test_tim_sort(void)
+{
+    const size_t n = 50000;
+    keyed_t *data = umalloc(n * sizeof(data[0]));
+    ugeneric_t *a = umalloc(n * sizeof(a[0]));
+
+    for (int pattern = 0; pattern < 4; pattern++)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            switch (pattern)
+            {
+                case 0: data[i].key = i; break;
+                case 1: data[i].key = n - i; break;
+                case 2: // timestamps with a few stragglers
+                    data[i].key = i * 10;
+                    if (i % 1000 == 999)
+                    {
+                        data[i].key -= ugeneric_random_from_range(0, 5000);
+                    }
+                    break;
+                default: data[i].key = ugeneric_random_from_range(0, 100); break;
+            }
+            data[i].seq = i;
+            a[i] = G_PTR(&data[i]);
+        }
+
+        _comparisons = 0;
+        tim_sort(a, n, _cmp_keyed);
+        if (pattern < 2)
+        {
+            UASSERT_SIZE_EQ(_comparisons, n - 1);
+        }
+        else if (pattern == 2)
+        {
+            UASSERT(_comparisons < 3 * n);
+        }
+
+        for (size_t i = 1; i < n; i++)
+        {
+            const keyed_t *prev = G_AS_PTR(a[i - 1]);
+            const keyed_t *cur = G_AS_PTR(a[i]);
+            UASSERT(prev->key <= cur->key);
+            UASSERT((prev->key < cur->key) || (prev->seq < cur->seq)); // stable
+        }
+    }
+    ufree(a);
+    ufree(data);
+}
+
+typedef struct {
+    char name[32];
+    long id;
+} record_t;
+
+static size_t _key_calls;
+
+static ugeneric_t _record_name(ugeneric_t g)
+{
+    _key_calls++;
+    return G_CSTR(((record_t *)G_AS_PTR(g))->name);
+}
+
+static ugeneric_t _record_id(ugeneric_t g)
+{
+    _key_calls++;
+    return G_INT(((record_t *)G_AS_PTR(g))->id);
+}
+
+void test_key_sort(void)
+{
+    const size_t n = 5000;
+    record_t *records = umalloc(n * sizeof(records[0]));
+    uvector_t *v = uvector_create();
+    uvector_drop_data_ownership(v);
+    for (size_t i = 0; i < n; i++)
+    {
+        long r = ugeneric_random_from_range(0, 1000);
+        sprintf(records[i].name, "common/prefix/%ld", r);
+        records[i].id = -r;
+        uvector_append(v, G_PTR(&records[i]));
+    }
+
+    _key_calls = 0;
+    uvector_sort_by_key(v, _record_name);
+    UASSERT_SIZE_EQ(_key_calls, n);
+    for (size_t i = 1; i < n; i++)
+    {
+        const record_t *prev = G_AS_PTR(uvector_get_at(v, i - 1));
+        const record_t *cur = G_AS_PTR(uvector_get_at(v, i));
+        int diff = strcmp(prev->name, cur->name);
+        UASSERT((diff < 0) || ((diff == 0) && (prev < cur))); // stable
+    }
+
+    uvector_sort_by_key(v, _record_id);
+    for (size_t i = 1; i < n; i++)
+    {
+        const record_t *prev = G_AS_PTR(uvector_get_at(v, i - 1));
+        const record_t *cur = G_AS_PTR(uvector_get_at(v, i));
+        UASSERT(prev->id <= cur->id);
+    }
+    uvector_destroy(v);
+    ufree(records);
+
+    // Strings shorter, equal to and longer than the cached prefix.
+    const char *strings[] = {"abcdefgh", "abcdefg", "abcdefghi", "", "abcdefgh",
+                             "b", "abcdefghh", "abcdefgha", "a"};
+    const char *sorted = "[\"\", \"a\", \"abcdefg\", \"abcdefgh\", \"abcdefgh\", "
+                         "\"abcdefgha\", \"abcdefghh\", \"abcdefghi\", \"b\"]";
+    v = uvector_create();
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+    {
+        uvector_append(v, G_CSTR(strings[i]));
+    }
+    prefix_sort(uvector_get_cells(v), uvector_get_size(v), NULL);
+    char *str = uvector_as_str(v);
+    UASSERT_STR_EQ(str, sorted);
+    ufree(str);
+    uvector_destroy(v);
+}
+
+static int _cmp_desc(const void *p1, const void *p2)
+{
+    long a = *(const long *)p1;
+    long b = *(const long *)p2;
+    return (a < b) - (a > b);
+}
+
+void test_parallel_sort(void)
+{
+    size_t n = 10 * USORT_PARALLEL_CUTOFF + 7;
+    uvector_t *v = uvector_create();
+    for (size_t i = 0; i < n; i++)
+    {
+        uvector_append(v, G_INT(ugeneric_random_from_range(-1000, 1000)));
+    }
+
+    for (size_t nthreads = 0; nthreads < 12; nthreads++)
+    {
+        uvector_t *expected = uvector_copy(v);
+        uvector_t *actual = uvector_copy(v);
+        uvector_sort(expected);
+        uvector_sort_parallel(actual, nthreads);
+        UASSERT(uvector_is_sorted(actual));
+        UASSERT(uvector_compare(expected, actual) == 0);
+        uvector_destroy(expected);
+        uvector_destroy(actual);
+    }
+    uvector_destroy(v);
+
+    // Custom comparator of pointed data.
+    long *data = umalloc(n * sizeof(data[0]));
+    v = uvector_create();
+    uvector_drop_data_ownership(v);
+    uvector_set_void_comparator(v, _cmp_desc);
+    for (size_t i = 0; i < n; i++)
+    {
+        data[i] = (long)i;
+        uvector_append(v, G_PTR(&data[i]));
+    }
+    uvector_set_sorter(v, parallel_sort);
+    uvector_sort(v);
+    for (size_t i = 0; i < n; i++)
+    {
+        UASSERT_INT_EQ(*(long *)G_AS_PTR(uvector_get_at(v, i)), n - 1 - i);
+    }
+    uvector_destroy(v);
+
+    // Few distinct keys: merges are split inside runs of equal items, still
+    // every item has to come out exactly once.
+    bool *seen = umalloc(n * sizeof(seen[0]));
+    for (size_t nthreads = 2; nthreads < 8; nthreads++)
+    {
+        v = uvector_create();
+        uvector_drop_data_ownership(v);
+        uvector_set_void_comparator(v, _cmp_desc);
+        for (size_t i = 0; i < n; i++)
+        {
+            data[i] = ugeneric_random_from_range(0, 2);
+            seen[i] = false;
+            uvector_append(v, G_PTR(&data[i]));
+        }
+        uvector_sort_parallel(v, nthreads);
+        UASSERT(uvector_is_sorted(v));
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t k = (long *)G_AS_PTR(uvector_get_at(v, i)) - data;
+            UASSERT(!seen[k]);
+            seen[k] = true;
+        }
+        uvector_destroy(v);
+    }
+    ufree(seen);
+    ufree(data);
+}
+
+void test_selection(void)
+{
+    const size_t sizes[] = {1, 2, 15, 16, 601, 5000, 50000};
+    for (size_t si = 0; si < sizeof(sizes) / sizeof(sizes[0]); si++)
+    {
+        size_t n = sizes[si];
+        long *data = umalloc(n * sizeof(data[0]));
+        for (int pattern = 0; pattern < 4; pattern++)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                switch (pattern)
+                {
+                    case 0: data[i] = i; break;
+                    case 1: data[i] = n - i; break;
+                    case 2: data[i] = ugeneric_random_from_range(0, 3); break;
+                    default: data[i] = ugeneric_random_from_range(0, n); break;
+                }
+            }
+
+            uvector_t *v = uvector_create();
+            uvector_drop_data_ownership(v);
+            uvector_set_void_comparator(v, _cmp_counting);
+            for (size_t i = 0; i < n; i++)
+            {
+                uvector_append(v, G_PTR(&data[i]));
+            }
+            uvector_t *sorted = uvector_copy(v);
+            uvector_sort(sorted);
+
+            size_t ranks[] = {0, n / 3, n / 2, n - 1};
+            for (size_t ri = 0; ri < sizeof(ranks) / sizeof(ranks[0]); ri++)
+            {
+                size_t r = ranks[ri];
+                uvector_t *c = uvector_copy(v);
+                _comparisons = 0;
+                uvector_nth_element(c, r);
+                if (n > 1000)
+                {
+                    UASSERT(_comparisons < 4 * n); // linear, not n log n
+                }
+                long nth = *(long *)G_AS_PTR(uvector_get_at(c, r));
+                UASSERT_INT_EQ(nth, *(long *)G_AS_PTR(uvector_get_at(sorted, r)));
+                for (size_t i = 0; i < n; i++)
+                {
+                    long e = *(long *)G_AS_PTR(uvector_get_at(c, i));
+                    UASSERT((i < r) ? (e <= nth) : (e >= nth));
+                }
+                uvector_destroy(c);
+
+                size_t k = r + 1;
+                c = uvector_copy(v);
+                uvector_partial_sort(c, k);
+                for (size_t i = 0; i < k; i++)
+                {
+                    UASSERT_INT_EQ(*(long *)G_AS_PTR(uvector_get_at(c, i)),
+                                   *(long *)G_AS_PTR(uvector_get_at(sorted, i)));
+                }
+                uvector_sort(c);
+                UASSERT(uvector_compare(c, sorted) == 0); // a permutation
+                uvector_destroy(c);
+
+                c = uvector_copy(v);
+                uvector_top_k(c, k);
+                for (size_t i = 0; i < k; i++)
+                {
+                    UASSERT_INT_EQ(*(long *)G_AS_PTR(uvector_get_at(c, i)),
+                                   *(long *)G_AS_PTR(uvector_get_at(sorted, n - 1 - i)));
+                }
+                uvector_sort(c);
+                UASSERT(uvector_compare(c, sorted) == 0);
+                uvector_destroy(c);
+            }
+
+            uvector_destroy(sorted);
+            uvector_destroy(v);
+        }
+        ufree(data);
+    }
+
+    size_t n = 10 * USORT_PARALLEL_CUTOFF + 7;
+    uvector_t *v = uvector_create();
+    for (size_t i = 0; i < n; i++)
+    {
+        uvector_append(v, G_INT(ugeneric_random_from_range(-100000, 100000)));
+    }
+    uvector_t *sorted = uvector_copy(v);
+    uvector_sort(sorted);
+    size_t ks[] = {0, 1, 100, USORT_PARALLEL_CUTOFF, n};
+    for (size_t ki = 0; ki < sizeof(ks) / sizeof(ks[0]); ki++)
+    {
+        for (size_t nthreads = 0; nthreads < 9; nthreads += 2)
+        {
+            uvector_t *c = uvector_copy(v);
+            uvector_top_k_parallel(c, ks[ki], nthreads);
+            for (size_t i = 0; i < ks[ki]; i++)
+            {
+                UASSERT_INT_EQ(G_AS_INT(uvector_get_at(c, i)),
+                               G_AS_INT(uvector_get_at(sorted, n - 1 - i)));
+            }
+            uvector_sort(c);
+            UASSERT(uvector_compare(c, sorted) == 0);
+            uvector_destroy(c);
+        }
+    }
+    uvector_destroy(sorted);
+    uvector_destroy(v);
+}
+
 int main(void)
 {
     test_count_iversions();
@@ -237,6 +730,17 @@ int main(void)
     test_sort(quick_sort);
     test_sort(hybrid_sort);
     test_sort(selection_sort);
+    test_sort(parallel_sort);
+    test_sort(radix_sort);
+    test_sort(pdq_sort);
+    test_pdq_sort();
+    test_sort(tim_sort);
+    test_tim_sort();
+    test_sort(prefix_sort);
+    test_key_sort();
+    test_radix_sort();
+    test_parallel_sort();
+    test_selection();
 }
 
 void print_array(ugeneric_t *base, size_t nmemb)
@@ -0,0 +1,169 @@
+#include "sorted_index.h"
+
+#include "string_utils.h"
+#include "ut_utils.h"
+#include <limits.h>
+
+static size_t linear_bound(const uvector_t *v, ugeneric_t e, bool upper)
+{
+    size_t i = 0;
+    size_t size = uvector_get_size(v);
+    for (; i < size; i++)
+    {
+        int diff = ugeneric_compare(uvector_get_at(v, i), e);
+        if (upper ? (diff > 0) : (diff >= 0))
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+static void check_index(const usorted_index_t *si, const uvector_t *v,
+                        ugeneric_t e)
+{
+    size_t lower = linear_bound(v, e, false);
+    size_t upper = linear_bound(v, e, true);
+    UASSERT_SIZE_EQ(usorted_index_lower_bound(si, e), lower);
+    UASSERT_SIZE_EQ(usorted_index_upper_bound(si, e), upper);
+    UASSERT_SIZE_EQ(usorted_index_find(si, e), (lower < upper) ? lower : SIZE_MAX);
+    UASSERT(usorted_index_contains(si, e) == (lower < upper));
+
+    size_t first;
+    UASSERT_SIZE_EQ(usorted_index_get_range(si, e, e, &first), 0);
+    UASSERT_SIZE_EQ(first, lower);
+}
+
+void test_sorted_index_numbers(void)
+{
+    for (size_t size = 0; size < 70; size++)
+    {
+        uvector_t *vi = uvector_create();
+        uvector_t *vs = uvector_create();
+        uvector_i64_t *ti = uvector_i64_create();
+        for (size_t i = 0; i < size; i++)
+        {
+            long e = ugeneric_random_from_range(-(long)size, size);
+            uvector_append(vi, G_INT(e));
+            uvector_append(vs, G_SIZE(e + size));
+            uvector_i64_append(ti, e);
+        }
+        uvector_sort(vi);
+        uvector_sort(vs);
+        uvector_i64_sort(ti);
+
+        usorted_index_t *si = usorted_index_create(vi);
+        usorted_index_t *ss = usorted_index_create(vs);
+        usorted_index_t *st = usorted_index_create_from_i64(ti);
+        UASSERT_SIZE_EQ(usorted_index_get_size(si), size);
+        for (long e = -(long)size - 2; e <= (long)size + 2; e++)
+        {
+            check_index(si, vi, G_INT(e));
+            check_index(st, vi, G_INT(e));
+            check_index(ss, vs, G_SIZE(e + size + 2));
+
+            // Numbers of other types than the indexed ones.
+            check_index(si, vi, G_REAL(e + 0.5));
+            check_index(si, vi, G_REAL(e));
+            check_index(st, vi, G_REAL(e - 0.5));
+            check_index(ss, vs, G_INT(e));
+            check_index(ss, vs, G_REAL(e + (long)size + 0.5));
+            if (e >= 0)
+            {
+                check_index(si, vi, G_SIZE(e));
+            }
+        }
+
+        ugeneric_t keys[2 * 70 + 8];
+        size_t positions[2 * 70 + 8];
+        size_t n = 0;
+        for (long e = -(long)size - 2; e <= (long)size + 2; e++)
+        {
+            keys[n++] = G_INT(e);
+        }
+        keys[n++] = G_REAL(0.5);
+        keys[n++] = G_SIZE(1);
+        keys[n++] = G_CSTR("a");
+        usorted_index_lower_bound_batch(si, keys, n, positions);
+        for (size_t i = 0; i < n; i++)
+        {
+            UASSERT_SIZE_EQ(positions[i], linear_bound(vi, keys[i], false));
+        }
+
+        usorted_index_destroy(si);
+        usorted_index_destroy(ss);
+        usorted_index_destroy(st);
+        uvector_i64_destroy(ti);
+        uvector_destroy(vi);
+        uvector_destroy(vs);
+    }
+
+    // Whole range of keys, negative ones first.
+    uvector_t *v = uvector_create();
+    uvector_append(v, G_INT(LONG_MIN));
+    uvector_append(v, G_INT(-1));
+    uvector_append(v, G_INT(0));
+    uvector_append(v, G_INT(LONG_MAX));
+    usorted_index_t *si = usorted_index_create(v);
+    UASSERT_SIZE_EQ(usorted_index_find(si, G_INT(LONG_MIN)), 0);
+    UASSERT_SIZE_EQ(usorted_index_find(si, G_INT(-1)), 1);
+    UASSERT_SIZE_EQ(usorted_index_upper_bound(si, G_INT(LONG_MAX)), 4);
+    UASSERT_SIZE_EQ(usorted_index_lower_bound(si, G_INT(LONG_MAX)), 3);
+    usorted_index_destroy(si);
+    uvector_destroy(v);
+
+    uvector_size_t *ts = uvector_size_create();
+    for (size_t i = 0; i < 1000; i++)
+    {
+        uvector_size_append(ts, i * 2);
+    }
+    si = usorted_index_create_from_size(ts);
+    size_t first;
+    UASSERT_SIZE_EQ(usorted_index_get_range(si, G_SIZE(11), G_SIZE(100), &first), 44);
+    UASSERT_SIZE_EQ(first, 6);
+    UASSERT_SIZE_EQ(usorted_index_get_range(si, G_SIZE(100), G_SIZE(11), &first), 0);
+    UASSERT_SIZE_EQ(usorted_index_find(si, G_SIZE(1998)), 999);
+    UASSERT_SIZE_EQ(usorted_index_find(si, G_SIZE(1997)), SIZE_MAX);
+    UASSERT(umem_usage_get_total(usorted_index_get_memory_usage(si)) >= 1000 * 16);
+    usorted_index_destroy(si);
+    uvector_size_destroy(ts);
+}
+
+void test_sorted_index_strings(void)
+{
+    uvector_t *v = uvector_create();
+    for (int i = 0; i < 300; i++)
+    {
+        uvector_append(v, G_STR(ustring_fmt("key%03d", i / 2 * 2)));
+    }
+    uvector_sort(v);
+
+    usorted_index_t *si = usorted_index_create(v);
+    for (int i = -1; i < 302; i++)
+    {
+        char *key = ustring_fmt("key%03d", i);
+        check_index(si, v, G_CSTR(key));
+        ufree(key);
+    }
+    UASSERT_SIZE_EQ(usorted_index_find(si, G_CSTR("key010")), 10);
+    UASSERT_SIZE_EQ(usorted_index_find(si, G_CSTR("key011")), SIZE_MAX);
+
+    ugeneric_t keys[] = {G_CSTR("a"), G_CSTR("key100"), G_CSTR("z")};
+    size_t positions[3];
+    usorted_index_lower_bound_batch(si, keys, 3, positions);
+    UASSERT_SIZE_EQ(positions[0], 0);
+    UASSERT_SIZE_EQ(positions[1], 100);
+    UASSERT_SIZE_EQ(positions[2], 300);
+
+    usorted_index_destroy(si);
+    uvector_destroy(v);
+}
+
+int main(void)
+{
+    test_sorted_index_numbers();
+    test_sorted_index_strings();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+#include "tvector.h"
+
+#include "ut_utils.h"
+
+void test_tvector_basic(void)
+{
+    uvector_i64_t *v = uvector_i64_create();
+    UASSERT(uvector_i64_is_empty(v));
+    for (int64_t i = 0; i < 100; i++)
+    {
+        uvector_i64_append(v, 99 - i);
+    }
+    UASSERT_SIZE_EQ(uvector_i64_get_size(v), 100);
+    UASSERT_INT_EQ(uvector_i64_get_at(v, 0), 99);
+    UASSERT_INT_EQ(uvector_i64_get_back(v), 0);
+    UASSERT(!uvector_i64_is_sorted(v));
+
+    uvector_i64_sort(v);
+    UASSERT(uvector_i64_is_sorted(v));
+    UASSERT_SIZE_EQ(uvector_i64_bsearch(v, 42), 42);
+    UASSERT_SIZE_EQ(uvector_i64_bsearch(v, 100), SIZE_MAX);
+    UASSERT(uvector_i64_contains(v, 77));
+    UASSERT(uvector_i64_find(v, -1) == NULL);
+
+    uvector_i64_insert_at(v, 0, -1);
+    uvector_i64_insert_at(v, 101, 100);
+    UASSERT_INT_EQ(uvector_i64_get_at(v, 0), -1);
+    UASSERT_INT_EQ(uvector_i64_pop_back(v), 100);
+    uvector_i64_remove_at(v, 0);
+    uvector_i64_set_at(v, 1, 10);
+    UASSERT_INT_EQ(uvector_i64_get_cells(v)[1], 10);
+
+    uvector_i64_t *copy = uvector_i64_copy(v);
+    UASSERT(uvector_i64_compare(v, copy) == 0);
+    uvector_i64_reverse(copy);
+    UASSERT(uvector_i64_compare(v, copy) < 0);
+    uvector_i64_destroy(copy);
+
+    uvector_i64_resize(v, 3, 0);
+    char *str = uvector_i64_as_str(v);
+    UASSERT_STR_EQ(str, "[0, 10, 2]");
+    ufree(str);
+
+    umem_usage_t u = uvector_i64_get_memory_usage(v);
+    UASSERT_SIZE_EQ(u.buckets, uvector_i64_get_capacity(v) * sizeof(int64_t));
+    UASSERT_SIZE_EQ(u.payload, 0);
+
+    uvector_i64_clear(v);
+    UASSERT(uvector_i64_is_empty(v));
+    uvector_i64_destroy(v);
+}
+
+void test_tvector_conversion(void)
+{
+    double a[] = {3.5, -1.25, 2.0};
+    uvector_f64_t *v = uvector_f64_create_from_array(a, 3);
+    UASSERT(memcmp(uvector_f64_get_cells(v), a, sizeof(a)) == 0);
+
+    uvector_t *g = uvector_f64_to_uvector(v);
+    UASSERT_SIZE_EQ(uvector_get_size(g), 3);
+    UASSERT(G_IS_REAL(uvector_get_at(g, 1)));
+    UASSERT(G_AS_REAL(uvector_get_at(g, 1)) == -1.25);
+
+    uvector_f64_t *back = uvector_f64_from_uvector(g);
+    UASSERT(uvector_f64_compare(v, back) == 0);
+    uvector_f64_sort(back);
+    UASSERT(uvector_f64_get_at(back, 0) == -1.25);
+    uvector_f64_destroy(back);
+    uvector_destroy(g);
+    uvector_f64_destroy(v);
+
+    uvector_size_t *s = uvector_size_create_with_size(4, 7);
+    g = uvector_size_to_uvector(s);
+    char *str1 = uvector_size_as_str(s);
+    char *str2 = uvector_as_str(g);
+    UASSERT_STR_EQ(str1, str2);
+    ufree(str1);
+    ufree(str2);
+    uvector_destroy(g);
+    uvector_size_destroy(s);
+
+    // Numbers are converted when they are kept exactly.
+    g = uvector_create();
+    uvector_append(g, G_INT(-3));
+    uvector_append(g, G_SIZE(4));
+    uvector_append(g, G_REAL(5.0));
+    uvector_i64_t *i = uvector_i64_from_uvector(g);
+    UASSERT_SIZE_EQ(uvector_i64_get_size(i), 3);
+    UASSERT_INT_EQ(uvector_i64_get_at(i, 0), -3);
+    UASSERT_INT_EQ(uvector_i64_get_at(i, 2), 5);
+    uvector_i64_destroy(i);
+    v = uvector_f64_from_uvector(g);
+    UASSERT(uvector_f64_get_at(v, 1) == 4.0);
+    uvector_f64_destroy(v);
+    UASSERT(uvector_size_from_uvector(g) == NULL);
+    uvector_append(g, G_REAL(0.5));
+    UASSERT(uvector_i64_from_uvector(g) == NULL);
+    uvector_append(g, G_CSTR("6"));
+    UASSERT(uvector_f64_from_uvector(g) == NULL);
+    uvector_destroy(g);
+
+    g = uvector_create();
+    uvector_append(g, G_SIZE(SIZE_MAX));
+    UASSERT(uvector_i64_from_uvector(g) == NULL);
+    UASSERT(uvector_f64_from_uvector(g) == NULL);
+    s = uvector_size_from_uvector(g);
+    UASSERT_SIZE_EQ(uvector_size_get_at(s, 0), SIZE_MAX);
+    uvector_size_destroy(s);
+    uvector_set_at(g, 0, G_REAL(1e300));
+    UASSERT(uvector_i64_from_uvector(g) == NULL);
+    UASSERT(uvector_size_from_uvector(g) == NULL);
+    uvector_destroy(g);
+}
+
+void test_tvector_raw_array(void)
+{
+    int16_t i16[] = {-300, 0, 300};
+    uvector_i64_t *i = uvector_i64_create_from_raw_array(i16, 3, sizeof(i16[0]), G_INT_T);
+    UASSERT_INT_EQ(uvector_i64_get_at(i, 0), -300);
+    UASSERT_INT_EQ(uvector_i64_get_at(i, 2), 300);
+    uvector_i64_destroy(i);
+    UASSERT(uvector_size_create_from_raw_array(i16, 3, sizeof(i16[0]), G_INT_T) == NULL);
+
+    uint32_t u32[] = {UINT32_MAX, 1};
+    uvector_size_t *s = uvector_size_create_from_raw_array(u32, 2, sizeof(u32[0]), G_SIZE_T);
+    UASSERT_SIZE_EQ(uvector_size_get_at(s, 0), UINT32_MAX);
+    uvector_size_destroy(s);
+
+    float f[] = {1.5f, -2.0f};
+    uvector_f64_t *v = uvector_f64_create_from_raw_array(f, 2, sizeof(f[0]), G_REAL_T);
+    UASSERT(uvector_f64_get_at(v, 0) == 1.5);
+    UASSERT(uvector_f64_get_at(v, 1) == -2.0);
+    uvector_f64_destroy(v);
+    UASSERT(uvector_i64_create_from_raw_array(f, 2, sizeof(f[0]), G_REAL_T) == NULL);
+    UASSERT(uvector_i64_create_from_raw_array(f, 2, 3, G_INT_T) == NULL);
+
+    i = uvector_i64_create_from_raw_array(NULL, 0, sizeof(int), G_INT_T);
+    UASSERT(uvector_i64_is_empty(i));
+    uvector_i64_destroy(i);
+}
+
+int main(void)
+{
+    test_tvector_basic();
+    test_tvector_conversion();
+    test_tvector_raw_array();
+
+    return EXIT_SUCCESS;
+}
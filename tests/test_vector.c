@@ -383,6 +383,11 @@ void _check_slice(const uvector_t *v, size_t b, size_t e, size_t s, const char *
     UASSERT_STR_EQ(str, exp);
     ufree(str);
     uvector_destroy(slice);
+
+    uvector_view_t w = uvector_get_view(v, b, e, s);
+    str = uvector_view_as_str(&w);
+    UASSERT_STR_EQ(str, exp);
+    ufree(str);
 }
 
 void test_vector_slice(void)
@@ -411,6 +416,214 @@ void test_vector_slice(void)
     uvector_destroy(v);
 }
 
+void test_vector_view(void)
+{
+    uvector_t *v = uvector_create();
+    for (int i = 0; i < 100; i++)
+    {
+        uvector_append(v, G_INT(i));
+    }
+
+    // Odd numbers of [10, 90) and every third of those.
+    uvector_view_t w = uvector_get_view(v, 11, 90, 2);
+    UASSERT_SIZE_EQ(uvector_view_get_size(&w), 40);
+    UASSERT_INT_EQ(G_AS_INT(uvector_view_get_at(&w, 0)), 11);
+    UASSERT_INT_EQ(G_AS_INT(uvector_view_get_at(&w, 39)), 89);
+    uvector_view_t ww = uvector_view_get_view(&w, 1, 40, 3);
+    UASSERT_SIZE_EQ(uvector_view_get_size(&ww), 13);
+    UASSERT_INT_EQ(G_AS_INT(uvector_view_get_at(&ww, 1)), 19);
+    UASSERT(uvector_get_cells(v) + 13 == &ww.cells[0]);
+
+    UASSERT_SIZE_EQ(uvector_view_find(&w, G_INT(51)), 20);
+    UASSERT_SIZE_EQ(uvector_view_find(&w, G_REAL(51.0)), 20);
+    UASSERT_SIZE_EQ(uvector_view_find(&w, G_INT(50)), SIZE_MAX);
+    UASSERT(uvector_view_contains(&ww, G_INT(19)));
+    UASSERT(!uvector_view_contains(&ww, G_INT(17)));
+    for (int i = 0; i < 100; i++)
+    {
+        size_t exp = ((i % 2) && (i > 10) && (i < 90)) ? (size_t)(i - 11) / 2 : SIZE_MAX;
+        UASSERT_SIZE_EQ(uvector_view_bsearch(&w, G_INT(i)), exp);
+    }
+
+    uvector_view_t whole = uvector_get_view(v, 0, 100, 1);
+    UASSERT_SIZE_EQ(uvector_view_find(&whole, G_INT(77)), 77);
+    uvector_view_t empty = uvector_get_view(v, 5, 5, 1);
+    UASSERT(uvector_view_is_empty(&empty));
+    UASSERT_SIZE_EQ(uvector_view_bsearch(&empty, G_INT(5)), SIZE_MAX);
+
+    // Backwards stride through the sorted output.
+    uvector_t *out = uvector_create();
+    uvector_drop_data_ownership(out);
+    uvector_append(out, G_INT(-1));
+    uvector_reverse(v);
+    w = uvector_get_view(v, 0, 10, 3);
+    uvector_view_sort_into(&w, out);
+    uvector_view_sort_into(&empty, out);
+    char *str = uvector_as_str(out);
+    UASSERT_STR_EQ(str, "[-1, 90, 93, 96, 99]");
+    ufree(str);
+    uvector_destroy(out);
+
+    out = uvector_view_to_vector(&w);
+    UASSERT(!uvector_is_data_owner(out));
+    str = uvector_as_str(out);
+    UASSERT_STR_EQ(str, "[99, 96, 93, 90]");
+    ufree(str);
+    uvector_destroy(out);
+
+    // Items stay with the source.
+    uvector_t *vs = uvector_create();
+    uvector_append(vs, G_STR(ustring_dup("b")));
+    uvector_append(vs, G_STR(ustring_dup("a")));
+    w = uvector_get_view(vs, 0, 2, 1);
+    out = uvector_view_to_vector(&w);
+    uvector_sort(out);
+    str = uvector_as_str(out);
+    UASSERT_STR_EQ(str, "[\"a\", \"b\"]");
+    ufree(str);
+    uvector_destroy(out);
+    uvector_destroy(vs);
+
+    uvector_destroy(v);
+    uvector_t *e = uvector_create();
+    w = uvector_get_view(e, 0, 0, 1);
+    str = uvector_view_as_str(&w);
+    UASSERT_STR_EQ(str, "[]");
+    ufree(str);
+    uvector_destroy(e);
+}
+
+void test_vector_cow_copy(void)
+{
+    uvector_t *v = uvector_create();
+    for (int i = 0; i < 10; i++)
+    {
+        uvector_append(v, G_STR(ustring_fmt("%d", i)));
+    }
+
+    uvector_t *c1 = uvector_cow_copy(v);
+    uvector_t *c2 = uvector_cow_copy(c1);
+    UASSERT(uvector_get_cells(c1) == uvector_get_cells(v));
+    UASSERT(uvector_is_data_owner(c2));
+    UASSERT_INT_EQ(uvector_compare(v, c2), 0);
+
+    // Only the modified one gets cells (and items) of its own.
+    uvector_set_at(c1, 0, G_STR(ustring_dup("x")));
+    UASSERT(uvector_get_cells(c1) != uvector_get_cells(v));
+    UASSERT(uvector_get_cells(c2) == uvector_get_cells(v));
+    UASSERT(G_AS_STR(uvector_get_at(c1, 1)) != G_AS_STR(uvector_get_at(v, 1)));
+    UASSERT_STR_EQ(G_AS_STR(uvector_get_at(v, 0)), "0");
+
+    uvector_reverse(v);
+    UASSERT(uvector_get_cells(c2) != uvector_get_cells(v));
+    UASSERT_STR_EQ(G_AS_STR(uvector_get_at(c2, 0)), "0");
+    UASSERT_STR_EQ(G_AS_STR(uvector_get_at(v, 0)), "9");
+
+    // The last one left doesn't copy anything.
+    const ugeneric_t *cells = uvector_get_cells(c2);
+    uvector_destroy(uvector_cow_copy(c2));
+    uvector_append(c2, G_STR(ustring_dup("10")));
+    UASSERT(uvector_get_cells(c2) == cells);
+
+    uvector_t *c3 = uvector_cow_copy(c2);
+    uvector_clear(c3);
+    UASSERT(uvector_is_empty(c3));
+    uvector_append(c3, G_STR(ustring_dup("a")));
+    UASSERT_SIZE_EQ(uvector_get_size(c2), 11);
+
+    // Non-owners share just the cells.
+    uvector_t *s = uvector_copy(v);
+    uvector_t *c4 = uvector_cow_copy(s);
+    uvector_pop_back(c4);
+    UASSERT(G_AS_STR(uvector_get_at(c4, 0)) == G_AS_STR(uvector_get_at(v, 0)));
+    UASSERT_SIZE_EQ(uvector_get_size(s), 10);
+
+    // Snapshot of an empty vector.
+    uvector_t *e = uvector_create();
+    uvector_t *c5 = uvector_cow_copy(e);
+    uvector_append(c5, G_INT(1));
+    uvector_append(e, G_INT(2));
+    UASSERT_INT_EQ(G_AS_INT(uvector_get_at(c5, 0)), 1);
+    UASSERT_INT_EQ(G_AS_INT(uvector_get_at(e, 0)), 2);
+    uvector_destroy(c5);
+    uvector_destroy(e);
+
+    // Found items may be written to, contains() doesn't unshare.
+    uvector_t *n = uvector_create();
+    uvector_append(n, G_INT(1));
+    uvector_t *c6 = uvector_cow_copy(n);
+    UASSERT(uvector_contains(c6, G_INT(1)));
+    UASSERT(uvector_get_cells(c6) == uvector_get_cells(n));
+    UASSERT(uvector_find(c6, G_INT(2)) == NULL);
+    UASSERT(uvector_get_cells(c6) == uvector_get_cells(n));
+    *uvector_find(c6, G_INT(1)) = G_INT(3);
+    UASSERT_INT_EQ(G_AS_INT(uvector_get_at(n, 0)), 1);
+    UASSERT_INT_EQ(G_AS_INT(uvector_get_at(c6, 0)), 3);
+    uvector_destroy(c6);
+    uvector_destroy(n);
+
+    uvector_destroy(c4);
+    uvector_destroy(s);
+    uvector_destroy(v);
+    uvector_destroy(c1);
+    uvector_destroy(c2);
+    uvector_destroy(c3);
+}
+
+void test_vector_unique(void)
+{
+    ugeneric_t g = ugeneric_parse("[3, \"b\", 1, 3.0, \"a\", null, 1, \"b\", 2, 0, -0.0, null]");
+    UASSERT_NO_ERROR(g);
+    uvector_t *v = G_AS_PTR(g);
+    uvector_t *c = uvector_deep_copy(v);
+
+    uvector_unique(v);
+    char *str = uvector_as_str(v);
+    UASSERT_STR_EQ(str, "[3, \"b\", 1, \"a\", null, 2, 0]");
+    ufree(str);
+
+    uvector_unique_sorted(c);
+    str = uvector_as_str(c);
+    UASSERT_STR_EQ(str, "[null, \"a\", \"b\", 0, 1, 2, 3]");
+    ufree(str);
+    uvector_destroy(c);
+    uvector_destroy(v);
+
+    // Heavy collisions: multiples of a big power of two.
+    v = uvector_create();
+    for (long i = 0; i < 5000; i++)
+    {
+        uvector_append(v, G_INT((long)(rand() % 1000) << 20));
+    }
+    c = uvector_cow_copy(v);
+    uvector_t *sorted = uvector_cow_copy(v);
+    uvector_unique(v);
+    uvector_unique_sorted(sorted);
+    UASSERT_SIZE_EQ(uvector_get_size(v), uvector_get_size(sorted));
+
+    // First occurrences, in order.
+    size_t k = 0;
+    ugeneric_t *cells = uvector_get_cells(c);
+    for (size_t i = 0; i < uvector_get_size(c); i++)
+    {
+        if (uvector_find(c, cells[i]) == &cells[i])
+        {
+            UASSERT_INT_EQ(G_AS_INT(uvector_get_at(v, k++)), G_AS_INT(cells[i]));
+        }
+    }
+    UASSERT_SIZE_EQ(k, uvector_get_size(v));
+    uvector_destroy(sorted);
+    uvector_destroy(c);
+    uvector_destroy(v);
+
+    v = uvector_create();
+    uvector_unique(v);
+    uvector_append(v, G_INT(1));
+    uvector_unique_sorted(v);
+    UASSERT_SIZE_EQ(uvector_get_size(v), 1);
+    uvector_destroy(v);
+}
+
 void test_vector_data_ownership(void)
 {
     uvector_t *v = uvector_create();
@@ -467,6 +680,76 @@ void test_vector_reverse(void)
     _check_reverse("[1, 2, 3, 4, 5]", "[5, 4, 3, 2, 1]");
 }
 
+void test_vector_find(void)
+{
+    // Reals far outside of the integer range.
+    uvector_t *r = uvector_create();
+    uvector_append(r, G_REAL(0.5));
+    uvector_append(r, G_REAL(1e300));
+    UASSERT(uvector_contains(r, G_REAL(1e300)));
+    UASSERT(!uvector_contains(r, G_REAL(-1e300)));
+    uvector_destroy(r);
+
+    uvector_t *v = uvector_create();
+    for (int i = 0; i < 1000; i++)
+    {
+        uvector_append(v, G_INT(i % 10));
+    }
+    uvector_append(v, G_SIZE(3));
+    uvector_append(v, G_REAL(3.0));
+    uvector_append(v, G_REAL(-0.0));
+    uvector_append(v, G_REAL(2.5));
+    uvector_append(v, G_STR(ustring_dup("3")));
+    uvector_append(v, G_BOOL(true));
+    uvector_append(v, G_NULL());
+    uvector_append(v, G_INT(-7));
+    uvector_append(v, G_SIZE((size_t)-7)); // same bits as -7
+
+    // Numbers are equal across types, as ugeneric_compare() has it.
+    UASSERT_SIZE_EQ(uvector_count(v, G_INT(3)), 102);
+    UASSERT_SIZE_EQ(uvector_count(v, G_SIZE(3)), 102);
+    UASSERT_SIZE_EQ(uvector_count(v, G_REAL(3.0)), 102);
+    UASSERT_SIZE_EQ(uvector_count(v, G_INT(0)), 101);
+    UASSERT_SIZE_EQ(uvector_count(v, G_REAL(0.0)), 101);
+    UASSERT_SIZE_EQ(uvector_count(v, G_REAL(2.5)), 1);
+    UASSERT_SIZE_EQ(uvector_count(v, G_INT(-7)), 1);
+    UASSERT_SIZE_EQ(uvector_count(v, G_SIZE((size_t)-7)), 1);
+    UASSERT_SIZE_EQ(uvector_count(v, G_INT(10)), 0);
+    UASSERT_SIZE_EQ(uvector_count(v, G_CSTR("3")), 1);
+    UASSERT_SIZE_EQ(uvector_count(v, G_TRUE()), 1);
+    UASSERT_SIZE_EQ(uvector_count(v, G_NULL()), 1);
+
+    UASSERT(uvector_find(v, G_INT(9)) == uvector_get_cells(v) + 9);
+    UASSERT(uvector_find(v, G_REAL(2.5)) == uvector_get_cells(v) + 1003);
+    UASSERT(uvector_find(v, G_INT(11)) == NULL);
+    UASSERT(uvector_contains(v, G_SIZE(9)));
+    UASSERT(!uvector_contains(v, G_REAL(9.5)));
+
+    uvector_t *positions = uvector_find_all(v, G_INT(3));
+    UASSERT_SIZE_EQ(uvector_get_size(positions), 102);
+    UASSERT_SIZE_EQ(G_AS_SIZE(uvector_get_at(positions, 0)), 3);
+    UASSERT_SIZE_EQ(G_AS_SIZE(uvector_get_at(positions, 99)), 993);
+    UASSERT_SIZE_EQ(G_AS_SIZE(uvector_get_at(positions, 100)), 1000);
+    UASSERT_SIZE_EQ(G_AS_SIZE(uvector_get_at(positions, 101)), 1001);
+    uvector_destroy(positions);
+    positions = uvector_find_all(v, G_STR("nope"));
+    UASSERT(uvector_is_empty(positions));
+    uvector_destroy(positions);
+    uvector_destroy(v);
+
+    v = uvector_create();
+    for (size_t i = 0; i < 1000 * 1000; i++)
+    {
+        uvector_append(v, G_INT(i % 1000));
+    }
+    for (size_t nthreads = 0; nthreads < 6; nthreads++)
+    {
+        UASSERT_SIZE_EQ(uvector_count_parallel(v, G_INT(7), nthreads), 1000);
+        UASSERT_SIZE_EQ(uvector_count_parallel(v, G_STR("7"), nthreads), 0);
+    }
+    uvector_destroy(v);
+}
+
 int main(int argc, char **argv)
 {
 //    test_gnuplot();
@@ -480,8 +763,12 @@ int main(int argc, char **argv)
     test_vector_bsearch();
     test_vector_compare();
     test_vector_slice();
+    test_vector_view();
+    test_vector_cow_copy();
+    test_vector_unique();
     test_vector_data_ownership();
     test_vector_reverse();
+    test_vector_find();
 
     return EXIT_SUCCESS;
 }